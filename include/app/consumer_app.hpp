@@ -4,11 +4,17 @@
 #include "core/pipeline.hpp"
 #include "core/descriptor_manager.hpp"
 #include "core/vertex_definitions.hpp"
+#include "media/shm_texture.hpp"
 #include "memory/shm_video_handler.hpp"
+#include "memory/dma_buf_handler.hpp"
+#include "ipc/control_protocol.hpp"
+#include "sync/sync_manager.hpp"
+#include "tools/benchmark.hpp"
 #include <opencv2/opencv.hpp>
 #include <atomic>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace vst
 {
@@ -17,7 +23,9 @@ namespace vst
     public:
         ConsumerApp();
         ConsumerApp(const std::string &mode);
-        ConsumerApp(GLFWwindow *window, const std::string &shmName, const std::string &mode, bool isVideo);
+        // A null window runs headless, rendering offscreen at the shared image size
+        ConsumerApp(GLFWwindow *window, const std::string &shmName, const std::string &mode, bool isVideo,
+                    PresentProfile presentProfile = PresentProfile::VSync);
         ~ConsumerApp();
 
         void runFrame();
@@ -26,9 +34,29 @@ namespace vst
         // New method for SHM video consumption
         bool consumeShmVideo(const std::string &shmName);
 
+        // Same as consumeShmVideo(), for a producer handing out a memfd segment on a Unix socket
+        bool consumeShmVideoSocket(const std::string &socketPath);
+
         // Run the video loop for SHM video
         void runVideoLoop();
 
+        // Maps the buffers of a DMA-BUF heap producer read-only; frames are shown with OpenCV, no GPU needed
+        bool consumeDmaHeap(const std::string &socketPath);
+
+        // Show every frame the heap producer announces until it goes away or the window is closed
+        void runHeapLoop();
+
+        // Upload SHM video frames into a Vulkan texture on a headless context and draw them
+        // offscreen instead of showing them in a window; set before consumeShmVideo().
+        // Segments that are not RGBA are converted on the GPU.
+        void setGpuUpload(bool enabled) { m_gpuUpload = enabled; }
+
+        // Write SHM video latency percentiles to a CSV file; set before runVideoLoop()
+        void setLatencyLogPath(const std::string &path) { m_latencyLogPath = path; }
+
+        // False once the DMA-BUF producer said goodbye or dropped the connection
+        bool isProducerConnected() const { return producerConnected; }
+
         // Check if video consumption is still running
         bool isVideoRunning() const { return m_videoRunning; }
 
@@ -50,23 +78,58 @@ namespace vst
         uint32_t imageWidth;
         uint32_t imageHeight;
 
-        VkImage importedImage = VK_NULL_HANDLE;
-        VkDeviceMemory importedMemory = VK_NULL_HANDLE;
-        VkImageView importedImageView = VK_NULL_HANDLE;
+        // Control connection to the DMA-BUF producer, kept open for frame notifications
+        int controlSocketFd = -1;
+        bool producerConnected = true;
+        uint64_t lastReadyFrame = 0;
+        sync::SyncManager m_sync; // Orders draws after the producer's uploads
+        void pollControlMessages();
+
+        // Imports one ring image from the producer; takes ownership of fd
+        void importDmaBufImage(const ipc::ImageDescription &desc, int fd);
+
+        // The heap producer's buffers, mapped read-only, heap mode only
+        std::vector<memory::DmaBuffer> m_heapBuffers;
+        size_t m_heapRowPitch = 0;
+
+        // The producer's image ring, one descriptor set per image
+        std::vector<VkImage> importedImages;
+        std::vector<VkDeviceMemory> importedMemories;
+        std::vector<VkImageView> importedImageViews;
+        uint32_t currentImage = 0; // Ring image named by the latest FRAME_READY
         VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
-        DescriptorManager descriptorManager;
+        std::vector<DescriptorManager> descriptorManagers;
         Pipeline pipeline;
         std::string mode;
         std::string shmName;
         bool isVideo = false;
 
         VkBuffer vertexBuffer = VK_NULL_HANDLE;
-        VkDeviceMemory vertexBufferMemory = VK_NULL_HANDLE;
+        memory::Allocation vertexBufferAllocation;
 
         // Video-specific members
         std::shared_ptr<memory::ShmVideoHandler> m_shmVideoHandler;
         std::string m_videoWindowTitle;
         std::atomic<bool> m_videoRunning{false};
         double m_videoFrameRate = 30.0;
+        bool m_gpuUpload = false;
+        ColorConvertPipeline m_colorConverter;    // Expands non-RGBA segments into m_shmTexture
+        std::unique_ptr<ShmTexture> m_shmTexture; // Declared after the handler, so released before its mapping
+
+        // Per-stage SHM video latency, from the CLOCK_MONOTONIC stamps in each frame
+        LatencyHistogram m_decodeToPublish;
+        LatencyHistogram m_publishToAcquire;
+        LatencyHistogram m_acquireToPresent;
+        LatencyHistogram m_endToEnd;
+        std::string m_latencyLogPath;
+
+        void logLatency(BenchmarkLogger *logger);
+
+        // Window or GPU upload setup once m_shmVideoHandler has a segment open
+        bool setupShmVideoConsumer();
+
+        // Descriptor sets, pipeline and quad for drawing any of views with drawFrame(), one set per view
+        void createDrawResources(const std::vector<VkImageView> &views, uint32_t width, uint32_t height);
+        void destroyDrawResources();
     };
 }
\ No newline at end of file
@@ -4,11 +4,14 @@
 #include <memory>
 #include <thread>
 #include <atomic>
+#include <algorithm>
+#include <vector>
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/videoio.hpp>
 #include "core/pipeline.hpp"
+#include "core/color_convert_pipeline.hpp"
 #include "core/descriptor_manager.hpp"
 #include "core/vulkan_context.hpp"
 #include "media/image_loader.hpp"
@@ -18,6 +21,9 @@
 #include "media/frame_queue.hpp"
 #include "media/video_loader.hpp"
 #include "memory/shm_video_handler.hpp"
+#include "memory/dma_buf_handler.hpp"
+#include "ipc/control_server.hpp"
+#include "sync/sync_manager.hpp"
 
 namespace vst
 {
@@ -29,8 +35,18 @@ namespace vst
         ProducerApp(const VulkanContext &context);
         ~ProducerApp();
 
+        // A null window runs headless, rendering offscreen at the image or video size
         void ProducerDMA(GLFWwindow *window, const std::string &imagePath, const std::string &mode, bool isVideo);
         void ProducerSHM(const std::string &imagePath, const std::string &mode, bool isVideo);
+        // Shares RGBA frames in buffers from the system DMA-BUF heap; needs no GPU
+        void ProducerHeap(const std::string &imagePath, bool isVideo);
+
+        /**
+         * @brief Converts a decoded BGR frame into the next heap buffer and announces it
+         *
+         * Consumers keep reading the previously announced buffer meanwhile.
+         */
+        bool publishHeapFrame(const cv::Mat &frame, uint64_t frameIndex);
 
         void runFrame();
         void runFrame(const std::string &imagePath);
@@ -42,6 +58,15 @@ namespace vst
         std::shared_ptr<memory::ShmVideoHandler> getSharedMemoryHandler() { return shmVideoHandler; }
         std::string getWindowTitle() { return windowTitle; }
 
+        // Policy applied to slow SHM video readers; set before ProducerSHM()
+        void setBackpressurePolicy(memory::BackpressurePolicy policy) { backpressurePolicy = policy; }
+
+        // Backing and mapping options for the SHM video segment; set before ProducerSHM()
+        void setShmVideoOptions(const memory::ShmVideoOptions &options) { shmVideoOptions = options; }
+
+        // Transport format of the SHM video frames (RGBA8, NV12 or I420); set before ProducerSHM()
+        void setShmPixelFormat(memory::ShmPixelFormat format) { shmPixelFormat = format; }
+
         bool isDecodingDone() const { return decodingDone; }
         bool isRunning() const { return running; }
 
@@ -50,8 +75,19 @@ namespace vst
         bool writeFrame(const cv::Mat &frame);
 
         // validate socket connections
-        bool setupDmaSocket(const std::string &socketPath, int fd, uint32_t width, uint32_t height);
-        void checkForConnections();
+        bool setupDmaSocket(const std::string &socketPath, const std::vector<int> &fds, const ipc::ImageDescription &desc);
+
+        // Tell every connected consumer that ring image imageIndex now holds the latest frame;
+        // signalValue and syncFd (owned) say what to wait on before sampling it
+        void notifyFrameReady(uint64_t frameIndex, uint32_t imageIndex, uint64_t signalValue = 0, int syncFd = -1);
+
+        // Fewest ring images the DMA-BUF video path may use. On a separate transfer or compute family an
+        // upload overwrites its image without waiting on the graphics queue, so the image must not still
+        // be sampled by any of the kMaxFramesInFlight draws that may be queued
+        static constexpr uint32_t kMinDmaRingSize = VulkanContext::kMaxFramesInFlight + 1;
+
+        // Number of exported images the DMA-BUF video path cycles through (3-4); set before ProducerDMA() or ProducerHeap()
+        void setDmaRingSize(uint32_t size) { dmaRingSize = std::min(std::max(size, kMinDmaRingSize), ipc::kMaxRingImages); }
 
         // Add to producer_app.hpp
         std::shared_ptr<vst::memory::ShmVideoHandler> getShmVideoHandler() const
@@ -92,28 +128,43 @@ namespace vst
         Pipeline pipeline;
         std::string mode;
         std::string shmName;
+        std::string shmSocketPath; // Hands out the segment fd, memfd SHM video only
         std::string windowTitle;
         cv::VideoCapture cap;
         vst::utils::ImageSize imageData;
         std::atomic<bool> running = true;
 
         // dma socket connections validation variables
-        bool m_socketServerRunning = false;
-        int m_serverSocketFd = -1;
-        int m_dmaFd = -1; // Store the DMA-BUF file descriptor
-        uint32_t m_texWidth = 0;
-        uint32_t m_texHeight = 0;
+        std::vector<int> m_dmaFds; // Exported DMA-BUF fds, one per shared image
+        std::unique_ptr<ipc::ControlServer> m_controlServer; // Serves consumers from its own epoll thread
+        sync::SyncManager m_sync;                            // Signals consumers when each upload lands
+        int m_syncFd = -1;                                   // Exported timeline semaphore, timeline mode only
+
+        void closeDmaSocket();
+        VkDescriptorSet currentDescriptorSet() const;
 
         // Video variables
         VulkanContext &context;
         std::unique_ptr<VideoLoader> videoLoader;
         std::unique_ptr<TextureVideo> videoTexture;
+        uint32_t dmaRingSize = 3;
+        std::vector<std::unique_ptr<TextureVideo>> videoRing; // Exported DMA-BUF video images
+        ColorConvertPipeline colorConvert;                    // Expands decoded BGR frames on the GPU
+        std::vector<DescriptorManager> ringDescriptors;       // One descriptor set per ring image
+        uint32_t ringIndex = 0;                               // Ring image holding the latest frame
+        std::vector<memory::DmaBuffer> heapRing;              // DMA-BUF heap buffers, heap mode only
+        cv::Size heapFrameSize;
+        size_t heapRowPitch = 0;
         std::shared_ptr<memory::ShmVideoHandler> shmVideoHandler;
+        memory::BackpressurePolicy backpressurePolicy = memory::BackpressurePolicy::LatestOnly;
+        memory::ShmVideoOptions shmVideoOptions;
+        memory::ShmPixelFormat shmPixelFormat = memory::ShmPixelFormat::RGBA8;
         bool videoEnded = false;
 
         VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
         DescriptorManager descriptorManager;
+        TextureImage imageTexture; // Image mode only
         VkBuffer vertexBuffer = VK_NULL_HANDLE;
-        VkDeviceMemory vertexBufferMemory = VK_NULL_HANDLE;
+        memory::Allocation vertexBufferAllocation;
     };
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+namespace vst
+{
+
+    // Raw frame layouts the compute conversion reads; the values are pushed to the shader
+    enum class SourceFormat : uint32_t
+    {
+        BGR24 = 0, // Packed 8-bit B, G, R, as OpenCV decodes
+        NV12 = 1,  // Y plane, then interleaved UV at half resolution
+        I420 = 2   // Y plane, then U and V planes at half resolution
+    };
+
+    /**
+     * @brief Compute pipeline that turns a raw frame into an RGBA8 image
+     *
+     * Producers copy decoder output into a storage buffer as is and one
+     * dispatch expands it into the texture, so no colour conversion runs on
+     * the CPU. The target image needs VK_IMAGE_USAGE_STORAGE_BIT and must be
+     * in VK_IMAGE_LAYOUT_GENERAL; barriers are left to the caller.
+     */
+    class ColorConvertPipeline
+    {
+    public:
+        ColorConvertPipeline();
+        ~ColorConvertPipeline();
+
+        void create(VkDevice device, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+        void cleanup(VkDevice device);
+
+        /**
+         * @brief Points a set allocated with getDescriptorSetLayout() at a source buffer and target image
+         */
+        void updateDescriptorSet(VkDevice device, VkDescriptorSet set, VkBuffer source, VkImageView target) const;
+
+        /**
+         * @brief Records the conversion of one width x height frame
+         *
+         * @param rowStride Bytes between rows of the Y or packed plane, 0 for
+         *        tightly packed rows. NV12 chroma rows are rowStride apart and
+         *        I420 ones rowStride / 2, as in an SHM video slot.
+         */
+        void record(VkCommandBuffer cmd, VkDescriptorSet set, SourceFormat format, uint32_t width, uint32_t height,
+                    uint32_t rowStride = 0) const;
+
+        // Bytes one frame of this format occupies in the source buffer
+        static VkDeviceSize sourceSize(SourceFormat format, uint32_t width, uint32_t height);
+
+        VkPipeline get() const { return computePipeline; }
+        VkPipelineLayout getLayout() const { return pipelineLayout; }
+        VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+
+    private:
+        VkPipeline computePipeline = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    };
+
+} // namespace vst
@@ -12,7 +12,8 @@ namespace vst
         Pipeline();
         ~Pipeline();
 
-        void create(VkDevice device, VkExtent2D extent, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout);
+        void create(VkDevice device, VkExtent2D extent, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout,
+                    VkPipelineCache pipelineCache = VK_NULL_HANDLE);
         void cleanup(VkDevice device);
 
         VkPipeline get() const { return graphicsPipeline; }
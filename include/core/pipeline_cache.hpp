@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <string>
+
+namespace vst
+{
+
+    /**
+     * @brief VkPipelineCache persisted across runs
+     *
+     * The cache lives in $XDG_CACHE_HOME/VulkanSharedTextures (or
+     * ~/.cache/VulkanSharedTextures), one file per pipelineCacheUUID and
+     * driver version, so a driver update or another GPU starts a fresh file
+     * instead of feeding the driver stale data. Failing to read or write the
+     * file is not fatal; pipelines are then simply compiled from scratch.
+     */
+    class PipelineCache
+    {
+    public:
+        PipelineCache();
+        ~PipelineCache();
+
+        /**
+         * @brief Creates the cache, seeded from disk when a matching file exists
+         */
+        void load(VkDevice device, VkPhysicalDevice physicalDevice);
+
+        /**
+         * @brief Writes the cache back to disk if pipelines were added since load()
+         */
+        void save();
+        void destroy();
+
+        VkPipelineCache get() const { return cache; }
+
+    private:
+        static std::string cacheDirectory();
+
+        VkDevice device = VK_NULL_HANDLE;
+        VkPipelineCache cache = VK_NULL_HANDLE;
+        VkPhysicalDeviceProperties properties{};
+        std::string path;
+        size_t loadedSize = 0;
+    };
+
+} // namespace vst
@@ -7,32 +7,52 @@
 namespace vst
 {
 
+    // How frames reach the display
+    enum class PresentProfile
+    {
+        VSync,     // FIFO: never tears, but queued images add up to a vblank each of latency
+        LowLatency // MAILBOX if supported, otherwise IMMEDIATE; falls back to FIFO
+    };
+
     class Swapchain
     {
     public:
         Swapchain();
         ~Swapchain();
 
-        void init(VkPhysicalDevice physicalDevice, VkDevice device, GLFWwindow *window, VkSurfaceKHR surface);
+        /**
+         * @brief Creates the swapchain from what the surface supports
+         *
+         * The image count, extent and transform come from the surface
+         * capabilities. The low-latency profile keeps the fewest images its
+         * present mode allows.
+         */
+        void init(VkPhysicalDevice physicalDevice, VkDevice device, GLFWwindow *window, VkSurfaceKHR surface,
+                  PresentProfile profile = PresentProfile::VSync);
         void cleanup();
 
         VkSwapchainKHR getSwapchain() const { return swapchain; }
         VkFormat getImageFormat() const { return imageFormat; }
         VkExtent2D getExtent() const { return extent; }
+        VkPresentModeKHR getPresentMode() const { return presentMode; }
         const std::vector<VkImageView> &getImageViews() const { return imageViews; }
 
     private:
         void createSwapchain();
         void createImageViews();
+        VkPresentModeKHR choosePresentMode() const;
+        VkExtent2D chooseExtent(const VkSurfaceCapabilitiesKHR &capabilities) const;
 
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
         VkDevice device = VK_NULL_HANDLE;
         VkSurfaceKHR surface = VK_NULL_HANDLE;
         GLFWwindow *window = nullptr;
+        PresentProfile profile = PresentProfile::VSync;
 
         VkSwapchainKHR swapchain = VK_NULL_HANDLE;
-        VkFormat imageFormat;
-        VkExtent2D extent;
+        VkFormat imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+        VkExtent2D extent{};
+        VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
         std::vector<VkImage> images;
         std::vector<VkImageView> imageViews;
     };
@@ -4,8 +4,12 @@
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <string>
+#include <chrono>
 #include "core/vulkan_device.hpp"
 #include "core/swapchain.hpp"
+#include "core/vulkan_utils.hpp"
+#include "core/pipeline_cache.hpp"
+#include "memory/device_allocator.hpp"
 
 namespace vst
 {
@@ -15,44 +19,165 @@ namespace vst
         VulkanContext();
         ~VulkanContext();
 
-        void init(GLFWwindow *window);
+        // Frames the CPU may queue ahead of the GPU
+        static constexpr uint32_t kMaxFramesInFlight = 2;
+
+        /**
+         * @brief Creates the device and swapchain for window
+         *
+         * The low-latency profile also turns on frame pacing when it gets a
+         * present mode that does not block on vblank.
+         */
+        void init(GLFWwindow *window, PresentProfile presentProfile = PresentProfile::VSync);
+
+        /**
+         * @brief Creates the device without a window, surface or swapchain
+         *
+         * Any device with a graphics queue and external memory will do,
+         * including software drivers such as lavapipe. drawFrame() renders
+         * into kMaxFramesInFlight offscreen images of width x height that are
+         * never read back, so the upload, export and import paths run
+         * unchanged and drawing is not limited by a display.
+         */
+        void initHeadless(uint32_t width, uint32_t height);
+        bool isHeadless() const { return headless; }
         void setupRenderPass();
         void createFramebuffers();
         void cleanup();
 
-        void drawFrame(VkPipeline pipeline, VkPipelineLayout layout, VkDescriptorSet descriptorSet, VkBuffer vertexBuffer);
+        /**
+         * @brief Rebuilds the swapchain, framebuffers and recorded draws, e.g. after VK_ERROR_OUT_OF_DATE_KHR
+         *
+         * Blocks while the window is minimised. Does nothing when headless.
+         */
+        void recreateSwapchain();
+
+        /**
+         * @brief Sleeps until shortly before the next frame is due
+         *
+         * Call before choosing what drawFrame() will sample, so the newest
+         * shared frame is picked as late as possible. Without a vblank-bound
+         * present mode this also caps drawing at the display refresh rate.
+         * Does nothing unless pacing is enabled.
+         */
+        void paceFrame();
+        void setFramePacing(bool enabled) { framePacing = enabled; }
+        bool isFramePacing() const { return framePacing; }
+
+        /**
+         * @brief Submits and presents one frame
+         *
+         * Up to kMaxFramesInFlight frames are queued before this blocks.
+         * The draw for each swapchain image is recorded once per set of
+         * inputs and resubmitted as long as they stay the same. A frame
+         * whose acquire reports an out of date swapchain is dropped after
+         * the swapchain is recreated. Headless contexts submit the same draw
+         * into an offscreen image and present nothing.
+         *
+         * @param waitSemaphore Optional extra semaphore the draw waits on, e.g. a producer upload
+         * @param waitValue Value to wait for if waitSemaphore is a timeline semaphore, 0 otherwise
+         */
+        void drawFrame(VkPipeline pipeline, VkPipelineLayout layout, VkDescriptorSet descriptorSet, VkBuffer vertexBuffer,
+                       VkSemaphore waitSemaphore = VK_NULL_HANDLE, uint64_t waitValue = 0);
         VkInstance getInstance() const { return instance; }
         VkDevice getDevice() const { return device.getDevice(); }
         VkPhysicalDevice getPhysicalDevice() const { return device.getPhysicalDevice(); }
         VkCommandPool getCommandPool() const { return commandPool; }
         VkQueue getGraphicsQueue() const { return device.getGraphicsQueue(); }
-        VkExtent2D getSwapchainExtent() const { return swapchain.getExtent(); }
+        uint32_t getGraphicsQueueFamily() const { return device.getQueueFamilies().graphicsFamily; }
+        VkQueue getTransferQueue() const { return device.getTransferQueue(); }
+        uint32_t getTransferQueueFamily() const { return device.getQueueFamilies().transferFamily; }
+        VkCommandPool getTransferCommandPool() const { return transferCommandPool ? transferCommandPool : commandPool; }
+        VkQueue getComputeQueue() const { return device.getComputeQueue(); }
+        uint32_t getComputeQueueFamily() const { return device.getQueueFamilies().computeFamily; }
+        vulkan_utils::SubmitQueue getGraphicsSubmitQueue() const { return {getGraphicsQueue(), getGraphicsQueueFamily(), commandPool}; }
+        vulkan_utils::SubmitQueue getTransferSubmitQueue() const { return {getTransferQueue(), getTransferQueueFamily(), getTransferCommandPool()}; }
+        // Size of the offscreen images when headless
+        VkExtent2D getSwapchainExtent() const { return headless ? offscreenExtent : swapchain.getExtent(); }
         VkRenderPass getRenderPass() const { return renderPass; }
+        bool hasExternalSemaphoreFd() const { return device.hasExternalSemaphoreFd(); }
+        bool hasTimelineSemaphores() const { return device.hasTimelineSemaphores(); }
+        bool hasExternalMemoryHost() const { return device.hasExternalMemoryHost(); }
+        memory::DeviceAllocator &getAllocator() { return allocator; }
+        VkPipelineCache getPipelineCache() const { return pipelineCache.get(); }
+        // Persists newly compiled pipelines now rather than only at cleanup
+        void savePipelineCache() { pipelineCache.save(); }
 
     private:
+        // A recorded draw and the inputs it was recorded with
+        struct RecordedDraw
+        {
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            VkPipelineLayout layout = VK_NULL_HANDLE;
+            VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+            VkBuffer vertexBuffer = VK_NULL_HANDLE;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+            bool matches(const RecordedDraw &other) const
+            {
+                return pipeline == other.pipeline && layout == other.layout &&
+                       descriptorSet == other.descriptorSet && vertexBuffer == other.vertexBuffer;
+            }
+        };
+        // Recorded draws kept per swapchain image; one per image of the largest DMA-BUF ring (ipc::kMaxRingImages)
+        static constexpr uint32_t kDrawsPerImage = 4;
+
         void createInstance();
         void createSurface(GLFWwindow *window);
         void pickDeviceAndCreateLogical();
         void setupSwapchain(GLFWwindow *window);
+        void createOffscreenTargets(uint32_t width, uint32_t height);
+        void destroyOffscreenTargets();
+        void destroyFramebuffers();
+        void destroyImageSyncObjects();
+        VkCommandBuffer getDrawCommandBuffer(uint32_t imageIndex, const RecordedDraw &inputs);
+        void recordDraw(uint32_t imageIndex, const RecordedDraw &draw);
 
+        GLFWwindow *window = nullptr;
+        int windowWidth = 0; // Framebuffer size the swapchain was last created for
+        int windowHeight = 0;
+        PresentProfile presentProfile = PresentProfile::VSync;
         VkInstance instance = VK_NULL_HANDLE;
         VkSurfaceKHR surface = VK_NULL_HANDLE;
         VkRenderPass renderPass = VK_NULL_HANDLE;
         std::vector<VkFramebuffer> framebuffers;
 
+        // Headless render targets, one per frame in flight, in place of the swapchain images
+        bool headless = false;
+        VkExtent2D offscreenExtent{};
+        std::vector<VkImage> offscreenImages;
+        std::vector<memory::Allocation> offscreenAllocations;
+        std::vector<VkImageView> offscreenImageViews;
+
         VkCommandPool commandPool = VK_NULL_HANDLE;
-        std::vector<VkCommandBuffer> commandBuffers;
+        VkCommandPool transferCommandPool = VK_NULL_HANDLE; // Only with a dedicated transfer family
+        std::vector<std::vector<RecordedDraw>> recordedDraws; // Per swapchain image
+        std::vector<uint32_t> nextEvictedDraw;                // Per swapchain image, round robin once full
+
+        // Per frame in flight
+        std::vector<VkSemaphore> imageAvailableSemaphores;
+        std::vector<VkFence> inFlightFences;
+        uint32_t currentFrame = 0;
+
+        // Per swapchain image
+        std::vector<VkSemaphore> renderFinishedSemaphores;
+        std::vector<VkFence> imagesInFlight; // Fence of the frame that last rendered to each image
 
-        VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
-        VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
-        VkFence inFlightFence = VK_NULL_HANDLE;
+        // Frame pacing, see paceFrame()
+        static constexpr std::chrono::microseconds kPacingSlack{2000}; // Left for recording, submission and present
+        bool framePacing = false;
+        std::chrono::steady_clock::duration refreshPeriod = std::chrono::microseconds(16667);
+        std::chrono::steady_clock::time_point nextFrameDue{};
 
         VulkanDevice device;
         Swapchain swapchain;
+        memory::DeviceAllocator allocator; // Buffers and textures are sub-allocated from here
+        PipelineCache pipelineCache;
 
         void createCommandPool();
         void createCommandBuffers();
         void createSyncObjects();
+        void createImageSyncObjects();
     };
 
 } // namespace vst
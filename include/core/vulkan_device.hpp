@@ -11,7 +11,12 @@ namespace vst
     struct QueueFamilyIndices
     {
         uint32_t graphicsFamily = -1;
+        // Dedicated families where the device has them, otherwise the graphics family
+        uint32_t transferFamily = -1;
+        uint32_t computeFamily = -1;
         bool isComplete() const { return graphicsFamily != -1; }
+        bool hasDedicatedTransfer() const { return transferFamily != graphicsFamily; }
+        bool hasDedicatedCompute() const { return computeFamily != graphicsFamily; }
     };
 
     class VulkanDevice
@@ -20,22 +25,43 @@ namespace vst
         VulkanDevice();
         ~VulkanDevice();
 
-        void pickPhysicalDevice(VkInstance instance);
+        /**
+         * @brief Picks the first device with a graphics queue and the required extensions
+         *
+         * @param presentation Whether VK_KHR_swapchain is needed; headless contexts pass false
+         */
+        void pickPhysicalDevice(VkInstance instance, bool presentation = true);
         void createLogicalDevice();
 
         VkPhysicalDevice getPhysicalDevice() const { return physicalDevice; }
         VkDevice getDevice() const { return device; }
         QueueFamilyIndices getQueueFamilies() const { return queueFamilies; }
         VkQueue getGraphicsQueue() const { return graphicsQueue; }
+        VkQueue getTransferQueue() const { return transferQueue; }
+        VkQueue getComputeQueue() const { return computeQueue; }
+        bool hasExternalSemaphoreFd() const { return externalSemaphoreFd; }
+        bool hasTimelineSemaphores() const { return timelineSemaphores; }
+        bool hasExternalMemoryHost() const { return externalMemoryHost; }
 
     private:
         bool isDeviceSuitable(VkPhysicalDevice device);
+        bool isExtensionSupported(const char *name) const;
+        static bool isExtensionSupported(VkPhysicalDevice device, const char *name);
+        std::vector<const char *> requiredExtensions() const;
 
         VkInstance instance = VK_NULL_HANDLE;
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
         VkDevice device = VK_NULL_HANDLE;
         QueueFamilyIndices queueFamilies;
+        bool presentation = true;
         VkQueue graphicsQueue = VK_NULL_HANDLE;
+        VkQueue transferQueue = VK_NULL_HANDLE;
+        VkQueue computeQueue = VK_NULL_HANDLE;
+
+        // Optional features, enabled when the device has them
+        bool externalSemaphoreFd = false;
+        bool timelineSemaphores = false;
+        bool externalMemoryHost = false;
     };
 
 } // namespace vst
@@ -1,10 +1,20 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include "memory/device_allocator.hpp"
+#include <cstddef>
 
 namespace vst::vulkan_utils
 {
 
+    // A queue with its family and a command pool created for that family
+    struct SubmitQueue
+    {
+        VkQueue queue = VK_NULL_HANDLE;
+        uint32_t family = VK_QUEUE_FAMILY_IGNORED;
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+    };
+
     uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
     
     void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size,
@@ -15,6 +25,25 @@ namespace vst::vulkan_utils
     void createImage(VkDevice device, VkPhysicalDevice physicalDevice, int width, int height,
                      VkImage &image, VkDeviceMemory &memory, bool exportMemory);
 
+    /**
+     * @brief Creates a buffer backed by a sub-allocation instead of its own VkDeviceMemory
+     *
+     * Host-visible allocations come back mapped in allocation.mapped.
+     */
+    void createBuffer(memory::DeviceAllocator &allocator, VkDeviceSize size,
+                      VkBuffer &buffer, memory::Allocation &allocation,
+                      VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                      memory::AllocationUsage allocationUsage = memory::AllocationUsage::Persistent);
+
+    /**
+     * @brief Creates an RGBA8 image backed by a sub-allocation, or by exportable memory of its own
+     */
+    void createImage(memory::DeviceAllocator &allocator, int width, int height,
+                     VkImage &image, memory::Allocation &allocation, bool exportMemory);
+
+    // Destroys a buffer from the allocator overload of createBuffer and returns its memory
+    void destroyBuffer(memory::DeviceAllocator &allocator, VkBuffer &buffer, memory::Allocation &allocation);
+
     VkImageView createImageView(VkDevice device, VkImage image);
 
     void transitionImageLayout(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue,
@@ -22,7 +51,33 @@ namespace vst::vulkan_utils
 
     VkSampler createSampler(VkDevice device);
 
+    // codeSize is in bytes, as for VkShaderModuleCreateInfo
+    VkShaderModule createShaderModule(VkDevice device, const uint32_t *code, size_t codeSize);
+
     void copyBufferToImage(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue,
                            VkBuffer buffer, VkImage image, int width, int height);
 
+    /**
+     * @brief Records one half of a queue family ownership transfer for an image
+     *
+     * The release half is recorded for the srcFamily queue and the acquire
+     * half for the dstFamily queue, with identical families and layouts; a
+     * semaphore must order the two submissions.
+     *
+     * @param stage Stage that wrote the image (release) or will use it (acquire)
+     * @param access Matching access mask
+     */
+    void recordOwnershipBarrier(VkCommandBuffer cmd, VkImage image, uint32_t srcFamily, uint32_t dstFamily,
+                                VkImageLayout oldLayout, VkImageLayout newLayout,
+                                VkPipelineStageFlags stage, VkAccessFlags access, bool release);
+
+    /**
+     * @brief Fills an image from a buffer on the transfer queue, leaving it sampleable on the graphics queue
+     *
+     * Falls back to a single submission when both queues share a family.
+     * Blocks until the image is ready; meant for one-off loads.
+     */
+    void uploadBufferToImage(VkDevice device, const SubmitQueue &graphics, const SubmitQueue &transfer,
+                             VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+
 } // namespace vst::vulkan_utils
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <vector>
+
+namespace vst::ipc
+{
+
+    // Control channel between a DMA-BUF producer and its consumers. Every
+    // message is one SOCK_SEQPACKET record: a ControlMessageHeader followed by
+    // payloadSize bytes. The connection stays open for the whole session.
+    constexpr uint32_t kControlMagic = 0x43545356; // "VSTC"
+    constexpr uint16_t kControlProtocolVersion = 3;
+    constexpr uint32_t kMaxControlPayload = 4096;
+    constexpr uint32_t kMaxImagePlanes = 4;
+    constexpr uint32_t kMaxRingImages = 4; // Also the most fds one message can carry
+    constexpr uint64_t kDrmFormatModInvalid = 0x00ffffffffffffffull;
+
+    enum class ControlMessageType : uint16_t
+    {
+        ImageDesc = 1,  // ImageDescription, carries one DMA-BUF fd per ring image
+        FrameReady = 2, // FrameReady
+        Bye = 3,        // No payload; the sender is going away
+        SyncDesc = 4    // SyncDescription, carries the shared semaphore fd in timeline mode
+    };
+
+    struct ControlMessageHeader
+    {
+        uint32_t magic;       // kControlMagic
+        uint16_t version;     // kControlProtocolVersion of the sender
+        uint16_t type;        // ControlMessageType
+        uint32_t payloadSize; // Bytes following this header
+        uint32_t reserved;
+    };
+
+    /**
+     * @brief Everything a consumer needs to import the shared images
+     *
+     * The producer shares a ring of imageCount identically created images;
+     * their fds travel with this message in ring order.
+     *
+     * Plane offsets and row pitches are only meaningful for linear images or
+     * images with an explicit DRM modifier; for implicit optimal tiling they
+     * are zero and the consumer must recreate the image with the same create
+     * parameters on the same device.
+     */
+    struct ImageDescription
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;              // VkFormat
+        uint32_t tiling;              // VkImageTiling
+        uint64_t drmModifier;         // DRM format modifier, kDrmFormatModInvalid if implicit
+        uint64_t allocationSize;      // Size of the exported allocation in bytes
+        uint32_t memoryTypeIndex;     // Memory type the producer allocated from
+        uint32_t memoryPropertyFlags; // VkMemoryPropertyFlags of that memory type
+        uint32_t planeCount;
+        uint32_t imageCount;          // Number of images in the ring (1..kMaxRingImages)
+        uint64_t planeOffsets[kMaxImagePlanes];
+        uint64_t planeRowPitches[kMaxImagePlanes];
+        uint8_t deviceUuid[16]; // VkPhysicalDeviceIDProperties::deviceUUID of the producer
+    };
+
+    struct FrameReady
+    {
+        uint64_t frameIndex;  // Producer frame counter
+        uint64_t timestampNs; // CLOCK_MONOTONIC when the frame was complete
+        uint32_t imageIndex;  // Ring image now holding the latest frame
+        uint32_t reserved;
+        uint64_t signalValue; // Timeline value the upload signals, 0 if not timeline
+    };
+
+    /**
+     * @brief How consumers order their draws after the producer's uploads
+     *
+     * Sent right after IMAGE_DESC. In timeline mode the shared semaphore fd
+     * travels with this message; in sync fd mode each FRAME_READY carries a
+     * sync_file fd for its upload instead.
+     */
+    struct SyncDescription
+    {
+        uint32_t mode; // sync::SyncMode
+        uint32_t reserved;
+    };
+
+    int setup_control_server_socket(const std::string &path, int backlog = 8);
+    int connect_control_socket(const std::string &path);
+
+    /**
+     * @brief Sends one framed message, optionally passing file descriptors
+     *
+     * All fds go in a single sendmsg, so they arrive together with the payload.
+     *
+     * @return 0 on success, -1 on error (including a disconnected peer)
+     */
+    int send_control_message(int socket_fd, ControlMessageType type, const void *payload, uint32_t payloadSize,
+                             const int *fds_to_send = nullptr, uint32_t fdCount = 0);
+
+    /**
+     * @brief Receives one framed message
+     *
+     * Payloads shorter than the caller's buffer (an older peer) are
+     * zero-extended; longer ones (a newer peer) are truncated. Passed fds are
+     * returned through received_fds, or closed when received_fds is null.
+     *
+     * @return 0 on success, -1 with errno set otherwise (EAGAIN on an empty
+     *         non-blocking socket, ECONNRESET once the peer closed, EPROTO for
+     *         a malformed message)
+     */
+    int receive_control_message(int socket_fd, ControlMessageType &type, void *payload, uint32_t payloadCapacity,
+                                std::vector<int> *received_fds = nullptr);
+
+    // Sends desc.imageCount fds from image_fds along with the description
+    int send_image_description(int socket_fd, const ImageDescription &desc, const int *image_fds);
+    int send_sync_description(int socket_fd, const SyncDescription &desc, int semaphore_fd = -1);
+    // sync_fd, if not -1, is passed along for the consumer to wait on
+    int send_frame_ready(int socket_fd, const FrameReady &frame, int sync_fd = -1);
+    int send_bye(int socket_fd);
+
+} // namespace vst::ipc
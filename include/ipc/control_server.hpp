@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ipc/control_protocol.hpp"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vst::ipc
+{
+
+    /**
+     * @brief Serves the DMA-BUF control socket from its own epoll thread
+     *
+     * Accepts any number of consumers, sends each one the image description
+     * and fd, forwards frame notifications and notices disconnects. The
+     * render thread only ever calls notifyFrameReady(), which is a store and
+     * an eventfd write.
+     */
+    class ControlServer
+    {
+    public:
+        ControlServer() = default;
+        ~ControlServer();
+
+        ControlServer(const ControlServer &) = delete;
+        ControlServer &operator=(const ControlServer &) = delete;
+
+        /**
+         * @brief Binds the socket and starts the IPC thread
+         *
+         * @param socketPath Filesystem path of the Unix socket
+         * @param desc Description sent to every consumer on connect
+         * @param imageFds One DMA-BUF fd per ring image, passed with the description; not owned
+         * @return true if the server is running
+         */
+        bool start(const std::string &socketPath, const ImageDescription &desc, const std::vector<int> &imageFds);
+
+        /**
+         * @brief Sets what consumers are told about upload synchronisation; call before start()
+         *
+         * @param semaphoreFd Shared timeline semaphore sent with the description, or -1; not owned
+         */
+        void setSyncDescription(const SyncDescription &desc, int semaphoreFd);
+
+        /**
+         * @brief Says goodbye to every consumer and stops the IPC thread
+         */
+        void stop();
+
+        /**
+         * @brief Queues a frame-ready notification for every consumer
+         *
+         * Only the newest pending frame is sent; a consumer does not need to
+         * hear about frames that were already overwritten. Consumers that
+         * connect later are told the current image straight away.
+         *
+         * @param signalValue Timeline value the upload of this frame signals, 0 if none
+         * @param syncFd sync_file fd of the upload passed to every consumer, or -1; ownership is taken
+         */
+        void notifyFrameReady(uint64_t frameIndex, uint32_t imageIndex, uint64_t timestampNs,
+                              uint64_t signalValue = 0, int syncFd = -1);
+
+        bool isRunning() const { return m_running; }
+        size_t clientCount() const { return m_clientCount; }
+
+    private:
+        void run();
+        void acceptClients();
+        void handleClient(int clientFd, uint32_t events);
+        void dropClient(int clientFd);
+        void broadcastFrameReady();
+
+        std::thread m_thread;
+        std::atomic<bool> m_running{false};
+        int m_listenFd = -1;
+        int m_epollFd = -1;
+        int m_wakeFd = -1; // eventfd: frame notifications and shutdown
+
+        ImageDescription m_desc{};
+        std::vector<int> m_imageFds;
+        SyncDescription m_sync{};
+        int m_semaphoreFd = -1;
+
+        // Only touched by the IPC thread
+        std::vector<int> m_clients;
+        std::atomic<size_t> m_clientCount{0};
+
+        std::mutex m_frameMutex;
+        FrameReady m_pendingFrame{};
+        bool m_framePending = false;
+        int m_pendingSyncFd = -1;
+        FrameReady m_lastFrame{}; // IPC thread only
+        bool m_haveLastFrame = false;
+        int m_lastSyncFd = -1; // Kept so late joiners can wait on the current image too
+    };
+
+} // namespace vst::ipc
@@ -3,6 +3,7 @@
 #include <vulkan/vulkan.h>
 #include <string>
 #include "media/texture_image.hpp"
+#include "core/vulkan_utils.hpp"
 
 namespace vst
 {
@@ -16,6 +17,16 @@ namespace vst
                                         VkCommandPool commandPool,
                                         VkQueue graphicsQueue,
                                         bool exportMemory = false);
+
+        // Runs the copy on the transfer queue and hands the image to the graphics queue.
+        // With an allocator the staging buffer and image are sub-allocated from it.
+        static TextureImage loadTexture(const std::string &path,
+                                        VkDevice device,
+                                        VkPhysicalDevice physicalDevice,
+                                        const vulkan_utils::SubmitQueue &graphics,
+                                        const vulkan_utils::SubmitQueue &transfer,
+                                        bool exportMemory = false,
+                                        memory::DeviceAllocator *allocator = nullptr);
     };
 
 } // namespace vst
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "core/color_convert_pipeline.hpp"
+#include "memory/device_allocator.hpp"
+#include "memory/shm_video_handler.hpp"
+#include <vector>
+
+namespace vst
+{
+    class VulkanContext;
+
+    /**
+     * @brief RGBA8 texture fed from the frame slots of an SHM video segment
+     *
+     * With VK_EXT_external_memory_host every slot of the mapped segment is
+     * imported once as a VkBuffer, and frames are read by the GPU straight
+     * from shared memory. Otherwise, or when the driver refuses the import,
+     * each frame is first copied into a persistently mapped staging buffer.
+     * RGBA8 frames are copied into the image, only their dirty tiles when a
+     * frame directly follows the last one uploaded. BGR8, NV12 and I420
+     * frames are expanded by a ColorConvertPipeline.
+     */
+    class ShmTexture
+    {
+    public:
+        ShmTexture(VulkanContext &ctx);
+        ~ShmTexture();
+
+        /**
+         * @brief Converts BGR8, NV12 and I420 segments on the GPU
+         *
+         * Must be called before create(); without a converter only RGBA8
+         * segments can be uploaded. The pipeline must outlive this texture.
+         */
+        void setColorConverter(const ColorConvertPipeline *converter) { m_converter = converter; }
+
+        /**
+         * @brief Creates the image and imports the slots of handler's segment
+         *
+         * The segment must stay open until destroy().
+         */
+        void create(memory::ShmVideoHandler &handler);
+
+        /**
+         * @brief Queues the copy of a leased frame into the image
+         *
+         * Takes over the lease and keeps the slot pinned until the GPU has
+         * read it, which later uploads notice without waiting. Only blocks
+         * when every upload slot is still in flight. Draws submitted to the
+         * graphics queue afterwards see the new frame in
+         * SHADER_READ_ONLY_OPTIMAL.
+         */
+        void upload(memory::ShmVideoFrameLease &&lease);
+
+        // Waits for every queued upload and releases the leases they held
+        void waitIdle();
+        void destroy();
+
+        VkImage getImage() const { return image; }
+        VkImageView getImageView() const { return imageView; }
+        uint32_t getWidth() const { return texWidth; }
+        uint32_t getHeight() const { return texHeight; }
+        bool isImportingHostMemory() const { return !m_slotBuffers.empty(); }
+
+    private:
+        void createImage(VkImageUsageFlags usage);
+        void createUploadRing();
+        // Imports every slot; false if any slot cannot be imported, leaving none imported
+        bool importSlots(const memory::ShmVideoHandler &handler);
+        void releaseSlots();
+        // Unpins the slots of uploads the GPU has finished with
+        void releaseFinishedUploads();
+        // Fills m_regions with the dirty tiles of lease, or one region for the whole frame
+        void collectRegions(const memory::ShmVideoFrameLease &lease);
+        VkDescriptorSet allocateConvertSet(VkBuffer source);
+
+        VulkanContext &context;
+        VkImage image = VK_NULL_HANDLE;
+        memory::Allocation m_imageAllocation;
+        VkImageView imageView = VK_NULL_HANDLE;
+        VkImageLayout m_currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        uint32_t texWidth = 0;
+        uint32_t texHeight = 0;
+        VkDeviceSize m_frameSize = 0; // Bytes of one frame in a slot, row padding included
+        uint64_t m_lastFrameSeq = 0;  // frameSeq() of the frame the image holds, 0 before the first upload
+        std::vector<VkBufferImageCopy> m_regions;
+
+        // GPU colour conversion of non-RGBA8 segments; the image is then written in GENERAL
+        const ColorConvertPipeline *m_converter = nullptr;
+        bool m_convert = false;
+        SourceFormat m_sourceFormat = SourceFormat::BGR24;
+        VkDescriptorPool m_convertPool = VK_NULL_HANDLE;
+
+        // One imported buffer per slot when host memory can be imported
+        std::vector<VkBuffer> m_slotBuffers;
+        std::vector<VkDeviceMemory> m_slotMemories;
+        std::vector<VkDescriptorSet> m_slotConvertSets; // Imported slot -> image, converting only
+
+        // Upload ring: one command buffer and fence per upload in flight. An upload
+        // reading an imported slot keeps its lease until the fence signals.
+        struct UploadSlot
+        {
+            VkBuffer staging = VK_NULL_HANDLE; // Staging fallback only
+            memory::Allocation stagingAllocation;
+            VkDescriptorSet convertSet = VK_NULL_HANDLE; // Staging buffer -> image, converting only
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            VkFence fence = VK_NULL_HANDLE;    // Signalled when the slot is free
+            memory::ShmVideoFrameLease lease;  // Frame the queued upload reads
+        };
+        static constexpr uint32_t kUploadSlots = 2;
+        VkCommandPool m_commandPool = VK_NULL_HANDLE;
+        std::vector<UploadSlot> m_uploadSlots;
+        uint32_t m_nextUploadSlot = 0;
+    };
+
+} // namespace vst
@@ -2,6 +2,7 @@
 
 #include <vulkan/vulkan.h>
 #include <cstdint>
+#include "memory/device_allocator.hpp"
 
 namespace vst
 {
@@ -16,12 +17,16 @@ namespace vst
             VkCommandPool commandPool,
             VkQueue graphicsQueue,
             const uint8_t *newData);
-        static void destroy(VkDevice device, TextureImage &texture);
+        /**
+         * @brief Destroys the image; memory from an allocator is returned to it instead of freed
+         */
+        static void destroy(VkDevice device, TextureImage &texture, memory::DeviceAllocator *allocator = nullptr);
         VkSampler getSampler() const { return sampler; }
         bool isInitialized() const { return image != VK_NULL_HANDLE; }
 
         VkImage image;
         VkDeviceMemory memory;
+        memory::Allocation allocation; // Set when memory came from a DeviceAllocator
         VkSampler sampler = VK_NULL_HANDLE;
         VkImageView view;
         int width;
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include "core/color_convert_pipeline.hpp"
+#include "memory/device_allocator.hpp"
 #include <opencv2/opencv.hpp>
 #include <memory>
+#include <vector>
 
 namespace vst
 {
@@ -14,8 +17,38 @@ namespace vst
         TextureVideo(VulkanContext &ctx);
         ~TextureVideo();
 
+        /**
+         * @brief Converts raw frames on the GPU from now on
+         *
+         * Must be called before createFromSize(), which then adds storage
+         * usage to the image. Without a converter frames are converted to
+         * RGBA on the CPU. The pipeline must outlive this texture.
+         */
+        void setColorConverter(const ColorConvertPipeline *converter) { m_converter = converter; }
+
         bool createFromSize(uint32_t width, uint32_t height);
-        void updateFromFrame(const cv::Mat &frame);
+        /**
+         * @brief Uploads a BGR or RGBA frame into the image
+         *
+         * The frame is written into the next slot of a persistently mapped
+         * staging ring and the copy is only submitted, so the next upload
+         * overlaps this one's use. A slot is reused once its fence signals.
+         * With a signal semaphore, other queues and processes learn from it
+         * when the copy is done; without one the call waits for the copy.
+         * BGR frames are copied as is and expanded by the colour converter
+         * when one is set.
+         *
+         * @param signalValue Value to signal if signalSemaphore is a timeline semaphore, 0 otherwise
+         */
+        void updateFromFrame(const cv::Mat &frame, VkSemaphore signalSemaphore = VK_NULL_HANDLE, uint64_t signalValue = 0);
+
+        /**
+         * @brief Uploads a planar YUV frame, stored as one CV_8UC1 matrix of height * 3 / 2 rows
+         *
+         * @param format SourceFormat::NV12 or SourceFormat::I420
+         */
+        void updateFromYuv(const cv::Mat &frame, SourceFormat format, VkSemaphore signalSemaphore = VK_NULL_HANDLE,
+                           uint64_t signalValue = 0);
         void destroy();
 
         // Accessor methods for internal members
@@ -33,14 +66,47 @@ namespace vst
 
     private:
         void createSampler();
+        void createUploadRing();
+        void destroyUploadRing();
+        // raw: frame is in format and still needs converting; otherwise it is RGBA
+        void submitUpload(const cv::Mat &frame, bool raw, SourceFormat format, VkSemaphore signalSemaphore, uint64_t signalValue);
 
         VulkanContext &context;
         VkImage image = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE; // m_imageAllocation.memory, kept for export
+        memory::Allocation m_imageAllocation;
         VkImageView imageView = VK_NULL_HANDLE;
         VkSampler sampler = VK_NULL_HANDLE;
         uint32_t texWidth = 0;
         uint32_t texHeight = 0;
         VkImageLayout m_currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        // Staging ring: one persistently mapped buffer, command buffer and fence per slot.
+        // With a dedicated transfer family the copy runs there and a prerecorded
+        // acquire on the graphics queue takes the image back.
+        struct UploadSlot
+        {
+            VkBuffer staging = VK_NULL_HANDLE;
+            memory::Allocation stagingAllocation;
+            void *mapped = nullptr;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;        // Transfer queue
+            VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE; // Graphics queue, dedicated transfer only
+            VkSemaphore copied = VK_NULL_HANDLE;                   // Transfer -> graphics, dedicated transfer only
+            VkDescriptorSet convertSet = VK_NULL_HANDLE;           // Staging buffer -> image, with a converter only
+            VkFence fence = VK_NULL_HANDLE;                        // Signalled when the slot is free
+        };
+        static constexpr uint32_t kUploadSlots = 2;
+        VkCommandPool m_uploadPool = VK_NULL_HANDLE;
+        VkCommandPool m_acquirePool = VK_NULL_HANDLE;
+        bool m_transferHandOver = false; // Uploads run on a different queue family than rendering
+
+        // GPU colour conversion; uploads then run on the compute family and write the image in GENERAL
+        const ColorConvertPipeline *m_converter = nullptr;
+        VkDescriptorPool m_convertPool = VK_NULL_HANDLE;
+        uint32_t m_uploadFamily = 0;
+        VkQueue m_uploadQueue = VK_NULL_HANDLE;
+        VkImageLayout m_writeLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL; // Layout uploads write the image in
+        std::vector<UploadSlot> m_uploadSlots;
+        uint32_t m_nextUploadSlot = 0;
     };
 }
\ No newline at end of file
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace vst::memory
+{
+
+    /**
+     * @brief Which pool an allocation is carved from
+     */
+    enum class AllocationUsage
+    {
+        Persistent, // Long-lived resources; buddy allocation inside large blocks
+        Transient,  // Short-lived staging; linear ring, freed roughly in allocation order
+        Exportable  // Shared over DMA-BUF; one dedicated VkDeviceMemory each, never shared with other resources
+    };
+
+    /**
+     * @brief A sub-range of a VkDeviceMemory block handed out by DeviceAllocator
+     */
+    struct Allocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void *mapped = nullptr; // Host pointer to offset, host-visible memory only
+        uint32_t blockId = 0;   // Owning block, internal to the allocator
+
+        bool isValid() const { return memory != VK_NULL_HANDLE; }
+    };
+
+    struct PoolStats
+    {
+        uint32_t blockCount = 0;        // VkDeviceMemory objects the pool holds
+        VkDeviceSize reservedBytes = 0; // Bytes of those objects
+        VkDeviceSize usedBytes = 0;     // Bytes handed out, including alignment padding
+        uint32_t allocationCount = 0;   // Live allocations
+    };
+
+    struct AllocatorStats
+    {
+        PoolStats persistent;
+        PoolStats transient;
+        PoolStats exportable;
+        uint64_t deviceAllocations = 0; // vkAllocateMemory calls so far
+        uint64_t subAllocations = 0;    // allocate() calls served so far
+        uint32_t maxMemoryAllocationCount = 0;
+    };
+
+    /**
+     * @brief Sub-allocates buffers and images from large VkDeviceMemory blocks
+     *
+     * Blocks are kept per memory type, and separately for linear (buffers)
+     * and optimal (images) resources so bufferImageGranularity never
+     * matters. Persistent allocations use a buddy allocator, transient ones
+     * a ring that is reclaimed as its oldest allocations are freed, and
+     * exportable ones get a dedicated allocation each since an exported fd
+     * exposes its whole VkDeviceMemory. Host-visible blocks are mapped once
+     * for their lifetime, so allocations must not be mapped again by callers.
+     *
+     * Requests that do not fit a block get a dedicated allocation.
+     */
+    class DeviceAllocator
+    {
+    public:
+        static constexpr VkDeviceSize kDefaultBlockSize = 64ull << 20;
+        static constexpr VkDeviceSize kDefaultRingSize = 32ull << 20;
+
+        DeviceAllocator() = default;
+        ~DeviceAllocator();
+
+        DeviceAllocator(const DeviceAllocator &) = delete;
+        DeviceAllocator &operator=(const DeviceAllocator &) = delete;
+
+        /**
+         * @brief Prepares the allocator; no memory is allocated until first use
+         *
+         * @param blockSize Size of persistent blocks, rounded up to a power of two
+         * @param ringSize Size of each transient ring
+         */
+        bool init(VkDevice device, VkPhysicalDevice physicalDevice,
+                  VkDeviceSize blockSize = kDefaultBlockSize, VkDeviceSize ringSize = kDefaultRingSize);
+
+        /**
+         * @brief Frees every block; all allocations become invalid
+         */
+        void destroy();
+
+        /**
+         * @brief Allocates memory for requirements and properties from the pool for usage
+         *
+         * @param linear Whether the resource is a buffer or linear image
+         * @return false if no memory type matches or the device is out of memory
+         */
+        bool allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties,
+                      AllocationUsage usage, bool linear, Allocation &allocation);
+
+        /**
+         * @brief Allocates and binds memory for a buffer
+         */
+        bool allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, AllocationUsage usage,
+                               Allocation &allocation);
+
+        /**
+         * @brief Allocates and binds memory for an optimally tiled image
+         *
+         * Exportable images must have been created with
+         * VkExternalMemoryImageCreateInfo for DMA-BUF handles.
+         */
+        bool allocateForImage(VkImage image, VkMemoryPropertyFlags properties, AllocationUsage usage,
+                              Allocation &allocation);
+
+        /**
+         * @brief Returns an allocation to its pool and resets it
+         */
+        void free(Allocation &allocation);
+
+        AllocatorStats getStats() const;
+        void logStats() const;
+
+        VkDevice getDevice() const { return m_device; }
+        VkPhysicalDevice getPhysicalDevice() const { return m_physicalDevice; }
+
+    private:
+        enum class BlockKind
+        {
+            Buddy,
+            Ring,
+            Dedicated
+        };
+
+        struct Block
+        {
+            BlockKind kind = BlockKind::Dedicated;
+            AllocationUsage pool = AllocationUsage::Persistent;
+            uint32_t poolKey = 0; // memoryTypeIndex * 2 + linear
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            void *mapped = nullptr;
+            VkDeviceSize size = 0;
+            VkDeviceSize used = 0;
+            uint32_t allocationCount = 0;
+
+            // Buddy: free offsets per order, and the order of each live allocation
+            std::vector<std::set<VkDeviceSize>> freeLists;
+            std::unordered_map<VkDeviceSize, uint32_t> liveOrders;
+
+            // Ring: live allocations, oldest first
+            struct RingEntry
+            {
+                VkDeviceSize offset;
+                VkDeviceSize size;
+                bool freed;
+            };
+            std::deque<RingEntry> ringEntries;
+        };
+
+        // UINT32_MAX if no type matches
+        uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+        bool allocateDeviceMemory(uint32_t memoryTypeIndex, VkDeviceSize size, const void *pNext, Block &block);
+        uint32_t addBlock(Block &&block);
+        void releaseBlock(uint32_t blockId);
+
+        bool allocateDedicated(uint32_t memoryTypeIndex, VkDeviceSize size, AllocationUsage pool, const void *pNext,
+                               Allocation &allocation);
+        bool allocateBuddy(uint32_t memoryTypeIndex, bool linear, VkDeviceSize size, VkDeviceSize alignment,
+                           Allocation &allocation);
+        bool allocateRing(uint32_t memoryTypeIndex, bool linear, VkDeviceSize size, VkDeviceSize alignment,
+                          Allocation &allocation);
+
+        static bool buddyAlloc(Block &block, uint32_t order, VkDeviceSize &offset);
+        static void buddyFree(Block &block, VkDeviceSize offset);
+        static bool ringAlloc(Block &block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+        static void ringFree(Block &block, VkDeviceSize offset);
+
+        void fillAllocation(uint32_t blockId, const Block &block, VkDeviceSize offset, VkDeviceSize size,
+                            Allocation &allocation) const;
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+        VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+        VkDeviceSize m_blockSize = kDefaultBlockSize;
+        VkDeviceSize m_ringSize = kDefaultRingSize;
+        uint32_t m_maxAllocationCount = 0;
+
+        mutable std::mutex m_mutex;
+        std::map<uint32_t, Block> m_blocks;
+        std::unordered_map<uint32_t, std::vector<uint32_t>> m_buddyBlocks; // poolKey -> blocks
+        std::unordered_map<uint32_t, uint32_t> m_rings;                    // poolKey -> block
+        uint32_t m_nextBlockId = 1;
+        uint64_t m_deviceAllocations = 0;
+        uint64_t m_subAllocations = 0;
+    };
+
+} // namespace vst::memory
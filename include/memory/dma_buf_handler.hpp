@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vst::memory
+{
+
+    /**
+     * @brief Default heap: plain pages, no device behind it, present on any recent kernel
+     */
+    constexpr const char *kSystemDmaHeap = "/dev/dma_heap/system";
+
+    /**
+     * @brief DRM_FORMAT_MOD_LINEAR; heap buffers are plain row-major memory
+     */
+    constexpr uint64_t kDrmFormatModLinear = 0;
+
+    /**
+     * @brief Row pitch alignment of heap frames, so GPUs can import them as linear images
+     */
+    constexpr size_t kDmaBufRowAlignment = 256;
+
+    /**
+     * @brief A CPU-mapped DMA-BUF
+     */
+    struct DmaBuffer
+    {
+        int fd = -1;
+        void *data = nullptr;
+        size_t size = 0;
+        bool writable = false;
+
+        bool isValid() const { return data != nullptr; }
+    };
+
+    /**
+     * @brief Allocates and maps DMA-BUFs from a Linux DMA-BUF heap
+     *
+     * Heap buffers need no GPU, yet are real DMA-BUFs: they travel over the
+     * same control socket as Vulkan exports and can be mmapped by consumers or
+     * imported with VK_EXT_external_memory_dma_buf. Every CPU access must be
+     * bracketed by beginCpuAccess() and endCpuAccess(), which keep caches
+     * coherent with other processes and devices using the buffer.
+     */
+    class DmaBufHandler
+    {
+    public:
+        static bool isHeapAvailable(const std::string &heapPath = kSystemDmaHeap);
+
+        /**
+         * @brief Allocates size bytes from heapPath and maps them read-write
+         */
+        static bool allocate(size_t size, DmaBuffer &buffer, const std::string &heapPath = kSystemDmaHeap);
+
+        /**
+         * @brief Maps a received DMA-BUF fd; takes ownership of fd, also on failure
+         */
+        static bool import(int fd, size_t size, bool writable, DmaBuffer &buffer);
+
+        // DMA_BUF_IOCTL_SYNC around CPU reads, or writes when write is set
+        static bool beginCpuAccess(const DmaBuffer &buffer, bool write);
+        static bool endCpuAccess(const DmaBuffer &buffer, bool write);
+
+        // Unmaps the buffer and closes its fd
+        static void release(DmaBuffer &buffer);
+
+        // Row pitch of a tightly packed row of rowBytes, padded to kDmaBufRowAlignment
+        static size_t alignedRowPitch(size_t rowBytes)
+        {
+            return (rowBytes + kDmaBufRowAlignment - 1) & ~(kDmaBufRowAlignment - 1);
+        }
+    };
+
+} // namespace vst::memory
@@ -2,6 +2,8 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include "core/vulkan_utils.hpp"
+#include "memory/device_allocator.hpp"
 
 namespace vst
 {
@@ -12,6 +14,7 @@ namespace vst
         VkDeviceMemory memory = VK_NULL_HANDLE;
         VkBuffer buffer = VK_NULL_HANDLE;
         VkDeviceSize size = 0;
+        memory::Allocation allocation; // Set when the buffer came from a DeviceAllocator
     };
 
     class TextureDownloader
@@ -25,6 +28,29 @@ namespace vst
             VkImage srcImage,
             uint32_t width,
             uint32_t height);
+
+        /**
+         * @brief Reads the image back on the transfer queue
+         *
+         * The graphics queue lends the image to the transfer queue for the
+         * copy and takes it back afterwards, so rendering is not held up by
+         * the copy itself. srcImage must be in TRANSFER_SRC_OPTIMAL layout.
+         * With an allocator the readback buffer is taken from its transient ring.
+         */
+        static CpuTextureData downloadImageToCpu(
+            VkDevice device,
+            VkPhysicalDevice physicalDevice,
+            const vulkan_utils::SubmitQueue &graphics,
+            const vulkan_utils::SubmitQueue &transfer,
+            VkImage srcImage,
+            uint32_t width,
+            uint32_t height,
+            memory::DeviceAllocator *allocator = nullptr);
+
+        /**
+         * @brief Frees a readback buffer, returning it to the allocator it came from
+         */
+        static void release(VkDevice device, CpuTextureData &data, memory::DeviceAllocator *allocator = nullptr);
     };
 
 }
@@ -13,19 +13,330 @@ namespace vst
     {
 
         /**
-         * @brief Struct to hold frame metadata in shared memory
+         * @brief Identifies a VST video segment ("VSTV" in memory order)
+         */
+        constexpr uint32_t kShmVideoMagic = 0x56545356;
+
+        /**
+         * @brief Layout version; bumped whenever the shared structures change
+         */
+        constexpr uint32_t kShmVideoAbiVersion = 5;
+
+        /**
+         * @brief Alignment of hot header fields and of every frame row
+         */
+        constexpr size_t kCacheLineSize = 64;
+
+        /**
+         * @brief Alignment of the pixel data of every slot
+         */
+        constexpr size_t kShmPageAlignment = 4096;
+
+        /**
+         * @brief Maximum number of planes in a frame
+         */
+        constexpr uint32_t kMaxPlanes = 3;
+
+        /**
+         * @brief Smallest edge of a dirty-region tile, in pixels
+         */
+        constexpr uint32_t kMinTileSize = 64;
+
+        /**
+         * @brief Maximum number of tiles tracked per frame; larger frames use larger tiles
+         */
+        constexpr uint32_t kMaxDirtyTiles = 8192;
+
+        /**
+         * @brief Number of 64-bit words in a dirty-tile bitmap
+         */
+        constexpr uint32_t kDirtyMaskWords = kMaxDirtyTiles / 64;
+
+        /**
+         * @brief Default number of frame slots in the shared ring
+         */
+        constexpr uint32_t kDefaultSlotCount = 3;
+
+        /**
+         * @brief Upper bound on the number of frame slots in the shared ring
+         */
+        constexpr uint32_t kMaxSlotCount = 64;
+
+        /**
+         * @brief Maximum number of consumers registered on one segment
+         */
+        constexpr uint32_t kMaxReaders = 16;
+
+        /**
+         * @brief What the producer does when the slowest registered reader falls behind
+         */
+        enum class BackpressurePolicy : uint32_t
+        {
+            LatestOnly = 0,    // Readers always jump to the newest frame; the producer never waits
+            DropOldest = 1,    // Readers consume frames in order; unread frames are overwritten oldest first
+            BlockProducer = 2, // Readers consume frames in order; the producer waits for the slowest reader
+        };
+
+        /**
+         * @brief Pixel layout of the frames in a segment
+         */
+        enum class ShmPixelFormat : uint32_t
+        {
+            Unknown = 0,
+            Gray8 = 1, // One 8-bit channel
+            RGB8 = 2,  // Three 8-bit channels, R first
+            RGBA8 = 3, // Four 8-bit channels, R first
+            NV12 = 4,  // 8-bit Y plane, then interleaved UV at half resolution
+            I420 = 5,  // 8-bit Y plane, then U and V planes at half resolution
+            BGR8 = 6,  // Three 8-bit channels, B first, as OpenCV decodes; written without conversion
+        };
+
+        /**
+         * @brief Snapshot of the stream and latest frame metadata
+         *
+         * This is a plain copy handed out by getFrameMetadata(); it is never
+         * placed in shared memory itself.
          */
         struct ShmVideoFrameHeader
         {
-            uint32_t width;       // Frame width
-            uint32_t height;      // Frame height
-            uint32_t channels;    // Number of channels (3 for RGB, 4 for RGBA)
-            uint32_t frameIndex;  // Current frame index
-            uint32_t totalFrames; // Total number of frames (0 if unknown)
-            double fps;           // Frames per second
-            uint64_t timestamp;   // Timestamp in milliseconds
-            bool isNewFrame;      // Flag to indicate a new frame is available
-            bool isEndOfVideo;    // Flag to indicate end of video
+            uint32_t width;             // Frame width
+            uint32_t height;            // Frame height
+            uint32_t channels;          // Number of channels (3 for RGB, 4 for RGBA)
+            uint32_t rowStride;         // Bytes between the starts of two rows
+            ShmPixelFormat pixelFormat; // Pixel layout
+            uint32_t frameIndex;        // Current frame index
+            uint32_t totalFrames;       // Total number of frames (0 if unknown)
+            double fps;                 // Frames per second
+            uint64_t timestamp;         // Timestamp in milliseconds
+            uint64_t decodeTimeNs;      // CLOCK_MONOTONIC when the producer had the frame decoded
+            uint64_t publishTimeNs;     // CLOCK_MONOTONIC when the frame was published
+            bool isNewFrame;            // Flag to indicate a new frame is available
+            bool isEndOfVideo;          // Flag to indicate end of video
+        };
+
+        /**
+         * @brief Per-slot header describing the frame held by one slot
+         *
+         * `sequence` is a seqlock counter: it is odd while the producer is
+         * writing the slot and even once the frame is complete. A reader that
+         * sees the same even value before and after copying has a whole frame.
+         * `pinCount` counts read leases; the producer never reuses a pinned slot.
+         * It is written by readers, so it lives on its own cache line.
+         *
+         * `dirtyTiles` has one bit per tile (row-major) that changed since the
+         * previous published frame; full writes set every bit.
+         */
+        struct alignas(kCacheLineSize) ShmVideoSlotHeader
+        {
+            std::atomic<uint64_t> sequence; // Seqlock counter (odd = write in progress)
+            std::atomic<uint64_t> frameSeq; // Publication number of the frame held (0 = empty)
+            uint32_t frameIndex;            // Frame index as given by the producer
+            uint32_t totalFrames;           // Total number of frames (0 if unknown)
+            double fps;                     // Frames per second
+            uint64_t timestamp;             // Timestamp in milliseconds
+            uint64_t decodeTimeNs;          // CLOCK_MONOTONIC when the producer had the frame decoded
+            uint64_t publishTimeNs;         // CLOCK_MONOTONIC when the frame was published
+
+            uint64_t dirtyTiles[kDirtyMaskWords]; // Tiles changed since the previous frame
+
+            alignas(kCacheLineSize) std::atomic<uint32_t> pinCount; // Number of read leases holding this slot
+        };
+
+        /**
+         * @brief hugetlbfs mount used for huge-page backed segments
+         */
+        constexpr const char *kHugeTlbMountPoint = "/dev/hugepages";
+
+        /**
+         * @brief How a video segment is mapped
+         */
+        struct ShmVideoOptions
+        {
+            bool hugePages = false; // Back the segment with hugetlbfs, falling back to shm_open
+            bool populate = true;   // Prefault the whole mapping with MAP_POPULATE
+            bool lockPages = false; // mlock the mapping so frames are never paged out
+            bool memfd = false;     // Anonymous sealed memfd handed over by fd instead of a named object; never on hugetlbfs
+        };
+
+        /**
+         * @brief Memory actually backing an open segment
+         */
+        enum class ShmVideoBacking
+        {
+            None,      // Not open
+            PosixShm,  // shm_open object in /dev/shm
+            HugeTlbFs, // File on the hugetlbfs mount
+            Memfd,     // Anonymous memfd with its size sealed, passed over a Unix socket
+        };
+
+        /**
+         * @brief Registration entry of one consumer in the segment header
+         *
+         * `cursor` is the publication number of the last frame the reader
+         * consumed. `pins` counts the leases the reader holds on each slot, so
+         * the producer can drop them when it reaps a reader that died holding
+         * leases. Entries with a zero pid are free.
+         */
+        struct alignas(kCacheLineSize) ShmVideoReaderSlot
+        {
+            std::atomic<uint32_t> pid;                // Owning process, 0 if the entry is free
+            std::atomic<uint64_t> cursor;             // Publication number of the last frame consumed
+            std::atomic<uint8_t> pins[kMaxSlotCount]; // Leases held on each slot
+        };
+
+        /**
+         * @brief Layout of the start of the shared video segment
+         *
+         * The segment holds this header, then `slotCount` ShmVideoSlotHeaders
+         * at `slotHeaderOffset`, then the pixel data of each slot at
+         * `frameDataOffset + slot * slotStride`. Pixel data is page aligned and
+         * rows are `rowStride` bytes apart, padded to a cache line.
+         *
+         * Planar YUV frames keep their planes back to back inside the slot at
+         * `planeOffsets`. I420 chroma rows are `rowStride / 2` apart, so a slot
+         * is also a valid OpenCV I420/NV12 matrix of `height * 3 / 2` rows.
+         * For these formats `channels` is 1 (bytes per luma sample).
+         *
+         * The stream description is written once before `magic` is set. The
+         * counters after it are grouped by writer, one cache line per group, so
+         * producer and readers do not false-share.
+         */
+        struct alignas(kCacheLineSize) ShmVideoSegmentHeader
+        {
+            uint32_t magic;                    // kShmVideoMagic once the segment is initialised
+            uint32_t abiVersion;               // kShmVideoAbiVersion of the producer
+            uint32_t width;                    // Frame width
+            uint32_t height;                   // Frame height
+            uint32_t channels;                 // Number of channels
+            uint32_t pixelFormat;              // ShmPixelFormat of the frames
+            uint32_t rowStride;                // Bytes between the starts of two rows
+            uint32_t slotCount;                // Number of frame slots in the ring
+            uint32_t policy;                   // BackpressurePolicy chosen by the producer
+            uint32_t tileSize;                 // Edge of a dirty-region tile, in pixels
+            uint32_t tilesX;                   // Tiles per row
+            uint32_t tilesY;                   // Tile rows
+            uint64_t slotHeaderOffset;         // Offset of the slot header array
+            uint64_t frameDataOffset;          // Offset of the first slot's pixel data
+            uint64_t slotStride;               // Bytes between the pixel data of consecutive slots
+            uint32_t planeCount;               // Number of planes (1 for packed formats)
+            uint32_t planeStrides[kMaxPlanes]; // Bytes between rows of each plane
+            uint64_t planeOffsets[kMaxPlanes]; // Offset of each plane within a slot
+
+            // Written by the producer on every frame
+            alignas(kCacheLineSize) std::atomic<uint64_t> publishedSeq; // Publication number of the latest frame
+            std::atomic<uint32_t> latestSlot;                           // Slot holding the latest frame
+            std::atomic<uint32_t> isEndOfVideo;                         // Non-zero once the producer signalled the end
+            std::atomic<uint32_t> frameFutex;                           // Futex word bumped on every publish and at end of stream
+
+            // Written by readers around a blocking wait
+            alignas(kCacheLineSize) std::atomic<uint32_t> waiters; // Number of readers blocked on frameFutex
+
+            // Reader to producer wakeups
+            alignas(kCacheLineSize) std::atomic<uint32_t> readerFutex; // Futex word bumped when a reader advances or unpins
+            std::atomic<uint32_t> producerWaiters;                     // Non-zero while the producer is blocked on readerFutex
+
+            ShmVideoReaderSlot readers[kMaxReaders]; // Registered consumers, cache-line aligned
+        };
+
+        /**
+         * @brief Offsets and sizes derived from the stream description
+         */
+        struct ShmVideoLayout
+        {
+            uint32_t rowStride;                // Bytes between rows
+            uint64_t slotHeaderOffset;         // Offset of the slot header array
+            uint64_t frameDataOffset;          // Offset of the first slot's pixel data
+            uint64_t slotStride;               // Bytes between the pixel data of consecutive slots
+            uint64_t totalSize;                // Bytes needed for the whole segment
+            uint32_t planeCount;               // Number of planes
+            uint32_t planeStrides[kMaxPlanes]; // Bytes between rows of each plane
+            uint64_t planeOffsets[kMaxPlanes]; // Offset of each plane within a slot
+        };
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared ring needs lock-free 64-bit atomics");
+        static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared ring needs lock-free 32-bit atomics");
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futex word must be a plain 32-bit integer");
+        static_assert(sizeof(ShmVideoSlotHeader) % kCacheLineSize == 0, "Slot headers must not share cache lines");
+
+        class ShmVideoHandler;
+
+        /**
+         * @brief Read-only view of a frame slot inside the mapped segment
+         *
+         * While a lease is held the producer will not reuse its slot, so the
+         * pixels can be uploaded or processed straight from shared memory.
+         * Leases must be released (or destroyed) before the handler that
+         * issued them closes its shared memory.
+         */
+        class ShmVideoFrameLease
+        {
+        public:
+            ShmVideoFrameLease();
+            ~ShmVideoFrameLease();
+
+            ShmVideoFrameLease(const ShmVideoFrameLease &) = delete;
+            ShmVideoFrameLease &operator=(const ShmVideoFrameLease &) = delete;
+            ShmVideoFrameLease(ShmVideoFrameLease &&other) noexcept;
+            ShmVideoFrameLease &operator=(ShmVideoFrameLease &&other) noexcept;
+
+            /**
+             * @brief Unpins the slot; the view must not be used afterwards
+             */
+            void release();
+
+            bool isValid() const { return m_slot != nullptr; }
+
+            // Matrix header over the slot pixels; treat it as read-only
+            const cv::Mat &frame() const { return m_frame; }
+            const uint8_t *data() const { return m_frame.data; }
+            size_t stride() const { return m_frame.step; }
+
+            uint32_t frameIndex() const { return m_frameIndex; }
+            uint32_t totalFrames() const { return m_totalFrames; }
+            double fps() const { return m_fps; }
+            uint64_t timestamp() const { return m_timestamp; }
+            uint64_t frameSeq() const { return m_frameSeq; }
+
+            // Slot holding the frame, see ShmVideoHandler::getSlotData()
+            uint32_t slotIndex() const { return m_slotIndex; }
+
+            // CLOCK_MONOTONIC stamps (see monotonicNowNs()) for cross-process latency
+            uint64_t decodeTimeNs() const { return m_decodeTimeNs; }
+            uint64_t publishTimeNs() const { return m_publishTimeNs; }
+
+            ShmPixelFormat pixelFormat() const;
+            uint32_t planeCount() const;
+            const uint8_t *planeData(uint32_t plane) const;
+            size_t planeStride(uint32_t plane) const;
+
+            /**
+             * @brief Tiles that changed since frame frameSeq() - 1
+             *
+             * A reader that skipped frames in between must treat every tile as dirty.
+             *
+             * @return Row-major bitmap of tilesX() * tilesY() bits
+             */
+            const uint64_t *dirtyTileMask() const;
+            bool isTileDirty(uint32_t tileX, uint32_t tileY) const;
+            uint32_t tileSize() const;
+            uint32_t tilesX() const;
+            uint32_t tilesY() const;
+
+        private:
+            friend class ShmVideoHandler;
+
+            ShmVideoSegmentHeader *m_segment;
+            ShmVideoSlotHeader *m_slot;
+            ShmVideoReaderSlot *m_reader; // Pin record of the issuing reader, null if it is not registered
+            uint32_t m_slotIndex;
+            cv::Mat m_frame;
+            uint32_t m_frameIndex;
+            uint32_t m_totalFrames;
+            double m_fps;
+            uint64_t m_timestamp;
+            uint64_t m_frameSeq;
+            uint64_t m_decodeTimeNs;
+            uint64_t m_publishTimeNs;
         };
 
         /**
@@ -51,38 +362,200 @@ namespace vst
              * @param width Frame width
              * @param height Frame height
              * @param channels Number of channels
+             * @param slotCount Number of frame slots in the ring (at least 2)
+             * @param policy How to treat registered readers that fall behind
+             * @param options Backing and mapping options; huge pages fall back to
+             *                shm_open when no hugetlbfs mount or free huge pages exist
+             * @return true if successful, false otherwise
+             */
+            bool createSharedMemory(const std::string &name, uint32_t width, uint32_t height, uint32_t channels = 4,
+                                    uint32_t slotCount = kDefaultSlotCount,
+                                    BackpressurePolicy policy = BackpressurePolicy::LatestOnly,
+                                    const ShmVideoOptions &options = ShmVideoOptions());
+
+            /**
+             * @brief Creates a shared memory segment for the given pixel format
+             *
+             * Planar YUV formats need an even width and height.
+             *
+             * @param name Name of the shared memory segment
+             * @param width Frame width
+             * @param height Frame height
+             * @param pixelFormat Pixel layout of the frames
+             * @param slotCount Number of frame slots in the ring (at least 2)
+             * @param policy How to treat registered readers that fall behind
+             * @param options Backing and mapping options
              * @return true if successful, false otherwise
              */
-            bool createSharedMemory(const std::string &name, uint32_t width, uint32_t height, uint32_t channels = 4);
+            bool createSharedMemory(const std::string &name, uint32_t width, uint32_t height, ShmPixelFormat pixelFormat,
+                                    uint32_t slotCount = kDefaultSlotCount,
+                                    BackpressurePolicy policy = BackpressurePolicy::LatestOnly,
+                                    const ShmVideoOptions &options = ShmVideoOptions());
 
             /**
              * @brief Opens an existing shared memory segment for video streaming
              *
+             * Registers this handler as a reader with its own cursor, starting at
+             * the latest published frame. If the reader table is full the handler
+             * still reads, but the producer does not account for it.
+             *
+             * Looks for the segment in /dev/shm first, then on the hugetlbfs mount.
+             *
              * @param name Name of the shared memory segment
+             * @param options Mapping options; hugePages is ignored, the producer's backing is used
+             * @return true if successful, false otherwise
+             */
+            bool openSharedMemory(const std::string &name, const ShmVideoOptions &options = ShmVideoOptions());
+
+            /**
+             * @brief Opens a segment from a memfd received from the producer
+             *
+             * The fd must carry F_SEAL_SHRINK and F_SEAL_GROW, so the size read
+             * here holds for the life of the mapping. Otherwise behaves like
+             * opening by name.
+             *
+             * @param fd Segment fd; ownership is taken, also on failure
+             * @param options Mapping options; hugePages is ignored
              * @return true if successful, false otherwise
              */
-            bool openSharedMemory(const std::string &name);
+            bool openSharedMemory(int fd, const ShmVideoOptions &options = ShmVideoOptions());
 
             /**
-             * @brief Writes a frame to shared memory
+             * @brief Returns the fd of the open segment, for passing memfd segments to readers
+             *
+             * Owned by the handler; -1 if nothing is open.
+             */
+            int getSegmentFd() const { return m_shmFd; }
+
+            /**
+             * @brief Removes a segment by name from every backing it may live on
+             *
+             * @param name Name of the shared memory segment
+             */
+            static void removeSharedMemory(const std::string &name);
+
+            /**
+             * @brief Claims the next free slot for writing in place
+             *
+             * The returned matrix wraps the slot pixels in shared memory; for
+             * planar YUV it is a single-channel matrix of height * 3 / 2 rows. Fill it
+             * (e.g. as the destination of cv::cvtColor, keeping its size and type
+             * so OpenCV does not reallocate) and then call commitWrite(), or
+             * abortWrite() to give the slot back. Only one write may be open.
+             *
+             * With BackpressurePolicy::BlockProducer this waits until every
+             * registered reader has consumed the frame in the slot to reuse.
+             *
+             * @param slotFrame Receives a matrix header over the slot pixels
+             * @param timeoutMs How long to wait for slow readers, in milliseconds
+             * @return true if a slot was claimed, false if none is free
+             */
+            bool beginWrite(cv::Mat &slotFrame, int timeoutMs = 5000);
+
+            /**
+             * @brief Publishes the slot filled since beginWrite()
+             *
+             * @param frameIndex Current frame index
+             * @param totalFrames Total number of frames (0 if unknown)
+             * @param fps Frames per second
+             * @param timestamp Timestamp in milliseconds
+             * @param decodeTimeNs CLOCK_MONOTONIC time the frame was decoded (0 = publish time)
+             * @return true if successful, false otherwise
+             */
+            bool commitWrite(uint32_t frameIndex, uint32_t totalFrames, double fps, uint64_t timestamp,
+                             uint64_t decodeTimeNs = 0);
+
+            /**
+             * @brief Releases the slot claimed by beginWrite() without publishing it
+             */
+            void abortWrite();
+
+            /**
+             * @brief Writes a frame into the oldest slot of the ring and publishes it
+             *
+             * Convenience wrapper over beginWrite()/commitWrite(); any channel
+             * conversion writes straight into the slot. NV12 and I420 segments
+             * take BGR frames and convert them on the way in.
+             *
+             * The writer never waits for readers; a reader still copying the
+             * overwritten slot detects the torn read through the slot sequence.
              *
              * @param frame OpenCV frame to write
              * @param frameIndex Current frame index
              * @param totalFrames Total number of frames (0 if unknown)
              * @param fps Frames per second
              * @param timestamp Timestamp in milliseconds
+             * @param decodeTimeNs CLOCK_MONOTONIC time the frame was decoded (0 = publish time)
+             * @return true if successful, false otherwise
+             */
+            bool writeFrame(const cv::Mat &frame, uint32_t frameIndex, uint32_t totalFrames, double fps, uint64_t timestamp,
+                            uint64_t decodeTimeNs = 0);
+
+            /**
+             * @brief Writes only the tiles that changed since the previous frame
+             *
+             * Compares the frame against the latest published frame tile by tile,
+             * copies the changed tiles (plus any the target slot is missing from
+             * earlier frames) and publishes the dirty-tile bitmap with the frame.
+             * Meant for mostly static content such as UI captures or slides.
+             * Holds the handler lock from claiming the slot until it is published.
+             *
+             * @param frame Frame already in the segment's pixel format and size
+             * @param frameIndex Current frame index
+             * @param totalFrames Total number of frames (0 if unknown)
+             * @param fps Frames per second
+             * @param timestamp Timestamp in milliseconds
+             * @param decodeTimeNs CLOCK_MONOTONIC time the frame was decoded (0 = publish time)
              * @return true if successful, false otherwise
              */
-            bool writeFrame(const cv::Mat &frame, uint32_t frameIndex, uint32_t totalFrames, double fps, uint64_t timestamp);
+            bool writeFrameDelta(const cv::Mat &frame, uint32_t frameIndex, uint32_t totalFrames, double fps,
+                                 uint64_t timestamp, uint64_t decodeTimeNs = 0);
 
             /**
-             * @brief Reads a frame from shared memory
+             * @brief Reads the latest published frame from shared memory
+             *
+             * When waiting, the caller blocks on the segment's futex word and is
+             * woken as soon as the producer publishes a frame or signals the end
+             * of the stream. Torn reads (the producer reused the slot during the
+             * copy) are detected and retried against the newest frame.
              *
              * @param frame OpenCV frame to read into
              * @param waitForNewFrame Whether to wait for a new frame
+             * @param timeoutMs How long to wait for a new frame, in milliseconds
+             * @return true if successful, false otherwise
+             */
+            bool readFrame(cv::Mat &frame, bool waitForNewFrame = true, int timeoutMs = 5000);
+
+            /**
+             * @brief Reads the latest frame only if one is ready, without blocking
+             *
+             * Intended for consumers that drive their own event loop.
+             *
+             * @param frame OpenCV frame to read into
+             * @return true if a new frame was copied, false if none was ready
+             */
+            bool tryReadFrame(cv::Mat &frame);
+
+            /**
+             * @brief Leases the latest frame in place instead of copying it
+             *
+             * The slot stays pinned until the lease is released. Waiting works
+             * as in readFrame().
+             *
+             * @param lease Lease to fill; any frame it already holds is released
+             * @param waitForNewFrame Whether to wait for a frame newer than the last one read
+             * @param timeoutMs How long to wait for a new frame, in milliseconds
              * @return true if successful, false otherwise
              */
-            bool readFrame(cv::Mat &frame, bool waitForNewFrame = true);
+            bool acquireFrame(ShmVideoFrameLease &lease, bool waitForNewFrame = true, int timeoutMs = 5000);
+
+            /**
+             * @brief Leases the latest frame only if a new one is ready, without blocking
+             *
+             * @param lease Lease to fill; any frame it already holds is released
+             * @return true if a new frame was leased, false if none was ready
+             */
+            bool tryAcquireFrame(ShmVideoFrameLease &lease);
 
             /**
              * @brief Gets the current frame metadata
@@ -103,6 +576,39 @@ namespace vst
              */
             bool isOpen() const;
 
+            /**
+             * @brief Returns the backpressure policy of the open segment
+             */
+            BackpressurePolicy getBackpressurePolicy() const;
+
+            /**
+             * @brief Returns the pixel format of the open segment
+             */
+            ShmPixelFormat getPixelFormat() const;
+
+            /**
+             * @brief Returns the number of frame slots in the open segment
+             */
+            uint32_t getSlotCount() const;
+
+            /**
+             * @brief Returns the pixel data of a slot, for importing it into another API
+             *
+             * Slots start on a kShmPageAlignment boundary and span a whole number
+             * of pages. Their contents are only stable while a lease on the slot
+             * is held, and the pointer is invalid once the segment is closed.
+             *
+             * @param slot Slot index, as given by ShmVideoFrameLease::slotIndex()
+             * @param size Receives the bytes the slot spans
+             * @return nullptr if the segment is not open or slot is out of range
+             */
+            const uint8_t *getSlotData(uint32_t slot, size_t &size) const;
+
+            /**
+             * @brief Returns the memory backing the open segment
+             */
+            ShmVideoBacking getBacking() const { return m_backing; }
+
             /**
              * @brief Signals the end of the video stream
              */
@@ -113,21 +619,187 @@ namespace vst
             int m_shmFd;
             size_t m_shmSize;
             void *m_shmPtr;
-            ShmVideoFrameHeader *m_header;
+            ShmVideoBacking m_backing;
+            ShmVideoSegmentHeader *m_header;
             uint8_t *m_frameData;
+            uint64_t m_lastReadSeq;
+            int m_readerIndex;        // Entry in the segment's reader table, -1 if unregistered
+            int m_writeSlot;          // Slot claimed by beginWrite(), -1 if none
+            uint64_t m_writeSequence; // Sequence of m_writeSlot before it was claimed
+
+            // Producer only: per slot, the tiles that lag behind the latest frame
+            std::vector<uint64_t> m_staleTiles;
+
+            // Producer only: I420 staging for NV12 segments, reused across frames
+            cv::Mat m_yuvScratch;
 
             std::mutex m_mutex;
             std::atomic<bool> m_isOpen;
 
             /**
-             * @brief Calculates the total size needed for shared memory
+             * @brief Publishes m_writeSlot; m_mutex must be held
+             *
+             * @param dirtyMask Tiles changed since the previous frame, or nullptr for all
+             */
+            bool publishWriteSlot(uint32_t frameIndex, uint32_t totalFrames, double fps, uint64_t timestamp,
+                                  uint64_t decodeTimeNs, const uint64_t *dirtyMask);
+
+            /**
+             * @brief Computes the segment layout for a stream
              *
              * @param width Frame width
              * @param height Frame height
-             * @param channels Number of channels
-             * @return Size in bytes
+             * @param pixelFormat Pixel layout of the frames
+             * @param slotCount Number of frame slots
+             * @return Row stride, offsets and total size in bytes
+             */
+            static ShmVideoLayout computeLayout(uint32_t width, uint32_t height, ShmPixelFormat pixelFormat,
+                                                uint32_t slotCount);
+
+            /**
+             * @brief Copies a slot into a tightly packed frame, plane by plane
+             *
+             * @param pixels Slot pixel data
+             * @param frame Destination, already allocated for the segment's format
+             */
+            void copySlotPixels(const uint8_t *pixels, cv::Mat &frame) const;
+
+            /**
+             * @brief Creates and maps the segment as a file on the hugetlbfs mount
+             *
+             * @param size Bytes needed, rounded up to the huge page size
+             * @param options Mapping options
+             * @return true if successful, false if the caller should fall back to shm_open
+             */
+            bool createHugeTlbSegment(size_t size, const ShmVideoOptions &options);
+
+            /**
+             * @brief Creates and maps the segment as a sealed anonymous memfd
+             *
+             * @param size Bytes needed
+             * @param options Mapping options
+             * @return true if successful, false otherwise
+             */
+            bool createMemfdSegment(size_t size, const ShmVideoOptions &options);
+
+            /**
+             * @brief Unmaps and closes the segment, as closeSharedMemory(); m_mutex must be held
+             */
+            void closeSegment();
+
+            /**
+             * @brief Maps m_shmFd, validates the segment and registers as a reader; m_mutex must be held
+             *
+             * Expects m_shmFd, m_shmSize and m_backing to be set, and releases
+             * them if the segment cannot be used.
+             *
+             * @param options Mapping options
+             * @return true if successful, false otherwise
+             */
+            bool attachSegment(const ShmVideoOptions &options);
+
+            /**
+             * @brief Maps m_shmFd with the requested prefaulting and locking
+             *
+             * @param options Mapping options
+             * @return true if successful, false otherwise
+             */
+            bool mapSegment(const ShmVideoOptions &options);
+
+            /**
+             * @brief Returns the header of the given slot
+             */
+            ShmVideoSlotHeader *slotHeader(uint32_t slot) const;
+
+            /**
+             * @brief Returns the pixel data of the given slot
+             */
+            uint8_t *slotPixels(uint32_t slot) const;
+
+            /**
+             * @brief Blocks on the futex word until a new frame or end of stream
+             *
+             * @param lock Lock on m_mutex, released while sleeping
+             * @param timeoutMs Timeout in milliseconds
+             * @return true if a new frame is available, false on timeout or end of stream
+             */
+            bool waitForFrame(std::unique_lock<std::mutex> &lock, int timeoutMs);
+
+            /**
+             * @brief Picks the slot the next read should come from
+             *
+             * LatestOnly (or a read that does not need a new frame) takes the
+             * latest slot; the in-order policies take the oldest frame newer
+             * than this reader's cursor.
+             *
+             * @param requireNewFrame Whether the read needs a frame newer than the cursor
+             * @return Slot index
+             */
+            uint32_t selectReadSlot(bool requireNewFrame) const;
+
+            /**
+             * @brief Copies the next frame for this reader into the given frame
+             *
+             * @param frame OpenCV frame to read into
+             * @param requireNewFrame Fail if there is no frame newer than the cursor
+             * @return true if successful, false otherwise
+             */
+            bool copyNextFrame(cv::Mat &frame, bool requireNewFrame);
+
+            /**
+             * @brief Pins the next frame for this reader into the given lease
+             *
+             * @param lease Lease to fill
+             * @param requireNewFrame Fail if there is no frame newer than the cursor
+             * @return true if successful, false otherwise
+             */
+            bool pinNextFrame(ShmVideoFrameLease &lease, bool requireNewFrame);
+
+            /**
+             * @brief Moves this reader's cursor and wakes a producer waiting on it
+             *
+             * @param frameSeq Publication number of the frame just consumed
+             */
+            void advanceCursor(uint64_t frameSeq);
+
+            /**
+             * @brief Claims an entry in the segment's reader table
+             */
+            void registerReader();
+
+            /**
+             * @brief Frees this handler's entry in the reader table
+             */
+            void unregisterReader();
+
+            /**
+             * @brief Returns the smallest cursor over the registered readers
+             *
+             * @return Cursor of the slowest reader, or UINT64_MAX if none are registered
+             */
+            uint64_t minReaderCursor() const;
+
+            /**
+             * @brief Frees reader entries whose process no longer exists, with the pins they held
+             */
+            void reapDeadReaders();
+
+            /**
+             * @brief Bumps the futex word and wakes any blocked readers
+             */
+            void wakeReaders();
+
+            /**
+             * @brief Claims the slot the next frame will be written to
+             *
+             * Tries the unpinned slots from oldest to newest, never the latest
+             * frame, and leaves the claimed slot's sequence odd.
+             *
+             * @param sequence Receives the slot's sequence before it was claimed
+             * @param reuseLimit Only slots holding frames up to this publication number are reused
+             * @return Index of the claimed slot, or -1 if every candidate is pinned or unread
              */
-            size_t calculateShmSize(uint32_t width, uint32_t height, uint32_t channels);
+            int openWriteSlot(uint64_t &sequence, uint64_t reuseLimit);
         };
 
     } // namespace memory
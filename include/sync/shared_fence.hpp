@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+namespace vst::sync
+{
+
+    // How a semaphore payload travels between processes
+    enum class SemaphoreHandleType
+    {
+        OpaqueFd, // The semaphore itself, shared once; needs the same driver and device
+        SyncFd    // A sync_file snapshot of one pending signal, shared per frame
+    };
+
+    /**
+     * @brief A Vulkan semaphore whose payload can cross a process boundary
+     *
+     * Built on VK_KHR_external_semaphore_fd. The producer creates an
+     * exportable semaphore and signals it from its upload submission; the
+     * consumer imports the fd and waits on it from its graphics submission,
+     * so the ordering happens on the GPU and no host thread blocks.
+     *
+     * Timeline semaphores are only exportable as opaque fds; sync fds are
+     * only exportable from binary semaphores.
+     */
+    class SharedFence
+    {
+    public:
+        SharedFence() = default;
+        ~SharedFence();
+
+        SharedFence(const SharedFence &) = delete;
+        SharedFence &operator=(const SharedFence &) = delete;
+
+        /**
+         * @brief Checks whether the device can export and import this kind of semaphore
+         */
+        static bool isSupported(VkPhysicalDevice physicalDevice, SemaphoreHandleType handleType, bool timeline);
+
+        /**
+         * @brief Creates a semaphore that can be exported as handleType
+         */
+        void createExportable(VkDevice device, SemaphoreHandleType handleType, bool timeline);
+
+        /**
+         * @brief Creates a semaphore that payloads of handleType can be imported into
+         */
+        void createImportable(VkDevice device, SemaphoreHandleType handleType, bool timeline);
+
+        /**
+         * @brief Exports the semaphore payload
+         *
+         * For a sync fd the semaphore must have a signal operation submitted;
+         * exporting resets it to unsignaled, ready for the next frame.
+         *
+         * @return A new fd owned by the caller, -1 on failure
+         */
+        int exportFd();
+
+        /**
+         * @brief Imports a payload exported by the other process
+         *
+         * Opaque fds are imported permanently; sync fds temporarily, so the
+         * import only covers the next wait. On success Vulkan owns fd, on
+         * failure it is closed.
+         *
+         * @return true if the payload was imported
+         */
+        bool importFd(int fd);
+
+        void destroy();
+
+        VkSemaphore get() const { return m_semaphore; }
+        bool isTimeline() const { return m_timeline; }
+        SemaphoreHandleType getHandleType() const { return m_handleType; }
+
+    private:
+        void create(VkDevice device, SemaphoreHandleType handleType, bool timeline, bool exportable);
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkSemaphore m_semaphore = VK_NULL_HANDLE;
+        SemaphoreHandleType m_handleType = SemaphoreHandleType::OpaqueFd;
+        bool m_timeline = false;
+
+        PFN_vkGetSemaphoreFdKHR m_getSemaphoreFd = nullptr;
+        PFN_vkImportSemaphoreFdKHR m_importSemaphoreFd = nullptr;
+    };
+
+} // namespace vst::sync
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "sync/shared_fence.hpp"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+namespace vst::sync
+{
+
+    // Cross-process upload ordering in use; the values travel in the control protocol
+    enum class SyncMode : uint32_t
+    {
+        None = 0,             // No shared semaphore, the producer waits for its uploads on the host
+        TimelineOpaqueFd = 1, // One timeline semaphore shared at connect, FRAME_READY names the value
+        BinarySyncFd = 2      // A sync_file per frame, passed along with FRAME_READY
+    };
+
+    const char *syncModeName(SyncMode mode);
+
+    /**
+     * @brief Orders a consumer's draws after the producer's uploads on the GPU
+     *
+     * The producer signals a SharedFence from every upload submission and
+     * hands out the payload; the consumer turns it into a wait in its next
+     * graphics submission. A timeline semaphore is preferred: it is shared
+     * once and any number of consumers can wait on any value. Without
+     * timeline support each frame's signal is exported as a sync_file. With
+     * neither, SyncMode::None is reported and callers keep a host wait.
+     */
+    class SyncManager
+    {
+    public:
+        SyncManager() = default;
+        ~SyncManager();
+
+        SyncManager(const SyncManager &) = delete;
+        SyncManager &operator=(const SyncManager &) = delete;
+
+        /**
+         * @brief Producer side: creates the exportable semaphore
+         *
+         * @param timelineEnabled Whether the device was created with timelineSemaphore
+         * @return The mode picked for this device
+         */
+        SyncMode initProducer(VkDevice device, VkPhysicalDevice physicalDevice, bool timelineEnabled);
+
+        // Semaphore the next upload submission signals, VK_NULL_HANDLE in SyncMode::None
+        VkSemaphore getSignalSemaphore() const { return m_fence.get(); }
+
+        // Value the next upload signals (timeline only, 0 otherwise); advances the counter
+        uint64_t nextSignalValue();
+
+        // Timeline mode: a new fd for the shared semaphore, sent once per consumer; -1 otherwise
+        int exportSemaphoreFd();
+
+        /**
+         * @brief Sync fd mode: snapshots the signal just submitted
+         *
+         * Must be called after every signalling submission, since it also
+         * resets the binary semaphore for the next one.
+         *
+         * @return A new fd for FRAME_READY, -1 in other modes or on failure
+         */
+        int exportFrameFd();
+
+        /**
+         * @brief Consumer side: prepares to wait on the producer's payloads
+         *
+         * @param semaphoreFd Timeline mode: the shared semaphore; ownership is taken
+         * @return false if the mode cannot be used here; draws then go unordered
+         */
+        bool initConsumer(VkDevice device, VkPhysicalDevice physicalDevice, SyncMode mode, int semaphoreFd,
+                          bool timelineEnabled);
+
+        /**
+         * @brief Records what the newest FRAME_READY carried
+         *
+         * Takes ownership of frameFd; an older frame fd that was never waited
+         * on is dropped.
+         */
+        void onFrameReady(uint64_t signalValue, int frameFd);
+
+        /**
+         * @brief Returns the wait the next graphics submission must add
+         *
+         * @param value Timeline value to wait for; ignored for binary semaphores
+         * @return false if there is nothing to wait on
+         */
+        bool acquireWait(VkSemaphore &semaphore, uint64_t &value);
+
+        SyncMode getMode() const { return m_mode; }
+
+        void destroy();
+
+    private:
+        SharedFence m_fence;
+        SyncMode m_mode = SyncMode::None;
+        uint64_t m_value = 0;   // Producer: last value handed out; consumer: newest value announced
+        int m_pendingFd = -1;   // Consumer, sync fd mode: newest frame fd not yet imported
+    };
+
+} // namespace vst::sync
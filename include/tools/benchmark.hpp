@@ -2,6 +2,8 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <vector>
@@ -9,6 +11,14 @@
 namespace vst
 {
 
+    /**
+     * @brief Current CLOCK_MONOTONIC time in nanoseconds
+     *
+     * The clock is system-wide, so stamps taken in different processes on the
+     * same machine can be subtracted directly.
+     */
+    uint64_t monotonicNowNs();
+
     class Timer
     {
     public:
@@ -21,11 +31,45 @@ namespace vst
         std::chrono::high_resolution_clock::time_point endTime;
     };
 
+    /**
+     * @brief Rolling latency distribution over the most recent samples
+     *
+     * Keeps a fixed window of samples so percentiles track the current
+     * behaviour rather than the whole run.
+     */
+    class LatencyHistogram
+    {
+    public:
+        explicit LatencyHistogram(size_t windowSize = 4096);
+
+        void record(double milliseconds);
+        void recordNs(uint64_t startNs, uint64_t endNs);
+
+        /**
+         * @brief Latency at the given percentile of the current window
+         *
+         * @param percentile Percentile in [0, 100], e.g. 99.9
+         * @return Latency in milliseconds, or 0 if no samples were recorded
+         */
+        double percentile(double percentile) const;
+
+        size_t count() const { return samples.size(); }
+        void reset();
+
+    private:
+        std::vector<double> samples;
+        size_t windowSize;
+        size_t next = 0;
+    };
+
     class BenchmarkLogger
     {
     public:
         explicit BenchmarkLogger(const std::string &filename);
         void log(const std::string &label, double milliseconds);
+
+        // Logs the p50, p99 and p999 of a histogram as <label>_p50 etc.
+        void logPercentiles(const std::string &label, const LatencyHistogram &histogram);
         void flush();
 
     private:
@@ -16,6 +16,7 @@ namespace vst::utils
         std::string mode;
         std::string type;
         vst::utils::ImageSize dimensions; 
+        bool viaSocket = false; // path is the Unix socket handing out a memfd segment, not the segment itself
     };
 
     ImageSize getImageSize(const std::string &imagePath);
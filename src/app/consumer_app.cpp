@@ -3,12 +3,16 @@
 #include "utils/file_utils.hpp"
 #include "utils/logger.hpp"
 #include <stdexcept>
+#include <algorithm>
+#include <cerrno>
 #include <vulkan/vulkan.h>
 #include <cstring>
 #include <fcntl.h>
+#include <poll.h>
 #include <thread>
 #include <unistd.h>
 #include "ipc/fd_passing.hpp"
+#include "ipc/control_protocol.hpp"
 #include "shm/shm_viewer.hpp"
 #include <SDL3/SDL.h>
 
@@ -17,50 +21,25 @@ namespace vst
 
     ConsumerApp::ConsumerApp() {}
 
-    static void createVertexBuffer(VkDevice device, VkPhysicalDevice phys, VkBuffer &buffer, VkDeviceMemory &memory, const std::vector<vst::Vertex> &vertices)
+    static void createVertexBuffer(memory::DeviceAllocator &allocator, VkBuffer &buffer, memory::Allocation &allocation, const std::vector<vst::Vertex> &vertices)
     {
         VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
 
-        VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
-        bufferInfo.size = bufferSize;
-        bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        vkCreateBuffer(device, &bufferInfo, nullptr, &buffer);
-
-        VkMemoryRequirements memReq;
-        vkGetBufferMemoryRequirements(device, buffer, &memReq);
-
-        VkPhysicalDeviceMemoryProperties memProps;
-        vkGetPhysicalDeviceMemoryProperties(phys, &memProps);
-
-        VkMemoryAllocateInfo allocInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-        allocInfo.allocationSize = memReq.size;
-
-        for (uint32_t i = 0; i < memProps.memoryTypeCount; i++)
-        {
-            if ((memReq.memoryTypeBits & (1 << i)) &&
-                (memProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
-                (memProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
-            {
-                allocInfo.memoryTypeIndex = i;
-                break;
-            }
-        }
-
-        vkAllocateMemory(device, &allocInfo, nullptr, &memory);
-        vkBindBufferMemory(device, buffer, memory, 0);
-
-        void *data;
-        vkMapMemory(device, memory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device, memory);
+        // Persistent host-visible sub-allocation; the allocator keeps it mapped
+        vulkan_utils::createBuffer(allocator, bufferSize, buffer, allocation, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        memcpy(allocation.mapped, vertices.data(), (size_t)bufferSize);
     }
 
-    ConsumerApp::ConsumerApp(GLFWwindow *window, const std::string &shmName, const std::string &mode, bool isVideo)
+    ConsumerApp::ConsumerApp(GLFWwindow *window, const std::string &shmName, const std::string &mode, bool isVideo,
+                             PresentProfile presentProfile)
     {
         this->mode = mode;
-        context.init(window);
+        // Headless contexts are created once the producer has told us the image size
+        if (window)
+        {
+            context.init(window, presentProfile);
+        }
         // === Socket: Receive FD from Producer ===
         LOG_INFO("Connecting to producer via socket...");
 
@@ -84,16 +63,50 @@ namespace vst
             LOG_INFO("Image socket path: " + socketPath);
         }
 
-        int sock_fd = vst::ipc::connect_unix_client_socket(socketPath);
+        int sock_fd = vst::ipc::connect_control_socket(socketPath);
         if (sock_fd < 0)
             throw std::runtime_error("Failed to connect to producer via socket.");
-        int fd = -1;
-        uint32_t texWidth = 0, texHeight = 0;
-        if (vst::ipc::receive_fd_with_info(sock_fd, fd, texWidth, texHeight) < 0)
+
+        // The first message describes the shared images and carries one fd per ring image
+        ipc::ControlMessageType messageType;
+        ipc::ImageDescription desc{};
+        std::vector<int> fds;
+        if (ipc::receive_control_message(sock_fd, messageType, &desc, sizeof(desc), &fds) < 0 ||
+            messageType != ipc::ControlMessageType::ImageDesc || fds.empty() || fds.size() != desc.imageCount)
+        {
+            for (int fd : fds)
+                close(fd);
+            close(sock_fd);
+            throw std::runtime_error("Failed to receive image description from producer.");
+        }
+
+        // Keep the connection for frame notifications, polled from runFrame()
+        controlSocketFd = sock_fd;
+        fcntl(controlSocketFd, F_SETFL, fcntl(controlSocketFd, F_GETFL, 0) | O_NONBLOCK);
+
+        uint32_t texWidth = desc.width, texHeight = desc.height;
+        imageWidth = texWidth;
+        imageHeight = texHeight;
+        if (!window)
         {
-            throw std::runtime_error("Failed to receive FD from producer.");
+            context.initHeadless(texWidth, texHeight);
+        }
+        LOG_INFO("Received " + std::to_string(fds.size()) + " FDs with dimensions: " + std::to_string(texWidth) + "x" + std::to_string(texHeight) +
+                 ", format " + std::to_string(desc.format) + ", tiling " + std::to_string(desc.tiling) +
+                 ", size " + std::to_string(desc.allocationSize));
+
+        // An implicitly tiled image is only meaningful on the device that laid it out
+        VkPhysicalDeviceIDProperties idProps{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
+        VkPhysicalDeviceProperties2 deviceProps{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+        deviceProps.pNext = &idProps;
+        vkGetPhysicalDeviceProperties2(context.getPhysicalDevice(), &deviceProps);
+        if (std::memcmp(idProps.deviceUUID, desc.deviceUuid, VK_UUID_SIZE) != 0 &&
+            desc.drmModifier == ipc::kDrmFormatModInvalid && desc.tiling != VK_IMAGE_TILING_LINEAR)
+        {
+            for (int fd : fds)
+                close(fd);
+            throw std::runtime_error("Producer image was allocated on a different GPU with opaque tiling.");
         }
-        LOG_INFO("Received FD = " + std::to_string(fd) + " with dimensions: " + std::to_string(texWidth) + "x" + std::to_string(texHeight));
 
         // Create image with external memory support and format Compatibility Check ===
         VkPhysicalDeviceExternalImageFormatInfo externalImageFormatInfo{};
@@ -103,9 +116,9 @@ namespace vst
         VkPhysicalDeviceImageFormatInfo2 formatInfo{};
         formatInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2;
         formatInfo.pNext = &externalImageFormatInfo;
-        formatInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        formatInfo.format = static_cast<VkFormat>(desc.format);
         formatInfo.type = VK_IMAGE_TYPE_2D;
-        formatInfo.tiling = VK_IMAGE_TILING_LINEAR;
+        formatInfo.tiling = static_cast<VkImageTiling>(desc.tiling);
         formatInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
         formatInfo.flags = 0;
 
@@ -123,18 +136,100 @@ namespace vst
 
         if (fmtResult != VK_SUCCESS)
         {
+            for (int fd : fds)
+                close(fd);
             throw std::runtime_error("Image format not supported for external memory (DMA-BUF).");
         }
 
+        // Import every ring image; each import takes ownership of its fd
+        for (size_t i = 0; i < fds.size(); ++i)
+        {
+            try
+            {
+                importDmaBufImage(desc, fds[i]);
+            }
+            catch (...)
+            {
+                for (size_t j = i + 1; j < fds.size(); ++j)
+                    close(fds[j]);
+                throw;
+            }
+        }
+
+        createDrawResources(importedImageViews, imageWidth, imageHeight);
+
+        LOG_INFO("DMA-BUF imported and image view created successfully.");
+    }
+
+    void ConsumerApp::createDrawResources(const std::vector<VkImageView> &views, uint32_t width, uint32_t height)
+    {
+        // Init descriptor and pipeline, one descriptor set per view
+        VkDescriptorPoolSize poolSize{};
+        poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        poolSize.descriptorCount = static_cast<uint32_t>(views.size());
+
+        VkDescriptorPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        poolInfo.maxSets = static_cast<uint32_t>(views.size());
+
+        vkCreateDescriptorPool(context.getDevice(), &poolInfo, nullptr, &descriptorPool);
+
+        descriptorManagers.resize(views.size());
+        for (size_t i = 0; i < views.size(); ++i)
+        {
+            TextureImage texture{};
+            texture.view = views[i];
+            texture.width = width;
+            texture.height = height;
+
+            descriptorManagers[i].init(context.getDevice(), descriptorPool, texture);
+        }
+
+        // The set layouts are identically defined, so any set binds against this pipeline
+        pipeline.create(
+            context.getDevice(),
+            context.getSwapchainExtent(),
+            context.getRenderPass(),
+            descriptorManagers[0].getLayout(),
+            context.getPipelineCache());
+        // Consumers are restarted on every stream switch and may not get to a clean exit
+        context.savePipelineCache();
+
+        createVertexBuffer(
+            context.getAllocator(),
+            vertexBuffer,
+            vertexBufferAllocation,
+            vst::FULLSCREEN_QUAD);
+    }
+
+    void ConsumerApp::destroyDrawResources()
+    {
+        vulkan_utils::destroyBuffer(context.getAllocator(), vertexBuffer, vertexBufferAllocation);
+        if (descriptorPool)
+        {
+            for (DescriptorManager &manager : descriptorManagers)
+            {
+                manager.cleanup(context.getDevice());
+            }
+            descriptorManagers.clear();
+            vkDestroyDescriptorPool(context.getDevice(), descriptorPool, nullptr);
+            descriptorPool = VK_NULL_HANDLE;
+        }
+        pipeline.cleanup(context.getDevice());
+    }
+
+    void ConsumerApp::importDmaBufImage(const ipc::ImageDescription &desc, int fd)
+    {
         // Create image matching producer's configuration
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         imageInfo.imageType = VK_IMAGE_TYPE_2D;
-        imageInfo.extent = {static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1};
+        imageInfo.extent = {desc.width, desc.height, 1};
         imageInfo.mipLevels = 1;
         imageInfo.arrayLayers = 1;
-        imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
-        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL; // Must match producer
+        imageInfo.format = static_cast<VkFormat>(desc.format);
+        imageInfo.tiling = static_cast<VkImageTiling>(desc.tiling); // Must match producer
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -146,31 +241,20 @@ namespace vst
         extImageInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
         imageInfo.pNext = &extImageInfo;
 
-        if (vkCreateImage(context.getDevice(), &imageInfo, nullptr, &importedImage) != VK_SUCCESS)
+        VkImage image = VK_NULL_HANDLE;
+        if (vkCreateImage(context.getDevice(), &imageInfo, nullptr, &image) != VK_SUCCESS)
         {
+            close(fd);
             throw std::runtime_error("Failed to create image for imported memory");
         }
-
-        // Query memory requirements and properties
-        VkMemoryRequirements memReq{};
-        vkGetImageMemoryRequirements(context.getDevice(), importedImage, &memReq);
-
-        VkPhysicalDeviceMemoryProperties memProps{};
-        vkGetPhysicalDeviceMemoryProperties(context.getPhysicalDevice(), &memProps);
-
-        std::cout << "Image memoryTypeBits from Consumer App: " << memReq.memoryTypeBits << std::endl;
-
-        LOG_INFO("Image memoryTypeBits: " << memReq.memoryTypeBits);
-        for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i)
-        {
-            LOG_INFO("Memory Type " << i << ": flags=" << memProps.memoryTypes[i].propertyFlags);
-        }
+        // Tracked right away so cleanup() releases it even if the import fails below
+        importedImages.push_back(image);
 
         // Memory Requirements for Image
         VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(context.getDevice(), importedImage, &memRequirements);
+        vkGetImageMemoryRequirements(context.getDevice(), image, &memRequirements);
 
-        std::cout << "Image memoryTypeBits from Consumer App: " << memRequirements.memoryTypeBits << std::endl;
+        LOG_INFO("Image memoryTypeBits: " << memRequirements.memoryTypeBits);
 
         // External Memory Import Info
         VkImportMemoryFdInfoKHR importInfo{};
@@ -181,7 +265,7 @@ namespace vst
         // Memory Allocation Info
         VkMemoryAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.allocationSize = std::max<VkDeviceSize>(memRequirements.size, desc.allocationSize);
         allocInfo.pNext = &importInfo;
 
         // Choose Compatible Memory Type
@@ -202,24 +286,28 @@ namespace vst
 
         if (!found)
         {
+            close(fd);
             throw std::runtime_error("Failed to find suitable memory type for imported DMA-BUF image.");
         }
 
-        // Allocate the memory
-        if (vkAllocateMemory(context.getDevice(), &allocInfo, nullptr, &importedMemory) != VK_SUCCESS)
+        // Allocate the memory; on success the driver owns fd
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        if (vkAllocateMemory(context.getDevice(), &allocInfo, nullptr, &memory) != VK_SUCCESS)
         {
+            close(fd);
             throw std::runtime_error("Failed to allocate memory for imported DMA-BUF image.");
         }
+        importedMemories.push_back(memory);
 
         // Bind the memory to the image
-        if (vkBindImageMemory(context.getDevice(), importedImage, importedMemory, 0) != VK_SUCCESS)
+        if (vkBindImageMemory(context.getDevice(), image, memory, 0) != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to bind imported memory to image.");
         }
 
         // Create image view
         VkImageViewCreateInfo viewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
-        viewInfo.image = importedImage;
+        viewInfo.image = image;
         viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
         viewInfo.format = imageInfo.format;
         viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -228,53 +316,12 @@ namespace vst
         viewInfo.subresourceRange.baseArrayLayer = 0;
         viewInfo.subresourceRange.layerCount = 1;
 
-        if (vkCreateImageView(context.getDevice(), &viewInfo, nullptr, &importedImageView) != VK_SUCCESS)
+        VkImageView view = VK_NULL_HANDLE;
+        if (vkCreateImageView(context.getDevice(), &viewInfo, nullptr, &view) != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to create image view for imported DMA-BUF.");
         }
-
-        // Init descriptor and pipeline
-        VkDescriptorPoolSize poolSize{};
-        poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSize.descriptorCount = 1;
-
-        VkDescriptorPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
-        poolInfo.poolSizeCount = 1;
-        poolInfo.pPoolSizes = &poolSize;
-        poolInfo.maxSets = 1;
-
-        vkCreateDescriptorPool(context.getDevice(), &poolInfo, nullptr, &descriptorPool);
-
-        TextureImage importedTex{};
-        importedTex.view = importedImageView;
-        importedTex.width = imageWidth;
-        importedTex.height = imageHeight;
-
-        descriptorManager.init(context.getDevice(), descriptorPool, importedTex);
-
-        pipeline.create(
-            context.getDevice(),
-            context.getSwapchainExtent(),
-            context.getRenderPass(),
-            descriptorManager.getLayout());
-
-        createVertexBuffer(
-            context.getDevice(),
-            context.getPhysicalDevice(),
-            vertexBuffer,
-            vertexBufferMemory,
-            vst::FULLSCREEN_QUAD);
-
-        LOG_INFO("DMA-BUF imported and image view created successfully.");
-
-        // For video content, we need to use a different approach
-        // This will check if the socketPath contains any video identifiers (though there aren't any right now)
-        if (socketPath.find("video") != std::string::npos)
-        {
-            LOG_INFO("DMA-BUF video detection is not yet implemented");
-            // The consumer will continuously render the texture in each frame
-            // as the producer updates it, no special handling needed here
-        }
+        importedImageViews.push_back(view);
     }
 
     ConsumerApp::ConsumerApp(const std::string &mode)
@@ -308,6 +355,47 @@ namespace vst
             return false;
         }
 
+        return setupShmVideoConsumer();
+    }
+
+    bool vst::ConsumerApp::consumeShmVideoSocket(const std::string &socketPath)
+    {
+        LOG_INFO("Receiving SHM video segment from: " + socketPath);
+        this->shmName = socketPath;
+
+        int sock_fd = ipc::connect_control_socket(socketPath);
+        if (sock_fd < 0)
+        {
+            LOG_ERR("Failed to connect to producer via socket: " + socketPath);
+            return false;
+        }
+
+        // The segment fd comes with the first message; the segment itself carries everything else
+        ipc::ControlMessageType messageType;
+        ipc::ImageDescription desc{};
+        std::vector<int> fds;
+        int received = ipc::receive_control_message(sock_fd, messageType, &desc, sizeof(desc), &fds);
+        close(sock_fd);
+        if (received < 0 || messageType != ipc::ControlMessageType::ImageDesc || fds.size() != 1)
+        {
+            for (int fd : fds)
+                close(fd);
+            LOG_ERR("Failed to receive the video segment from producer");
+            return false;
+        }
+
+        m_shmVideoHandler = std::make_shared<memory::ShmVideoHandler>();
+        if (!m_shmVideoHandler->openSharedMemory(fds[0]))
+        {
+            LOG_ERR("Failed to open shared memory segment from: " + socketPath);
+            return false;
+        }
+
+        return setupShmVideoConsumer();
+    }
+
+    bool vst::ConsumerApp::setupShmVideoConsumer()
+    {
         // Get frame properties from shared memory header
         const auto &metadata = m_shmVideoHandler->getFrameMetadata();
         m_videoFrameRate = metadata.fps > 0 ? metadata.fps : 30.0;
@@ -319,6 +407,33 @@ namespace vst
 
         LOG_INFO("Opened shared memory for video: " + shmName + " (dimensions: " + videoSize + ")");
 
+        if (m_gpuUpload)
+        {
+            try
+            {
+                context.initHeadless(metadata.width, metadata.height);
+                m_shmTexture = std::make_unique<ShmTexture>(context);
+                if (m_shmVideoHandler->getPixelFormat() != memory::ShmPixelFormat::RGBA8)
+                {
+                    m_colorConverter.create(context.getDevice(), context.getPipelineCache());
+                    m_shmTexture->setColorConverter(&m_colorConverter);
+                }
+                m_shmTexture->create(*m_shmVideoHandler);
+                createDrawResources({m_shmTexture->getImageView()}, metadata.width, metadata.height);
+            }
+            catch (const std::exception &e)
+            {
+                LOG_ERR("Failed to set up GPU upload of SHM video: " + std::string(e.what()));
+                m_shmTexture.reset();
+                m_colorConverter.cleanup(context.getDevice());
+                return false;
+            }
+
+            m_videoRunning = true;
+            LOG_INFO("Video consumer initialized, frames are uploaded to the GPU and drawn offscreen");
+            return true;
+        }
+
         // Create window for display
         cv::namedWindow(m_videoWindowTitle, cv::WINDOW_NORMAL | cv::WINDOW_GUI_NORMAL);
         cv::resizeWindow(m_videoWindowTitle, metadata.width, metadata.height);
@@ -340,24 +455,26 @@ namespace vst
 
         LOG_INFO("Starting video consumer loop");
 
-        // Calculate frame delay based on frame rate
-        int frameDelay = std::max(1, static_cast<int>(1000.0 / m_videoFrameRate));
-
-        // Main loop
-        cv::Mat frame;
+        // Main loop: readFrame blocks until the producer publishes, so the
+        // producer's frame rate paces this loop. Frames are leased in place
+        // and only copied by the display conversion.
+        vst::memory::ShmVideoFrameLease lease;
         size_t frameCount = 0;
         uint64_t lastTimestamp = 0;
 
-        while (m_videoRunning)
+        std::unique_ptr<BenchmarkLogger> latencyLogger;
+        if (!m_latencyLogPath.empty())
         {
-            // Measure the start time of this frame processing
-            auto frameStart = std::chrono::steady_clock::now();
+            latencyLogger = std::make_unique<BenchmarkLogger>(m_latencyLogPath);
+        }
 
+        while (m_videoRunning)
+        {
             // Try to read a frame from shared memory
             bool frameRead = false;
             try
             {
-                frameRead = m_shmVideoHandler->readFrame(frame, true);
+                frameRead = m_shmVideoHandler->acquireFrame(lease, true);
             }
             catch (const std::exception &e)
             {
@@ -376,17 +493,46 @@ namespace vst
                     break;
                 }
 
-                // No new frame yet, sleep briefly and try again
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                // Timed out without a new frame, wait again
                 continue;
             }
+            uint64_t acquireTimeNs = monotonicNowNs();
+            uint64_t decodeTimeNs = lease.decodeTimeNs();
+            uint64_t publishTimeNs = lease.publishTimeNs();
 
-            // Display the frame
-            if (!frame.empty())
+            // Display the frame, or copy it into the texture straight from the leased slot and draw that
+            const cv::Mat &frame = lease.frame();
+            if (m_shmTexture)
+            {
+                try
+                {
+                    // The texture keeps the lease until the GPU has read the slot
+                    m_shmTexture->upload(std::move(lease));
+                    context.drawFrame(pipeline.get(), pipeline.getLayout(), descriptorManagers[0].getDescriptorSet(),
+                                      vertexBuffer);
+                }
+                catch (const std::exception &e)
+                {
+                    LOG_ERR("Error uploading frame: " + std::string(e.what()));
+                    break;
+                }
+            }
+            else if (!frame.empty())
             {
                 // Convert to BGR for display if needed
                 cv::Mat displayFrame;
-                if (frame.channels() == 4)
+                vst::memory::ShmPixelFormat pixelFormat = m_shmVideoHandler->getPixelFormat();
+                if (pixelFormat == vst::memory::ShmPixelFormat::NV12)
+                {
+                    cv::cvtColor(frame, displayFrame, cv::COLOR_YUV2BGR_NV12);
+                    cv::imshow(m_videoWindowTitle, displayFrame);
+                }
+                else if (pixelFormat == vst::memory::ShmPixelFormat::I420)
+                {
+                    cv::cvtColor(frame, displayFrame, cv::COLOR_YUV2BGR_I420);
+                    cv::imshow(m_videoWindowTitle, displayFrame);
+                }
+                else if (frame.channels() == 4)
                 {
                     cv::cvtColor(frame, displayFrame, cv::COLOR_RGBA2BGR);
                     cv::imshow(m_videoWindowTitle, displayFrame);
@@ -397,8 +543,17 @@ namespace vst
                 }
             }
 
+            uint64_t presentTimeNs = monotonicNowNs();
+            m_decodeToPublish.recordNs(decodeTimeNs, publishTimeNs);
+            m_publishToAcquire.recordNs(publishTimeNs, acquireTimeNs);
+            m_acquireToPresent.recordNs(acquireTimeNs, presentTimeNs);
+            m_endToEnd.recordNs(decodeTimeNs, presentTimeNs);
+
+            // Hand the slot back before blocking in the window event loop
+            lease.release();
+
             // Process window events and check for key press
-            int key = cv::waitKey(1);
+            int key = m_shmTexture ? -1 : cv::waitKey(1);
             if (key == 27 || key == 'q') // ESC or 'q' key
             {
                 LOG_INFO("User pressed exit key");
@@ -407,39 +562,174 @@ namespace vst
             }
 
             // If user clicks the X (closes the window)
-            if (cv::getWindowProperty(m_videoWindowTitle, cv::WND_PROP_VISIBLE) < 1)
+            if (!m_shmTexture && cv::getWindowProperty(m_videoWindowTitle, cv::WND_PROP_VISIBLE) < 1)
             {
                 std::cout << "Window was closed by user" << std::endl;
                 break;
             }
 
-            // Measure how long this frame took to process
-            auto frameEnd = std::chrono::steady_clock::now();
-            auto processingTime = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                      frameEnd - frameStart)
-                                      .count();
-
-            // Sleep for the remaining time to maintain frame rate
-            int remainingTime = frameDelay - static_cast<int>(processingTime);
-            if (remainingTime > 0)
-            {
-                std::this_thread::sleep_for(std::chrono::milliseconds(remainingTime));
-            }
-
             // Log progress every 100 frames
             frameCount++;
             if (frameCount % 100 == 0)
             {
                 LOG_INFO("Consumed " + std::to_string(frameCount) + " frames");
             }
+            if (frameCount % 1000 == 0)
+            {
+                logLatency(latencyLogger.get());
+            }
         }
 
         // Clean up
         cv::destroyAllWindows();
+        logLatency(latencyLogger.get());
 
         LOG_INFO("Video consumer loop ended after " + std::to_string(frameCount) + " frames");
     }
 
+    bool vst::ConsumerApp::consumeDmaHeap(const std::string &socketPath)
+    {
+        this->mode = "heap";
+        LOG_INFO("Connecting to DMA-BUF heap producer: " + socketPath);
+
+        int sock_fd = ipc::connect_control_socket(socketPath);
+        if (sock_fd < 0)
+        {
+            LOG_ERR("Failed to connect to producer via socket: " + socketPath);
+            return false;
+        }
+
+        // Heap buffers are linear RGBA; the pitch and size come with the description
+        ipc::ControlMessageType messageType;
+        ipc::ImageDescription desc{};
+        std::vector<int> fds;
+        if (ipc::receive_control_message(sock_fd, messageType, &desc, sizeof(desc), &fds) < 0 ||
+            messageType != ipc::ControlMessageType::ImageDesc || fds.empty() || fds.size() != desc.imageCount ||
+            desc.format != VK_FORMAT_R8G8B8A8_UNORM || desc.planeRowPitches[0] < desc.width * 4ull ||
+            desc.allocationSize < desc.planeOffsets[0] + desc.planeRowPitches[0] * desc.height)
+        {
+            for (int fd : fds)
+                close(fd);
+            close(sock_fd);
+            LOG_ERR("Failed to receive a DMA-BUF heap description from producer");
+            return false;
+        }
+
+        controlSocketFd = sock_fd;
+        fcntl(controlSocketFd, F_SETFL, fcntl(controlSocketFd, F_GETFL, 0) | O_NONBLOCK);
+        imageWidth = desc.width;
+        imageHeight = desc.height;
+        m_heapRowPitch = desc.planeRowPitches[0];
+
+        // Each import takes ownership of its fd
+        for (size_t i = 0; i < fds.size(); ++i)
+        {
+            memory::DmaBuffer buffer;
+            if (!memory::DmaBufHandler::import(fds[i], desc.allocationSize, false, buffer))
+            {
+                for (size_t j = i + 1; j < fds.size(); ++j)
+                    close(fds[j]);
+                return false;
+            }
+            m_heapBuffers.push_back(buffer);
+        }
+
+        std::string videoSize = std::to_string(desc.width) + "x" + std::to_string(desc.height);
+        m_videoWindowTitle = "Consumer - DMA-BUF heap " + videoSize;
+        cv::namedWindow(m_videoWindowTitle, cv::WINDOW_NORMAL | cv::WINDOW_GUI_NORMAL);
+        cv::resizeWindow(m_videoWindowTitle, desc.width, desc.height);
+
+        m_videoRunning = true;
+        LOG_INFO("Mapped " + std::to_string(m_heapBuffers.size()) + " DMA-BUF heap buffers (" + videoSize +
+                 ", pitch " + std::to_string(m_heapRowPitch) + ")");
+        return true;
+    }
+
+    void vst::ConsumerApp::runHeapLoop()
+    {
+        if (m_heapBuffers.empty() || !m_videoRunning)
+        {
+            LOG_ERR("Cannot run heap loop - DMA-BUF heap consumer not initialized");
+            return;
+        }
+
+        cv::Mat displayFrame;
+        bool shown = false;
+        size_t frameCount = 0;
+
+        while (m_videoRunning && producerConnected)
+        {
+            // Sleep until the producer says something, but keep the window responsive
+            pollfd pfd{controlSocketFd, POLLIN, 0};
+            poll(&pfd, 1, 10);
+
+            uint64_t previousFrame = lastReadyFrame;
+            pollControlMessages();
+
+            // Stills are shown once; video buffers whenever a newer one is announced
+            if (!shown || lastReadyFrame != previousFrame)
+            {
+                const memory::DmaBuffer &buffer = m_heapBuffers[currentImage];
+                if (memory::DmaBufHandler::beginCpuAccess(buffer, false))
+                {
+                    // The display conversion is the only copy, read straight out of the shared buffer
+                    cv::Mat frame(imageHeight, imageWidth, CV_8UC4, buffer.data, m_heapRowPitch);
+                    cv::cvtColor(frame, displayFrame, cv::COLOR_RGBA2BGR);
+                    memory::DmaBufHandler::endCpuAccess(buffer, false);
+
+                    cv::imshow(m_videoWindowTitle, displayFrame);
+                    shown = true;
+                    frameCount++;
+                    if (frameCount % 100 == 0)
+                    {
+                        LOG_INFO("Consumed " + std::to_string(frameCount) + " frames");
+                    }
+                }
+            }
+
+            // Process window events and check for key press
+            int key = cv::waitKey(1);
+            if (key == 27 || key == 'q') // ESC or 'q' key
+            {
+                LOG_INFO("User pressed exit key");
+                m_videoRunning = false;
+                break;
+            }
+
+            // If user clicks the X (closes the window)
+            if (cv::getWindowProperty(m_videoWindowTitle, cv::WND_PROP_VISIBLE) < 1)
+            {
+                std::cout << "Window was closed by user" << std::endl;
+                break;
+            }
+        }
+
+        cv::destroyAllWindows();
+        LOG_INFO("DMA-BUF heap consumer loop ended after " + std::to_string(frameCount) + " frames");
+    }
+
+    void vst::ConsumerApp::logLatency(BenchmarkLogger *logger)
+    {
+        if (m_endToEnd.count() == 0)
+        {
+            return;
+        }
+
+        LOG_INFO("SHM video latency p50/p99/p999 (ms): end-to-end " +
+                 std::to_string(m_endToEnd.percentile(50.0)) + "/" +
+                 std::to_string(m_endToEnd.percentile(99.0)) + "/" +
+                 std::to_string(m_endToEnd.percentile(99.9)));
+
+        if (logger)
+        {
+            logger->logPercentiles("shm_decode_to_publish", m_decodeToPublish);
+            logger->logPercentiles("shm_publish_to_acquire", m_publishToAcquire);
+            logger->logPercentiles("shm_acquire_to_present", m_acquireToPresent);
+            logger->logPercentiles("shm_end_to_end", m_endToEnd);
+            logger->flush();
+        }
+    }
+
     bool vst::ConsumerApp::readFrame(cv::Mat &frame)
     {
         // Check if this is a video consumer
@@ -456,56 +746,160 @@ namespace vst
         }
     }
 
+    void ConsumerApp::pollControlMessages()
+    {
+        if (controlSocketFd < 0)
+        {
+            return;
+        }
+
+        // Drain everything the producer sent since the last frame
+        ipc::ControlMessageType type;
+        union
+        {
+            ipc::FrameReady frame;
+            ipc::SyncDescription sync;
+        } payload{};
+        std::vector<int> fds;
+        while (ipc::receive_control_message(controlSocketFd, type, &payload, sizeof(payload), &fds) == 0)
+        {
+            // Every message carries at most one fd
+            int fd = fds.empty() ? -1 : fds[0];
+            for (size_t i = 1; i < fds.size(); ++i)
+                close(fds[i]);
+
+            if (type == ipc::ControlMessageType::SyncDesc)
+            {
+                auto mode = static_cast<sync::SyncMode>(payload.sync.mode);
+                if (context.hasExternalSemaphoreFd())
+                {
+                    m_sync.initConsumer(context.getDevice(), context.getPhysicalDevice(), mode, fd,
+                                        context.hasTimelineSemaphores());
+                }
+                else
+                {
+                    LOG_WARN("Producer shares semaphores but VK_KHR_external_semaphore_fd is missing here");
+                    if (fd >= 0)
+                        close(fd);
+                }
+            }
+            else if (type == ipc::ControlMessageType::FrameReady)
+            {
+                const ipc::FrameReady &frame = payload.frame;
+                lastReadyFrame = frame.frameIndex;
+                if (frame.imageIndex < std::max(descriptorManagers.size(), m_heapBuffers.size()))
+                {
+                    currentImage = frame.imageIndex;
+                }
+                m_sync.onFrameReady(frame.signalValue, fd);
+            }
+            else if (fd >= 0)
+            {
+                close(fd);
+            }
+            else if (type == ipc::ControlMessageType::Bye)
+            {
+                LOG_INFO("Producer closed the DMA-BUF session");
+                producerConnected = false;
+            }
+        }
+
+        // EAGAIN just means nothing is pending; anything else ends the session
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            producerConnected = false;
+        }
+        if (!producerConnected)
+        {
+            close(controlSocketFd);
+            controlSocketFd = -1;
+        }
+    }
+
     void ConsumerApp::runFrame()
     {
+        // Sleep first, so the ring image picked below is the newest one when the frame is drawn
+        context.paceFrame();
+        pollControlMessages();
+
+        // Let the GPU hold the draw until the producer's upload of this image has landed
+        VkSemaphore waitSemaphore = VK_NULL_HANDLE;
+        uint64_t waitValue = 0;
+        m_sync.acquireWait(waitSemaphore, waitValue);
+
         context.drawFrame(
             pipeline.get(),
             pipeline.getLayout(),
-            descriptorManager.getDescriptorSet(),
-            vertexBuffer);
+            descriptorManagers[currentImage].getDescriptorSet(),
+            vertexBuffer,
+            waitSemaphore,
+            waitValue);
     }
 
-    // Get the imported image for external use
+    // Get the imported image currently shown, for external use
     VkImage ConsumerApp::getImportedImage() const
     {
-        return importedImage;
+        return importedImages.empty() ? VK_NULL_HANDLE : importedImages[currentImage];
     }
 
     void vst::ConsumerApp::cleanup()
     {
         if (this->mode == "dma")
         {
+            if (controlSocketFd >= 0)
+            {
+                ipc::send_bye(controlSocketFd);
+                close(controlSocketFd);
+                controlSocketFd = -1;
+            }
+
+            // Nothing may still be waiting on the shared semaphore or sampling the imports
+            vkDeviceWaitIdle(context.getDevice());
+            m_sync.destroy();
+
             // Your existing DMA cleanup code
-            if (importedImageView)
+            for (VkImageView view : importedImageViews)
             {
-                vkDestroyImageView(context.getDevice(), importedImageView, nullptr);
-                importedImageView = VK_NULL_HANDLE;
+                vkDestroyImageView(context.getDevice(), view, nullptr);
             }
-            if (importedImage)
+            for (VkImage image : importedImages)
             {
-                vkDestroyImage(context.getDevice(), importedImage, nullptr);
-                importedImage = VK_NULL_HANDLE;
+                vkDestroyImage(context.getDevice(), image, nullptr);
             }
-            if (importedMemory)
+            for (VkDeviceMemory memory : importedMemories)
             {
-                vkFreeMemory(context.getDevice(), importedMemory, nullptr);
-                importedMemory = VK_NULL_HANDLE;
+                vkFreeMemory(context.getDevice(), memory, nullptr);
             }
-            if (vertexBuffer)
+            importedImageViews.clear();
+            importedImages.clear();
+            importedMemories.clear();
+            destroyDrawResources();
+            context.cleanup();
+        }
+        else if (this->mode == "heap")
+        {
+            m_videoRunning = false;
+            if (controlSocketFd >= 0)
             {
-                vkDestroyBuffer(context.getDevice(), vertexBuffer, nullptr);
-                vkFreeMemory(context.getDevice(), vertexBufferMemory, nullptr);
-                vertexBuffer = VK_NULL_HANDLE;
-                vertexBufferMemory = VK_NULL_HANDLE;
+                ipc::send_bye(controlSocketFd);
+                close(controlSocketFd);
+                controlSocketFd = -1;
             }
-            if (descriptorPool)
+
+            for (memory::DmaBuffer &buffer : m_heapBuffers)
             {
-                descriptorManager.cleanup(context.getDevice());
-                vkDestroyDescriptorPool(context.getDevice(), descriptorPool, nullptr);
-                descriptorPool = VK_NULL_HANDLE;
+                memory::DmaBufHandler::release(buffer);
+            }
+            m_heapBuffers.clear();
+
+            try
+            {
+                cv::destroyAllWindows();
+            }
+            catch (...)
+            {
+                LOG_INFO("Error destroying OpenCV windows");
             }
-            pipeline.cleanup(context.getDevice());
-            context.cleanup();
         }
         else if (this->mode == "shm")
         {
@@ -517,6 +911,17 @@ namespace vst
                 // Stop the video loop
                 m_videoRunning = false;
 
+                // The texture's imported buffers point into the mapping closed below,
+                // and queued draws still sample it
+                if (m_shmTexture)
+                {
+                    vkDeviceWaitIdle(context.getDevice());
+                    m_shmTexture.reset();
+                    destroyDrawResources();
+                    m_colorConverter.cleanup(context.getDevice());
+                    context.cleanup();
+                }
+
                 // Destroy any open OpenCV windows
                 try
                 {
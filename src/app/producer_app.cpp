@@ -3,6 +3,7 @@
 #include <sys/socket.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <cerrno>
 #include <cstring>
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
@@ -15,18 +16,22 @@
 #include "media/image_loader.hpp"
 #include "media/video_loader.hpp"
 #include "ipc/fd_passing.hpp"
+#include "ipc/control_server.hpp"
+#include "core/vulkan_utils.hpp"
+#include "tools/benchmark.hpp"
 #include "utils/logger.hpp"
 #include "shm/shm_writer.hpp"
 #include "shm/shm_viewer.hpp"
 #include "memory/shm_handler.hpp"
 #include "memory/shm_video_handler.hpp"
+#include "memory/dma_buf_handler.hpp"
 #include "stb_image.h"
 #include "utils/file_utils.hpp"
 
 namespace vst
 {
-    void createDescriptorPool(VkDevice device, VkDescriptorPool &pool);
-    static void createVertexBuffer(VkDevice device, VkPhysicalDevice phys, VkBuffer &buffer, VkDeviceMemory &memory, const std::vector<vst::Vertex> &vertices);
+    void createDescriptorPool(VkDevice device, VkDescriptorPool &pool, uint32_t maxSets = 1);
+    static void createVertexBuffer(memory::DeviceAllocator &allocator, VkBuffer &buffer, memory::Allocation &allocation, const std::vector<vst::Vertex> &vertices);
 
     ProducerApp::ProducerApp()
         : context(*(new VulkanContext()))
@@ -45,7 +50,7 @@ namespace vst
 
     void ProducerApp::update()
     {
-        if (this->isVideo && this->mode == "dma" && videoTexture && videoLoader)
+        if (this->isVideo && this->mode == "dma" && !videoRing.empty() && videoLoader)
         {
             // Add debug logging to verify this method is being called
             static int frameCount = 0;
@@ -63,10 +68,16 @@ namespace vst
                 return;
             }
 
-            // Update the video texture with the new frame
+            // Upload into the next ring image, then make it current; consumers
+            // keep sampling the previous image until they hear about this one
             try
             {
-                videoTexture->updateFromFrame(frame);
+                // With a shared semaphore the upload is only queued; consumers wait for it on the GPU
+                uint32_t nextIndex = (ringIndex + 1) % static_cast<uint32_t>(videoRing.size());
+                uint64_t signalValue = m_sync.nextSignalValue();
+                videoRing[nextIndex]->updateFromFrame(frame, m_sync.getSignalSemaphore(), signalValue);
+                ringIndex = nextIndex;
+                notifyFrameReady(frameCount, ringIndex, signalValue, m_sync.exportFrameFd());
                 frameCount++;
             }
             catch (const std::exception &e)
@@ -247,11 +258,75 @@ namespace vst
         return true;
     }
 
+    // Describes an exported RGBA image so consumers can import it without guessing
+    static ipc::ImageDescription describeExportedImage(const VulkanContext &context, VkImage image,
+                                                       uint32_t width, uint32_t height,
+                                                       VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL)
+    {
+        ipc::ImageDescription desc{};
+        desc.width = width;
+        desc.height = height;
+        desc.format = VK_FORMAT_R8G8B8A8_UNORM;
+        desc.tiling = tiling;
+        desc.drmModifier = ipc::kDrmFormatModInvalid;
+
+        // Same requirements and memory type the texture code allocated with
+        VkMemoryRequirements memReq;
+        vkGetImageMemoryRequirements(context.getDevice(), image, &memReq);
+        desc.allocationSize = memReq.size;
+        desc.memoryTypeIndex = vulkan_utils::findMemoryType(context.getPhysicalDevice(), memReq.memoryTypeBits,
+                                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        VkPhysicalDeviceMemoryProperties memProps;
+        vkGetPhysicalDeviceMemoryProperties(context.getPhysicalDevice(), &memProps);
+        desc.memoryPropertyFlags = memProps.memoryTypes[desc.memoryTypeIndex].propertyFlags;
+
+        // Optimal tiling has no host-visible layout; only linear images have one to report
+        desc.planeCount = 1;
+        if (tiling == VK_IMAGE_TILING_LINEAR)
+        {
+            VkImageSubresource subresource{VK_IMAGE_ASPECT_COLOR_BIT, 0, 0};
+            VkSubresourceLayout layout;
+            vkGetImageSubresourceLayout(context.getDevice(), image, &subresource, &layout);
+            desc.planeOffsets[0] = layout.offset;
+            desc.planeRowPitches[0] = layout.rowPitch;
+        }
+
+        VkPhysicalDeviceIDProperties idProps{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
+        VkPhysicalDeviceProperties2 props{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+        props.pNext = &idProps;
+        vkGetPhysicalDeviceProperties2(context.getPhysicalDevice(), &props);
+        std::memcpy(desc.deviceUuid, idProps.deviceUUID, VK_UUID_SIZE);
+
+        return desc;
+    }
+
     void ProducerApp::ProducerDMA(GLFWwindow *window, const std::string &filePath, const std::string &mode, bool isVideo)
     {
         this->isVideo = isVideo;
         this->mode = mode;
-        context.init(window);
+        if (window)
+        {
+            context.init(window);
+        }
+        else
+        {
+            // Headless: render offscreen at the size a window would have had
+            uint32_t width = 0, height = 0;
+            if (isVideo)
+            {
+                VideoInfo videoInfo = VideoLoader::getVideoResolution(filePath);
+                width = videoInfo.valid ? static_cast<uint32_t>(videoInfo.width) : 0;
+                height = videoInfo.valid ? static_cast<uint32_t>(videoInfo.height) : 0;
+            }
+            else
+            {
+                vst::utils::ImageSize imageSize = vst::utils::getImageSize(filePath);
+                width = static_cast<uint32_t>(std::max(imageSize.width, 0));
+                height = static_cast<uint32_t>(std::max(imageSize.height, 0));
+            }
+            context.initHeadless(width, height);
+        }
 
         if (isVideo)
         {
@@ -282,47 +357,66 @@ namespace vst
                 throw std::runtime_error("Failed to read first frame from video");
             }
 
-            // Create a texture for the video
-            videoTexture = std::make_unique<TextureVideo>(context);
-            if (!videoTexture->createFromSize(firstFrame.cols, firstFrame.rows))
+            // Create the ring of exported video textures; the producer always
+            // uploads into the image after the one consumers were last told about
+            videoRing.clear();
+
+            // Decoded frames are copied as is and converted by a compute dispatch;
+            // without the shader the textures fall back to converting on the CPU
+            try
             {
-                throw std::runtime_error("Failed to create video texture");
+                colorConvert.create(context.getDevice(), context.getPipelineCache());
             }
+            catch (const std::exception &e)
+            {
+                LOG_WARN("GPU colour conversion unavailable, converting on the CPU: " << e.what());
+            }
+
+            for (uint32_t i = 0; i < dmaRingSize; ++i)
+            {
+                auto ringTexture = std::make_unique<TextureVideo>(context);
+                ringTexture->setColorConverter(colorConvert.get() ? &colorConvert : nullptr);
+                if (!ringTexture->createFromSize(firstFrame.cols, firstFrame.rows))
+                {
+                    throw std::runtime_error("Failed to create video texture");
+                }
+
+                // Start every image with the first frame so none is ever sampled uninitialised
+                ringTexture->updateFromFrame(firstFrame);
+                videoRing.push_back(std::move(ringTexture));
+            }
+            ringIndex = 0;
 
             // Reset the video to the beginning
             videoLoader->getCapture().set(cv::CAP_PROP_POS_FRAMES, 0);
 
-            // Update texture with first frame
-            videoTexture->updateFromFrame(firstFrame);
+            // Setup descriptors and pipeline for rendering, one set per ring image
+            createDescriptorPool(context.getDevice(), descriptorPool, dmaRingSize);
 
-            // Setup descriptors and pipeline for rendering
-            createDescriptorPool(context.getDevice(), descriptorPool);
-
-            // Initialize descriptor manager with video texture
-            TextureImage texture;
-            texture.image = videoTexture->getImage();
-            texture.memory = videoTexture->getMemory();
-            texture.view = videoTexture->getImageView();
-            texture.sampler = videoTexture->getSampler();
-            texture.width = width;
-            texture.height = height;
+            ringDescriptors.resize(videoRing.size());
+            for (size_t i = 0; i < videoRing.size(); ++i)
+            {
+                TextureImage texture;
+                texture.image = videoRing[i]->getImage();
+                texture.memory = videoRing[i]->getMemory();
+                texture.view = videoRing[i]->getImageView();
+                texture.sampler = videoRing[i]->getSampler();
+                texture.width = width;
+                texture.height = height;
+                ringDescriptors[i].init(context.getDevice(), descriptorPool, texture);
+            }
 
-            descriptorManager.init(context.getDevice(), descriptorPool, texture);
+            // The set layouts are identically defined, so any ring set binds against this pipeline
             pipeline.create(context.getDevice(), context.getSwapchainExtent(),
-                            context.getRenderPass(), descriptorManager.getLayout());
+                            context.getRenderPass(), ringDescriptors[0].getLayout(), context.getPipelineCache());
 
             createVertexBuffer(
-                context.getDevice(),
-                context.getPhysicalDevice(),
+                context.getAllocator(),
                 vertexBuffer,
-                vertexBufferMemory,
+                vertexBufferAllocation,
                 FULLSCREEN_QUAD);
 
-            // Export the texture via DMA-BUF
-            VkMemoryGetFdInfoKHR getFdInfo{VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR};
-            getFdInfo.memory = videoTexture->getMemory();
-            getFdInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
-
+            // Export every ring texture via DMA-BUF
             auto vkGetMemoryFdKHR = reinterpret_cast<PFN_vkGetMemoryFdKHR>(
                 vkGetDeviceProcAddr(context.getDevice(), "vkGetMemoryFdKHR"));
 
@@ -331,17 +425,31 @@ namespace vst
                 throw std::runtime_error("vkGetMemoryFdKHR is not available on this device.");
             }
 
-            int fd = -1;
-            if (vkGetMemoryFdKHR(context.getDevice(), &getFdInfo, &fd) != VK_SUCCESS)
+            std::vector<int> fds;
+            for (const auto &ringTexture : videoRing)
             {
-                throw std::runtime_error("Failed to export DMA-BUF for video texture.");
+                VkMemoryGetFdInfoKHR getFdInfo{VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR};
+                getFdInfo.memory = ringTexture->getMemory();
+                getFdInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
+
+                int fd = -1;
+                if (vkGetMemoryFdKHR(context.getDevice(), &getFdInfo, &fd) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("Failed to export DMA-BUF for video texture.");
+                }
+                fds.push_back(fd);
             }
 
             std::string shmName = "/tmp/vulkan_shared_video-" + std::to_string(width) + "x" + std::to_string(height) + ".sock";
-            LOG_INFO("Creating DMA-BUF socket for video: " + shmName);
+            LOG_INFO("Creating DMA-BUF socket for video: " + shmName + " (" + std::to_string(fds.size()) + " images)");
             this->shmName = shmName;
 
-            setupDmaSocket(shmName, fd, width, height);
+            if (context.hasExternalSemaphoreFd())
+            {
+                m_sync.initProducer(context.getDevice(), context.getPhysicalDevice(), context.hasTimelineSemaphores());
+            }
+
+            setupDmaSocket(shmName, fds, describeExportedImage(context, videoRing[0]->getImage(), width, height));
 
             // std::thread([fd, this, shmName, width, height]()
             //             {
@@ -362,19 +470,20 @@ namespace vst
         else
         {
             // Existing image handling code
-            TextureImage texture;
+            TextureImage &texture = imageTexture;
             texture = ImageLoader::loadTexture(filePath, context.getDevice(), context.getPhysicalDevice(),
-                                               context.getCommandPool(), context.getGraphicsQueue(), mode == "dma");
+                                               context.getGraphicsSubmitQueue(), context.getTransferSubmitQueue(),
+                                               mode == "dma", &context.getAllocator());
 
             createDescriptorPool(context.getDevice(), descriptorPool);
             descriptorManager.init(context.getDevice(), descriptorPool, texture);
-            pipeline.create(context.getDevice(), context.getSwapchainExtent(), context.getRenderPass(), descriptorManager.getLayout());
+            pipeline.create(context.getDevice(), context.getSwapchainExtent(), context.getRenderPass(), descriptorManager.getLayout(),
+                            context.getPipelineCache());
 
             createVertexBuffer(
-                context.getDevice(),
-                context.getPhysicalDevice(),
+                context.getAllocator(),
                 vertexBuffer,
-                vertexBufferMemory,
+                vertexBufferAllocation,
                 FULLSCREEN_QUAD);
 
             VkMemoryGetFdInfoKHR getFdInfo{VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR};
@@ -398,19 +507,8 @@ namespace vst
             LOG_INFO("Creating shared memory segment: " + shmName);
             this->shmName = shmName;
 
-            std::thread([fd, this, shmName, texture]()
-                        {
-            LOG_INFO("Waiting for consumer connection on socket...");
-            int server_fd = ipc::setup_unix_server_socket(shmName);
-            int client_fd = accept(server_fd, nullptr, nullptr);
-            if (client_fd >= 0)
-            {
-                vst::ipc::send_fd_with_info(client_fd, fd, texture.width, texture.height);
-                LOG_INFO("Sent FD to consumer via Unix socket.");
-                close(client_fd);
-            }
-            close(server_fd); })
-                .detach();
+            // Consumers are served from runFrame() like the video path
+            setupDmaSocket(shmName, {fd}, describeExportedImage(context, texture.image, texture.width, texture.height));
         }
     }
 
@@ -446,15 +544,38 @@ namespace vst
             this->shmName = shmName;
 
             // Make sure any previous instances are cleaned up
-            shm_unlink(shmName.c_str());
+            vst::memory::ShmVideoHandler::removeSharedMemory(shmName);
 
             // Create shared memory handler for video
             auto shmHandler = std::make_shared<vst::memory::ShmVideoHandler>();
-            if (!shmHandler->createSharedMemory(shmName, width, height, 4)) // RGBA format
+            if (!shmHandler->createSharedMemory(shmName, width, height, shmPixelFormat,
+                                                vst::memory::kDefaultSlotCount, backpressurePolicy, shmVideoOptions))
             {
                 throw std::runtime_error("Failed to create shared memory for video");
             }
 
+            if (shmVideoOptions.memfd)
+            {
+                // Nothing appears in /dev/shm; consumers get the segment fd from this socket,
+                // and the segment describes itself, so the description only names the stream
+                ipc::ImageDescription desc{};
+                desc.width = static_cast<uint32_t>(width);
+                desc.height = static_cast<uint32_t>(height);
+                desc.drmModifier = ipc::kDrmFormatModInvalid;
+
+                shmSocketPath = "/tmp/vst_memfd_video-" + std::to_string(width) + "x" + std::to_string(height) + ".sock";
+                int segmentFd = dup(shmHandler->getSegmentFd());
+                if (segmentFd < 0)
+                {
+                    throw std::runtime_error("Failed to duplicate the memfd video segment: " + std::string(strerror(errno)));
+                }
+                if (!setupDmaSocket(shmSocketPath, {segmentFd}, desc))
+                {
+                    throw std::runtime_error("Failed to start socket server for the memfd video segment");
+                }
+                LOG_INFO("Sharing memfd video segment on: " + shmSocketPath);
+            }
+
             // Create OpenCV window for display
             std::string windowName = "Producer - SHM Video " + std::to_string(width) + "x" + std::to_string(height);
             cv::namedWindow(windowName, cv::WINDOW_NORMAL | cv::WINDOW_GUI_NORMAL);
@@ -501,72 +622,174 @@ namespace vst
         }
     }
 
-    void createDescriptorPool(VkDevice device, VkDescriptorPool &pool)
+    void ProducerApp::ProducerHeap(const std::string &filePath, bool isVideo)
     {
-        VkDescriptorPoolSize poolSize{};
-        poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSize.descriptorCount = 1;
+        this->isVideo = isVideo;
+        this->mode = "heap";
+        LOG_INFO("Running in DMA-BUF heap mode with " + std::string(isVideo ? "video" : "image") + ": " + filePath);
 
-        VkDescriptorPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
-        poolInfo.poolSizeCount = 1;
-        poolInfo.pPoolSizes = &poolSize;
-        poolInfo.maxSets = 1;
+        if (!memory::DmaBufHandler::isHeapAvailable())
+        {
+            throw std::runtime_error("DMA-BUF heap is not available: " + std::string(memory::kSystemDmaHeap));
+        }
 
-        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t imageCount = 1;
+        stbi_uc *pixels = nullptr;
+        if (isVideo)
         {
-            throw std::runtime_error("Failed to create descriptor pool.");
+            videoLoader = std::make_unique<VideoLoader>();
+            if (!videoLoader->open(filePath))
+            {
+                throw std::runtime_error("Failed to open video file: " + filePath);
+            }
+            cv::VideoCapture &cap = videoLoader->getCapture();
+            width = static_cast<uint32_t>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
+            height = static_cast<uint32_t>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+            imageCount = dmaRingSize;
+        }
+        else
+        {
+            int texWidth, texHeight, texChannels;
+            pixels = stbi_load(filePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+            if (!pixels)
+            {
+                throw std::runtime_error("Failed to load image for DMA-BUF heap.");
+            }
+            width = static_cast<uint32_t>(texWidth);
+            height = static_cast<uint32_t>(texHeight);
         }
+
+        // Rows are padded so a GPU could also import the buffers as linear images
+        heapFrameSize = cv::Size(static_cast<int>(width), static_cast<int>(height));
+        heapRowPitch = memory::DmaBufHandler::alignedRowPitch(static_cast<size_t>(width) * 4);
+        size_t frameSize = heapRowPitch * height;
+        heapRing.resize(imageCount);
+        for (memory::DmaBuffer &buffer : heapRing)
+        {
+            if (!memory::DmaBufHandler::allocate(frameSize, buffer))
+            {
+                stbi_image_free(pixels);
+                throw std::runtime_error("Failed to allocate DMA-BUF heap buffer.");
+            }
+        }
+        ringIndex = 0;
+
+        if (pixels)
+        {
+            memory::DmaBuffer &buffer = heapRing[0];
+            memory::DmaBufHandler::beginCpuAccess(buffer, true);
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                std::memcpy(static_cast<uint8_t *>(buffer.data) + y * heapRowPitch,
+                            pixels + static_cast<size_t>(y) * width * 4, static_cast<size_t>(width) * 4);
+            }
+            memory::DmaBufHandler::endCpuAccess(buffer, true);
+            stbi_image_free(pixels);
+        }
+
+        // Linear RGBA with an explicit pitch; no memory type or device, nothing here came from a GPU
+        ipc::ImageDescription desc{};
+        desc.width = width;
+        desc.height = height;
+        desc.format = VK_FORMAT_R8G8B8A8_UNORM;
+        desc.tiling = VK_IMAGE_TILING_LINEAR;
+        desc.drmModifier = memory::kDrmFormatModLinear;
+        desc.allocationSize = frameSize;
+        desc.planeCount = 1;
+        desc.imageCount = imageCount;
+        desc.planeRowPitches[0] = heapRowPitch;
+
+        std::string socketPath = "/tmp/vulkan_heap_" + std::string(isVideo ? "video" : "image") + "-" +
+                                 std::to_string(width) + "x" + std::to_string(height) + ".sock";
+        this->shmName = socketPath;
+
+        // The control server gets its own references, closed along with the socket
+        std::vector<int> fds;
+        for (const memory::DmaBuffer &buffer : heapRing)
+        {
+            int fd = dup(buffer.fd);
+            if (fd < 0)
+            {
+                int error = errno;
+                for (int dupFd : fds)
+                    close(dupFd);
+                throw std::runtime_error("Failed to duplicate a DMA-BUF heap buffer: " + std::string(strerror(error)));
+            }
+            fds.push_back(fd);
+        }
+        if (!setupDmaSocket(socketPath, fds, desc))
+        {
+            throw std::runtime_error("Failed to start DMA-BUF heap socket server.");
+        }
+
+        LOG_INFO("DMA-BUF heap producer sharing " + std::to_string(imageCount) + " buffers of " +
+                 std::to_string(frameSize) + " bytes on " + socketPath);
     }
 
-    static void createVertexBuffer(VkDevice device, VkPhysicalDevice phys, VkBuffer &buffer, VkDeviceMemory &memory, const std::vector<vst::Vertex> &vertices)
+    bool ProducerApp::publishHeapFrame(const cv::Mat &frame, uint64_t frameIndex)
     {
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+        if (heapRing.empty() || frame.empty())
+        {
+            return false;
+        }
 
-        VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
-        bufferInfo.size = bufferSize;
-        bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        uint32_t nextIndex = (ringIndex + 1) % static_cast<uint32_t>(heapRing.size());
+        memory::DmaBuffer &buffer = heapRing[nextIndex];
+        if (frame.size() != heapFrameSize)
+        {
+            LOG_ERR("Frame size " << frame.cols << "x" << frame.rows << " does not match the DMA-BUF heap buffers");
+            return false;
+        }
+        cv::Mat target(heapFrameSize, CV_8UC4, buffer.data, heapRowPitch);
 
-        if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
-            throw std::runtime_error("Failed to create vertex buffer");
+        // Convert straight into the shared buffer, bracketed for cache coherency
+        if (!memory::DmaBufHandler::beginCpuAccess(buffer, true))
+        {
+            return false;
+        }
+        cv::cvtColor(frame, target, frame.channels() == 4 ? cv::COLOR_BGRA2RGBA : cv::COLOR_BGR2RGBA);
+        memory::DmaBufHandler::endCpuAccess(buffer, true);
 
-        VkMemoryRequirements memReq;
-        vkGetBufferMemoryRequirements(device, buffer, &memReq);
+        ringIndex = nextIndex;
+        notifyFrameReady(frameIndex, ringIndex);
+        return true;
+    }
 
-        VkMemoryAllocateInfo allocInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-        allocInfo.allocationSize = memReq.size;
-        allocInfo.memoryTypeIndex = 0;
+    void createDescriptorPool(VkDevice device, VkDescriptorPool &pool, uint32_t maxSets)
+    {
+        VkDescriptorPoolSize poolSize{};
+        poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        poolSize.descriptorCount = maxSets;
 
-        VkPhysicalDeviceMemoryProperties memProps;
-        vkGetPhysicalDeviceMemoryProperties(phys, &memProps);
-        for (uint32_t i = 0; i < memProps.memoryTypeCount; i++)
+        VkDescriptorPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        poolInfo.maxSets = maxSets;
+
+        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
         {
-            if ((memReq.memoryTypeBits & (1 << i)) &&
-                (memProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
-                (memProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
-            {
-                allocInfo.memoryTypeIndex = i;
-                break;
-            }
+            throw std::runtime_error("Failed to create descriptor pool.");
         }
+    }
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
-            throw std::runtime_error("Failed to allocate vertex buffer memory");
-
-        vkBindBufferMemory(device, buffer, memory, 0);
+    static void createVertexBuffer(memory::DeviceAllocator &allocator, VkBuffer &buffer, memory::Allocation &allocation, const std::vector<vst::Vertex> &vertices)
+    {
+        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
 
-        void *data;
-        vkMapMemory(device, memory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device, memory);
+        // Persistent host-visible sub-allocation; the allocator keeps it mapped
+        vulkan_utils::createBuffer(allocator, bufferSize, buffer, allocation, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        memcpy(allocation.mapped, vertices.data(), (size_t)bufferSize);
     }
 
-    bool ProducerApp::setupDmaSocket(const std::string &socketPath, int fd, uint32_t width, uint32_t height)
+    bool ProducerApp::setupDmaSocket(const std::string &socketPath, const std::vector<int> &fds, const ipc::ImageDescription &desc)
     {
         LOG_INFO("=== Setting up DMA socket ===");
         LOG_INFO("Socket path: " + socketPath);
-        LOG_INFO("FD: " + std::to_string(fd));
-        LOG_INFO("Dimensions: " + std::to_string(width) + "x" + std::to_string(height));
+        LOG_INFO("FDs: " + std::to_string(fds.size()));
+        LOG_INFO("Dimensions: " + std::to_string(desc.width) + "x" + std::to_string(desc.height));
 
         // Check if socket already exists and remove it
         if (access(socketPath.c_str(), F_OK) == 0)
@@ -576,53 +799,75 @@ namespace vst
         }
 
         // Store for future connections
-        m_dmaFd = fd;
-        m_texWidth = width;
-        m_texHeight = height;
+        m_dmaFds = fds;
+
+        // Consumers are accepted and notified on the control server's own thread
+        m_controlServer = std::make_unique<ipc::ControlServer>();
+
+        // Tell consumers how to wait for uploads; the timeline semaphore itself is shared once
+        if (m_sync.getMode() != sync::SyncMode::None)
+        {
+            ipc::SyncDescription syncDesc{};
+            syncDesc.mode = static_cast<uint32_t>(m_sync.getMode());
+            m_syncFd = m_sync.exportSemaphoreFd();
+            m_controlServer->setSyncDescription(syncDesc, m_syncFd);
+        }
 
-        // Create server socket
-        m_serverSocketFd = ipc::setup_unix_server_socket(socketPath);
-        if (m_serverSocketFd < 0)
+        if (!m_controlServer->start(socketPath, desc, fds))
         {
             LOG_ERR("Failed to create socket server: " +
                     std::string(strerror(errno)));
+            m_controlServer.reset();
             return false;
         }
 
-        // Set socket to non-blocking mode
-        int flags = fcntl(m_serverSocketFd, F_GETFL, 0);
-        fcntl(m_serverSocketFd, F_SETFL, flags | O_NONBLOCK);
-
-        m_socketServerRunning = true;
         LOG_INFO("DMA-BUF socket server started on: " + socketPath);
         return true;
     }
 
-    void ProducerApp::checkForConnections()
+    void ProducerApp::notifyFrameReady(uint64_t frameIndex, uint32_t imageIndex, uint64_t signalValue, int syncFd)
     {
-        if (!m_socketServerRunning || m_serverSocketFd < 0 || m_dmaFd < 0)
+        if (m_controlServer)
         {
-            return;
+            m_controlServer->notifyFrameReady(frameIndex, imageIndex, monotonicNowNs(), signalValue, syncFd);
+        }
+        else if (syncFd >= 0)
+        {
+            close(syncFd);
         }
+    }
 
-        // Check for a new connection
-        int client_fd = accept(m_serverSocketFd, nullptr, nullptr);
-        if (client_fd >= 0)
+    VkDescriptorSet ProducerApp::currentDescriptorSet() const
+    {
+        return ringDescriptors.empty() ? descriptorManager.getDescriptorSet()
+                                       : ringDescriptors[ringIndex].getDescriptorSet();
+    }
+
+    void ProducerApp::closeDmaSocket()
+    {
+        if (m_controlServer)
+        {
+            m_controlServer->stop();
+            m_controlServer.reset();
+        }
+
+        // Consumers hold their own references to the buffers by now
+        for (int fd : m_dmaFds)
         {
-            LOG_INFO("New consumer connected");
-            vst::ipc::send_fd_with_info(client_fd, m_dmaFd, m_texWidth, m_texHeight);
-            LOG_INFO("Sent FD to consumer");
-            close(client_fd);
+            close(fd);
+        }
+        m_dmaFds.clear();
+
+        if (m_syncFd >= 0)
+        {
+            close(m_syncFd);
+            m_syncFd = -1;
         }
     }
 
     void ProducerApp::runFrame()
     {
         // Make sure these checks are in place
-        if (this->mode == "dma")
-        {
-            checkForConnections();
-        }
         if (!pipeline.get())
         {
             LOG_ERR("Pipeline is null");
@@ -633,7 +878,7 @@ namespace vst
             LOG_ERR("Pipeline layout is null");
             return;
         }
-        if (!descriptorManager.getDescriptorSet())
+        if (!currentDescriptorSet())
         {
             LOG_ERR("Descriptor set is null");
             return;
@@ -649,7 +894,7 @@ namespace vst
             context.drawFrame(
                 pipeline.get(),
                 pipeline.getLayout(),
-                descriptorManager.getDescriptorSet(),
+                currentDescriptorSet(),
                 vertexBuffer);
         }
         catch (const std::exception &e)
@@ -691,12 +936,13 @@ namespace vst
         this->shmName = shmName;
 
         // Make sure any previous instances are cleaned up
-        shm_unlink(shmName.c_str());
+        vst::memory::ShmVideoHandler::removeSharedMemory(shmName);
 
         // Create shared memory handler for video
         auto shmHandler = std::make_shared<vst::memory::ShmVideoHandler>();
-        if (!shmHandler->createSharedMemory(shmName, width, height, 4))
-        { // RGBA format
+        if (!shmHandler->createSharedMemory(shmName, width, height, shmPixelFormat,
+                                            vst::memory::kDefaultSlotCount, backpressurePolicy, shmVideoOptions))
+        {
             LOG_ERR("Failed to create shared memory for video");
             return false;
         }
@@ -729,6 +975,22 @@ namespace vst
                                  now - startTime)
                                  .count();
 
+        // BGR is copied as is and YUV transports convert from BGR inside the handler
+        if (shmPixelFormat == memory::ShmPixelFormat::BGR8 || shmPixelFormat == memory::ShmPixelFormat::NV12 ||
+            shmPixelFormat == memory::ShmPixelFormat::I420)
+        {
+            cv::Mat bgrFrame = frame;
+            if (frame.channels() == 1)
+            {
+                cv::cvtColor(frame, bgrFrame, cv::COLOR_GRAY2BGR);
+            }
+            else if (frame.channels() == 4)
+            {
+                cv::cvtColor(frame, bgrFrame, cv::COLOR_RGBA2BGR);
+            }
+            return this->shmVideoHandler->writeFrame(bgrFrame, frameCount++, 0, 30.0, timestamp);
+        }
+
         // Convert to RGBA regardless of input format
         cv::Mat rgbaFrame;
         if (frame.channels() == 1)
@@ -765,7 +1027,7 @@ namespace vst
 
     TextureVideo *ProducerApp::getVideoTexture() const
     {
-        return videoTexture.get();
+        return videoRing.empty() ? videoTexture.get() : videoRing[ringIndex].get();
     }
 
     // bool ProducerApp::initializeDmaBufProducer(GLFWwindow *window, const std::string &dummyPath,
@@ -869,14 +1131,13 @@ namespace vst
 
         LOG_INFO("Creating pipeline");
         pipeline.create(context.getDevice(), context.getSwapchainExtent(),
-                        context.getRenderPass(), descriptorManager.getLayout());
+                        context.getRenderPass(), descriptorManager.getLayout(), context.getPipelineCache());
 
         LOG_INFO("Creating vertex buffer");
         createVertexBuffer(
-            context.getDevice(),
-            context.getPhysicalDevice(),
+            context.getAllocator(),
             vertexBuffer,
-            vertexBufferMemory,
+            vertexBufferAllocation,
             FULLSCREEN_QUAD);
 
         LOG_INFO("=== DMA-BUF producer initialized successfully ===");
@@ -897,15 +1158,7 @@ namespace vst
                 LOG_INFO("Cleaning up video resources shared in dma mode...");
 
                 // close dma socket
-                if (this->mode == "dma")
-                {
-                    m_socketServerRunning = false;
-                    if (m_serverSocketFd >= 0)
-                    {
-                        close(m_serverSocketFd);
-                        m_serverSocketFd = -1;
-                    }
-                }
+                closeDmaSocket();
 
                 // Close the video loader
                 if (videoLoader)
@@ -920,22 +1173,24 @@ namespace vst
                     videoTexture->destroy();
                     videoTexture.reset();
                 }
-
-                // Clean up Vulkan resources
-                if (vertexBuffer != VK_NULL_HANDLE)
+                for (auto &ringTexture : videoRing)
                 {
-                    vkDestroyBuffer(context.getDevice(), vertexBuffer, nullptr);
-                    vertexBuffer = VK_NULL_HANDLE;
+                    ringTexture->destroy();
                 }
+                videoRing.clear();
+                colorConvert.cleanup(context.getDevice());
+                m_sync.destroy();
 
-                if (vertexBufferMemory != VK_NULL_HANDLE)
-                {
-                    vkFreeMemory(context.getDevice(), vertexBufferMemory, nullptr);
-                    vertexBufferMemory = VK_NULL_HANDLE;
-                }
+                // Clean up Vulkan resources
+                vulkan_utils::destroyBuffer(context.getAllocator(), vertexBuffer, vertexBufferAllocation);
 
                 // Clean up descriptors
                 descriptorManager.cleanup(context.getDevice());
+                for (auto &ringDescriptor : ringDescriptors)
+                {
+                    ringDescriptor.cleanup(context.getDevice());
+                }
+                ringDescriptors.clear();
 
                 if (descriptorPool != VK_NULL_HANDLE)
                 {
@@ -960,8 +1215,9 @@ namespace vst
             {
                 // Existing image cleanup code
                 LOG_INFO("Cleaning up image resources shared in dma mode...");
-                vkDestroyBuffer(context.getDevice(), vertexBuffer, nullptr);
-                vkFreeMemory(context.getDevice(), vertexBufferMemory, nullptr);
+                closeDmaSocket();
+                vulkan_utils::destroyBuffer(context.getAllocator(), vertexBuffer, vertexBufferAllocation);
+                TextureImage::destroy(context.getDevice(), imageTexture, &context.getAllocator());
                 descriptorManager.cleanup(context.getDevice());
                 pipeline.cleanup(context.getDevice());
                 vkDestroyDescriptorPool(context.getDevice(), descriptorPool, nullptr);
@@ -970,6 +1226,29 @@ namespace vst
                 ipc::cleanup_unix_socket(this->shmName);
             }
         }
+        else if (this->mode == "heap")
+        {
+            LOG_INFO("Cleaning up DMA-BUF heap resources...");
+            closeDmaSocket();
+
+            if (videoLoader)
+            {
+                videoLoader->close();
+                videoLoader.reset();
+            }
+
+            // Consumers keep their own references; the memory goes once the last one is closed
+            for (memory::DmaBuffer &buffer : heapRing)
+            {
+                memory::DmaBufHandler::release(buffer);
+            }
+            heapRing.clear();
+
+            if (!this->shmName.empty())
+            {
+                ipc::cleanup_unix_socket(this->shmName);
+            }
+        }
         else if (this->mode == "shm")
         {
             if (this->isVideo)
@@ -1001,6 +1280,14 @@ namespace vst
                     videoLoader.reset();
                 }
 
+                // Stop handing out the memfd before closing it
+                closeDmaSocket();
+                if (!shmSocketPath.empty())
+                {
+                    ipc::cleanup_unix_socket(shmSocketPath);
+                    shmSocketPath.clear();
+                }
+
                 // Close the shared memory handler
                 if (shmVideoHandler)
                 {
@@ -1021,7 +1308,7 @@ namespace vst
                     LOG_INFO("Removing shared memory segment: " + this->shmName);
                     try
                     {
-                        shm_unlink(this->shmName.c_str());
+                        vst::memory::ShmVideoHandler::removeSharedMemory(this->shmName);
                     }
                     catch (...)
                     {
@@ -38,11 +38,20 @@ void printUsage(const char *programName)
 {
     std::cerr << "Usage: ./vst_producer [-i <image_path> | -v <video_path>] [--mode=shm|dma | -s | -d]\n";
     std::cerr << "  --input=<socket_path>  Path to socket file\n";
+    std::cerr << "  --latency-log=<csv>    Write SHM video latency percentiles to a CSV file\n";
+    std::cerr << "  --low-latency          Present with MAILBOX/IMMEDIATE and pace frames (DMA-BUF mode)\n";
+    std::cerr << "  --headless             Render offscreen without a window or display (DMA-BUF mode)\n";
+    std::cerr << "  --gpu-upload           Upload SHM video frames to a Vulkan texture and draw them offscreen instead of\n";
+    std::cerr << "                         showing them; bgr, nv12 and i420 frames are converted on the GPU\n";
 }
 
 int main(int argc, char **argv)
 {
     std::string inputName;
+    std::string latencyLogPath;
+    vst::PresentProfile presentProfile = vst::PresentProfile::VSync;
+    bool headless = false;
+    bool gpuUpload = false;
 
     // Parse command line arguments
     for (int i = 1; i < argc; ++i)
@@ -53,6 +62,22 @@ int main(int argc, char **argv)
         {
             inputName = arg.substr(8);
         }
+        else if (arg.find("--latency-log=") == 0)
+        {
+            latencyLogPath = arg.substr(14);
+        }
+        else if (arg == "--low-latency")
+        {
+            presentProfile = vst::PresentProfile::LowLatency;
+        }
+        else if (arg == "--headless")
+        {
+            headless = true;
+        }
+        else if (arg == "--gpu-upload")
+        {
+            gpuUpload = true;
+        }
         else if (arg == "--help" || arg == "-h")
         {
             printUsage(argv[0]);
@@ -96,12 +121,17 @@ int main(int argc, char **argv)
             // For video content (only SHM supported currently)
             LOG_INFO("Creating consumer for video content");
             g_app = new vst::ConsumerApp();
+            g_app->setLatencyLogPath(latencyLogPath);
+            g_app->setGpuUpload(gpuUpload);
 
             // Extract the filename portion for consumeShmVideo
             std::string filename = sharedResource->path.substr(
                 sharedResource->path.find_last_of("/\\") + 1);
 
-            if (g_app->consumeShmVideo(filename))
+            // memfd segments are handed out on a socket, named ones are opened by name
+            bool opened = sharedResource->viaSocket ? g_app->consumeShmVideoSocket(sharedResource->path)
+                                                    : g_app->consumeShmVideo(filename);
+            if (opened)
             {
                 LOG_INFO("Starting video consumption...");
                 g_app->runVideoLoop();
@@ -128,6 +158,39 @@ int main(int argc, char **argv)
             return EXIT_SUCCESS;
         }
     }
+    else if (mode == "heap")
+    {
+        // Plain mapped DMA-BUFs, no Vulkan involved
+        LOG_INFO("Creating consumer for DMA-BUF heap " + type);
+        g_app = new vst::ConsumerApp();
+
+        int result = EXIT_SUCCESS;
+        if (g_app->consumeDmaHeap(inputName.empty() ? sharedResource->path : inputName))
+        {
+            g_app->runHeapLoop();
+        }
+        else
+        {
+            LOG_ERR("Failed to initialize DMA-BUF heap consumer");
+            result = EXIT_FAILURE;
+        }
+
+        delete g_app;
+        return result;
+    }
+    else if (mode == "dma" && headless)
+    {
+        LOG_INFO("Running headless, frames are rendered offscreen");
+        g_app = new vst::ConsumerApp(nullptr, inputName, mode, sharedResource->type == "video");
+
+        while (g_running && g_app->isProducerConnected())
+        {
+            g_app->runFrame();
+        }
+
+        g_app->cleanup();
+        return EXIT_SUCCESS;
+    }
     else if (mode == "dma")
     {
         if (!glfwInit())
@@ -153,11 +216,12 @@ int main(int argc, char **argv)
         }
 
         // Create consumer app
-        g_app = new vst::ConsumerApp(window, inputName, mode, sharedResource->type == "video" ? true : false);
+        g_app = new vst::ConsumerApp(window, inputName, mode, sharedResource->type == "video" ? true : false,
+                                     presentProfile);
 
         // Main loop - will automatically display updated content
         // whether it's a static image or continuously updated video frames
-        while (!glfwWindowShouldClose(window) && g_running)
+        while (!glfwWindowShouldClose(window) && g_running && g_app->isProducerConnected())
         {
             glfwPollEvents();
             g_app->runFrame();
@@ -0,0 +1,152 @@
+#include "core/color_convert_pipeline.hpp"
+#include "core/vulkan_utils.hpp"
+#include "utils/logger.hpp"
+#include <cstdint>
+#include <stdexcept>
+
+// SPIR-V generated by compile_shader() in CMakeLists.txt
+#include "shaders/color_convert.spv.h"
+
+namespace vst
+{
+
+    static constexpr uint32_t kWorkgroupSize = 16; // Matches local_size_x/y in color_convert.comp
+
+    struct ColorConvertParams
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;
+        uint32_t stride;
+    };
+
+    ColorConvertPipeline::ColorConvertPipeline() {}
+
+    ColorConvertPipeline::~ColorConvertPipeline() {}
+
+    void ColorConvertPipeline::create(VkDevice device, VkPipelineCache pipelineCache)
+    {
+        VkDescriptorSetLayoutBinding bindings[2]{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[1].descriptorCount = 1;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+        setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        setLayoutInfo.bindingCount = 2;
+        setLayoutInfo.pBindings = bindings;
+
+        if (vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create colour conversion descriptor set layout.");
+        }
+
+        VkPushConstantRange pushRange{};
+        pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushRange.size = sizeof(ColorConvertParams);
+
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.setLayoutCount = 1;
+        layoutInfo.pSetLayouts = &descriptorSetLayout;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushRange;
+
+        if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        {
+            cleanup(device);
+            throw std::runtime_error("Failed to create colour conversion pipeline layout.");
+        }
+
+        VkShaderModule shaderModule = VK_NULL_HANDLE;
+        try
+        {
+            shaderModule = vulkan_utils::createShaderModule(device, color_convert_spv, sizeof(color_convert_spv));
+        }
+        catch (...)
+        {
+            cleanup(device);
+            throw;
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = shaderModule;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = pipelineLayout;
+
+        VkResult result = vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &computePipeline);
+        vkDestroyShaderModule(device, shaderModule, nullptr);
+        if (result != VK_SUCCESS)
+        {
+            cleanup(device);
+            throw std::runtime_error("Failed to create colour conversion pipeline.");
+        }
+
+        LOG_INFO("Colour conversion pipeline created.");
+    }
+
+    void ColorConvertPipeline::cleanup(VkDevice device)
+    {
+        if (computePipeline)
+            vkDestroyPipeline(device, computePipeline, nullptr);
+        if (pipelineLayout)
+            vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+        if (descriptorSetLayout)
+            vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        computePipeline = VK_NULL_HANDLE;
+        pipelineLayout = VK_NULL_HANDLE;
+        descriptorSetLayout = VK_NULL_HANDLE;
+    }
+
+    void ColorConvertPipeline::updateDescriptorSet(VkDevice device, VkDescriptorSet set, VkBuffer source, VkImageView target) const
+    {
+        VkDescriptorBufferInfo bufferInfo{source, 0, VK_WHOLE_SIZE};
+        VkDescriptorImageInfo imageInfo{VK_NULL_HANDLE, target, VK_IMAGE_LAYOUT_GENERAL};
+
+        VkWriteDescriptorSet writes[2]{};
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet = set;
+        writes[0].dstBinding = 0;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[0].pBufferInfo = &bufferInfo;
+        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[1].dstSet = set;
+        writes[1].dstBinding = 1;
+        writes[1].descriptorCount = 1;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[1].pImageInfo = &imageInfo;
+
+        vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+    }
+
+    void ColorConvertPipeline::record(VkCommandBuffer cmd, VkDescriptorSet set, SourceFormat format,
+                                      uint32_t width, uint32_t height, uint32_t rowStride) const
+    {
+        if (rowStride == 0)
+        {
+            rowStride = format == SourceFormat::BGR24 ? width * 3 : width;
+        }
+        ColorConvertParams params{width, height, static_cast<uint32_t>(format), rowStride};
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &set, 0, nullptr);
+        vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+        vkCmdDispatch(cmd, (width + kWorkgroupSize - 1) / kWorkgroupSize, (height + kWorkgroupSize - 1) / kWorkgroupSize, 1);
+    }
+
+    VkDeviceSize ColorConvertPipeline::sourceSize(SourceFormat format, uint32_t width, uint32_t height)
+    {
+        VkDeviceSize pixels = static_cast<VkDeviceSize>(width) * height;
+        return format == SourceFormat::BGR24 ? pixels * 3 : pixels * 3 / 2;
+    }
+
+} // namespace vst
@@ -1,59 +1,26 @@
 #include "core/pipeline.hpp"
 #include "core/vertex_definitions.hpp"
+#include "core/vulkan_utils.hpp"
 #include "utils/logger.hpp"
-#include <fstream>
+#include <cstdint>
 #include <stdexcept>
 
+// SPIR-V generated by compile_shader() in CMakeLists.txt
+#include "shaders/vertex.spv.h"
+#include "shaders/fragment.spv.h"
+
 namespace vst
 {
 
-    static std::vector<char> readFile(const std::string &filename)
-    {
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
-        if (!file.is_open())
-        {
-            // std::cerr << "[ERROR] Failed to open file: " << filename << "\n";
-            // return;
-            throw std::runtime_error("Failed to open shader file: " + filename);
-        }
-
-        LOG_INFO("[DEBUG] Shader opened: " + filename);
-        size_t fileSize = static_cast<size_t>(file.tellg());
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-        file.close();
-        return buffer;
-    }
-
-    static VkShaderModule createShaderModule(VkDevice device, const std::vector<char> &code)
-    {
-        VkShaderModuleCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
-
-        VkShaderModule shaderModule;
-        if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to create shader module.");
-        }
-
-        return shaderModule;
-    }
-
     Pipeline::Pipeline() {}
 
     Pipeline::~Pipeline() {}
 
-    void Pipeline::create(VkDevice device, VkExtent2D extent, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout)
+    void Pipeline::create(VkDevice device, VkExtent2D extent, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout,
+                          VkPipelineCache pipelineCache)
     {
-        auto vertShaderCode = readFile("/home/shuma/Documents/Bauhaus/10-Thesis/src/VulkanSharedTextures/build/shaders/vertex.spv");
-        auto fragShaderCode = readFile("/home/shuma/Documents/Bauhaus/10-Thesis/src/VulkanSharedTextures/build/shaders/fragment.spv");
-
-        VkShaderModule vertShaderModule = createShaderModule(device, vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(device, fragShaderCode);
+        VkShaderModule vertShaderModule = vulkan_utils::createShaderModule(device, vertex_spv, sizeof(vertex_spv));
+        VkShaderModule fragShaderModule = vulkan_utils::createShaderModule(device, fragment_spv, sizeof(fragment_spv));
 
         VkPipelineShaderStageCreateInfo vertStage{};
         vertStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -94,6 +61,13 @@ namespace vst
         viewportState.scissorCount = 1;
         viewportState.pScissors = &scissor;
 
+        // Set per draw, so a recreated swapchain with a new extent can keep this pipeline
+        VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = 2;
+        dynamicState.pDynamicStates = dynamicStates;
+
         VkPipelineRasterizationStateCreateInfo rasterizer{};
         rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
         rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
@@ -134,6 +108,7 @@ namespace vst
         pipelineInfo.pRasterizationState = &rasterizer;
         pipelineInfo.pMultisampleState = &multisampling;
         pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.pDynamicState = &dynamicState;
         pipelineInfo.layout = pipelineLayout;
         pipelineInfo.renderPass = renderPass;
         pipelineInfo.subpass = 0;
@@ -147,7 +122,7 @@ namespace vst
         //     LOG_ERR("Failed to set base pipeline: " + std::string(e.what()));
         // }
 
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+        if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to create graphics pipeline.");
         }
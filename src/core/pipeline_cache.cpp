@@ -0,0 +1,180 @@
+#include "core/pipeline_cache.hpp"
+#include "utils/logger.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <unistd.h>
+
+namespace vst
+{
+
+    namespace fs = std::filesystem;
+
+    // Leading fields of every pipeline cache blob, VkPipelineCacheHeaderVersionOne
+    static constexpr size_t kCacheHeaderSize = 16 + VK_UUID_SIZE;
+
+    PipelineCache::PipelineCache() {}
+
+    PipelineCache::~PipelineCache()
+    {
+        destroy();
+    }
+
+    std::string PipelineCache::cacheDirectory()
+    {
+        const char *xdgCache = std::getenv("XDG_CACHE_HOME");
+        if (xdgCache && xdgCache[0] == '/')
+        {
+            return std::string(xdgCache) + "/VulkanSharedTextures";
+        }
+        const char *home = std::getenv("HOME");
+        if (home && home[0] != '\0')
+        {
+            return std::string(home) + "/.cache/VulkanSharedTextures";
+        }
+        return "";
+    }
+
+    void PipelineCache::load(VkDevice dev, VkPhysicalDevice physicalDevice)
+    {
+        destroy();
+        device = dev;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        std::string directory = cacheDirectory();
+        if (!directory.empty())
+        {
+            char name[2 * VK_UUID_SIZE + 1];
+            for (uint32_t i = 0; i < VK_UUID_SIZE; ++i)
+            {
+                std::snprintf(name + 2 * i, 3, "%02x", properties.pipelineCacheUUID[i]);
+            }
+            path = directory + "/pipeline-" + name + "-" + std::to_string(properties.driverVersion) + ".bin";
+        }
+
+        std::vector<char> data;
+        if (!path.empty())
+        {
+            std::ifstream file(path, std::ios::ate | std::ios::binary);
+            if (file.is_open())
+            {
+                data.resize(static_cast<size_t>(file.tellg()));
+                file.seekg(0);
+                file.read(data.data(), data.size());
+                if (!file)
+                {
+                    data.clear();
+                }
+            }
+        }
+
+        // The driver checks the header too, but some drivers misbehave on foreign data
+        if (!data.empty())
+        {
+            uint32_t header[4];
+            bool valid = data.size() >= kCacheHeaderSize;
+            if (valid)
+            {
+                std::memcpy(header, data.data(), sizeof(header));
+                valid = header[0] >= kCacheHeaderSize &&
+                        header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                        header[2] == properties.vendorID &&
+                        header[3] == properties.deviceID &&
+                        std::memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+            }
+            if (!valid)
+            {
+                LOG_WARN("Ignoring pipeline cache from another device: " << path);
+                data.clear();
+            }
+        }
+
+        VkPipelineCacheCreateInfo createInfo{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+        createInfo.initialDataSize = data.size();
+        createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+        if (vkCreatePipelineCache(device, &createInfo, nullptr, &cache) != VK_SUCCESS && !data.empty())
+        {
+            LOG_WARN("Driver rejected the pipeline cache, starting empty");
+            data.clear();
+            createInfo.initialDataSize = 0;
+            createInfo.pInitialData = nullptr;
+            vkCreatePipelineCache(device, &createInfo, nullptr, &cache);
+        }
+        if (cache == VK_NULL_HANDLE)
+        {
+            LOG_WARN("Failed to create pipeline cache, pipelines are compiled uncached");
+            return;
+        }
+
+        loadedSize = data.size();
+        if (loadedSize > 0)
+        {
+            LOG_INFO("Pipeline cache loaded: " << loadedSize << " bytes from " << path);
+        }
+    }
+
+    void PipelineCache::save()
+    {
+        if (cache == VK_NULL_HANDLE || path.empty())
+        {
+            return;
+        }
+
+        size_t size = 0;
+        if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS || size == 0)
+        {
+            return;
+        }
+        // Same size means no new pipelines, and every process switching streams would rewrite it
+        if (size == loadedSize)
+        {
+            return;
+        }
+
+        std::vector<char> data(size);
+        if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS)
+        {
+            return;
+        }
+
+        // Write a private file and rename it over the old one, so concurrent consumers never see half a cache
+        std::error_code ec;
+        fs::create_directories(fs::path(path).parent_path(), ec);
+        std::string tempPath = path + "." + std::to_string(getpid()) + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(data.data(), static_cast<std::streamsize>(size));
+            if (!file)
+            {
+                LOG_WARN("Failed to write pipeline cache: " << tempPath);
+                fs::remove(tempPath, ec);
+                return;
+            }
+        }
+        fs::rename(tempPath, path, ec);
+        if (ec)
+        {
+            LOG_WARN("Failed to store pipeline cache: " << ec.message());
+            fs::remove(tempPath, ec);
+            return;
+        }
+
+        loadedSize = size;
+        LOG_INFO("Pipeline cache saved: " << size << " bytes to " << path);
+    }
+
+    void PipelineCache::destroy()
+    {
+        if (cache != VK_NULL_HANDLE)
+        {
+            vkDestroyPipelineCache(device, cache, nullptr);
+            cache = VK_NULL_HANDLE;
+        }
+        loadedSize = 0;
+    }
+
+} // namespace vst
@@ -1,6 +1,7 @@
 #include "core/swapchain.hpp"
 #include "utils/logger.hpp"
 #include <stdexcept>
+#include <algorithm>
 
 namespace vst
 {
@@ -12,35 +13,90 @@ namespace vst
         cleanup();
     }
 
-    void Swapchain::init(VkPhysicalDevice phys, VkDevice dev, GLFWwindow *win, VkSurfaceKHR surf)
+    void Swapchain::init(VkPhysicalDevice phys, VkDevice dev, GLFWwindow *win, VkSurfaceKHR surf, PresentProfile presentProfile)
     {
         physicalDevice = phys;
         device = dev;
         window = win;
         surface = surf;
+        profile = presentProfile;
 
         createSwapchain();
         createImageViews();
     }
 
-    void Swapchain::createSwapchain()
+    VkPresentModeKHR Swapchain::choosePresentMode() const
+    {
+        if (profile == PresentProfile::VSync)
+        {
+            return VK_PRESENT_MODE_FIFO_KHR;
+        }
+
+        uint32_t modeCount = 0;
+        vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &modeCount, nullptr);
+        std::vector<VkPresentModeKHR> modes(modeCount);
+        vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &modeCount, modes.data());
+
+        // MAILBOX replaces the queued image without tearing; IMMEDIATE tears but never waits
+        for (VkPresentModeKHR preferred : {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR})
+        {
+            if (std::find(modes.begin(), modes.end(), preferred) != modes.end())
+            {
+                return preferred;
+            }
+        }
+
+        LOG_WARN("Surface offers neither MAILBOX nor IMMEDIATE, presenting with FIFO");
+        return VK_PRESENT_MODE_FIFO_KHR; // Always supported
+    }
+
+    VkExtent2D Swapchain::chooseExtent(const VkSurfaceCapabilitiesKHR &capabilities) const
     {
+        // Most platforms dictate the extent; Wayland leaves it to the window size
+        if (capabilities.currentExtent.width != UINT32_MAX)
+        {
+            return capabilities.currentExtent;
+        }
+
         int width, height;
         glfwGetFramebufferSize(window, &width, &height);
+        VkExtent2D actual{static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+        actual.width = std::clamp(actual.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+        actual.height = std::clamp(actual.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+        return actual;
+    }
+
+    void Swapchain::createSwapchain()
+    {
+        VkSurfaceCapabilitiesKHR capabilities;
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &capabilities);
+
+        presentMode = choosePresentMode();
+
+        // FIFO and IMMEDIATE need no more than the minimum; MAILBOX needs a spare image to replace
+        uint32_t imageCount = std::max(capabilities.minImageCount, 2u);
+        if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+        {
+            imageCount = std::max(capabilities.minImageCount + 1, 3u);
+        }
+        if (capabilities.maxImageCount > 0)
+        {
+            imageCount = std::min(imageCount, capabilities.maxImageCount);
+        }
 
         VkSwapchainCreateInfoKHR createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
         createInfo.surface = surface;
-        createInfo.minImageCount = 2;
+        createInfo.minImageCount = imageCount;
         createInfo.imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
         createInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
-        createInfo.imageExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+        createInfo.imageExtent = chooseExtent(capabilities);
         createInfo.imageArrayLayers = 1;
         createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
         createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        createInfo.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+        createInfo.preTransform = capabilities.currentTransform;
         createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-        createInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        createInfo.presentMode = presentMode;
         createInfo.clipped = VK_TRUE;
         createInfo.oldSwapchain = VK_NULL_HANDLE;
 
@@ -57,7 +113,10 @@ namespace vst
         imageFormat = createInfo.imageFormat;
         extent = createInfo.imageExtent;
 
-        LOG_INFO("Swapchain created.");
+        static const char *const kModeNames[] = {"IMMEDIATE", "MAILBOX", "FIFO", "FIFO_RELAXED"};
+        LOG_INFO("Swapchain created: " << images.size() << " images, " << extent.width << "x" << extent.height << ", "
+                                       << (presentMode <= VK_PRESENT_MODE_FIFO_RELAXED_KHR ? kModeNames[presentMode] : "other")
+                                       << " present mode.");
     }
 
     void Swapchain::createImageViews()
@@ -92,10 +151,13 @@ namespace vst
         {
             vkDestroyImageView(device, view, nullptr);
         }
+        imageViews.clear();
+        images.clear();
 
         if (swapchain)
         {
             vkDestroySwapchainKHR(device, swapchain, nullptr);
+            swapchain = VK_NULL_HANDLE;
         }
 
         LOG_INFO("Swapchain cleaned up.");
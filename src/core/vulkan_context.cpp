@@ -2,6 +2,7 @@
 #include "utils/logger.hpp"
 #include <stdexcept>
 #include <set>
+#include <thread>
 
 namespace vst
 {
@@ -13,8 +14,10 @@ namespace vst
         cleanup();
     }
 
-    void VulkanContext::init(GLFWwindow *window)
+    void VulkanContext::init(GLFWwindow *window, PresentProfile presentProfile)
     {
+        this->window = window;
+        this->presentProfile = presentProfile;
         createInstance();
         createSurface(window);
         pickDeviceAndCreateLogical();
@@ -24,6 +27,40 @@ namespace vst
         createCommandPool();
         createCommandBuffers();
         createSyncObjects();
+
+        // Pacing assumes the primary monitor's refresh rate; 60 Hz if GLFW cannot tell
+        GLFWmonitor *monitor = glfwGetPrimaryMonitor();
+        const GLFWvidmode *mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+        if (mode && mode->refreshRate > 0)
+        {
+            refreshPeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1.0 / mode->refreshRate));
+        }
+        framePacing = swapchain.getPresentMode() != VK_PRESENT_MODE_FIFO_KHR;
+        if (framePacing)
+        {
+            LOG_INFO("Frame pacing enabled at " << (mode ? mode->refreshRate : 60) << " Hz.");
+        }
+    }
+
+    void VulkanContext::initHeadless(uint32_t width, uint32_t height)
+    {
+        if (width == 0 || height == 0)
+        {
+            throw std::runtime_error("Headless render target must not be empty.");
+        }
+
+        headless = true;
+        createInstance();
+        pickDeviceAndCreateLogical();
+        createOffscreenTargets(width, height);
+        setupRenderPass();
+        createFramebuffers();
+        createCommandPool();
+        createCommandBuffers();
+        createSyncObjects();
+
+        LOG_INFO("Headless context ready, rendering offscreen at " << width << "x" << height);
     }
 
     void VulkanContext::createInstance()
@@ -40,10 +77,14 @@ namespace vst
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
         createInfo.pApplicationInfo = &appInfo;
 
-        uint32_t glfwExtensionCount = 0;
-        const char **glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-        createInfo.enabledExtensionCount = glfwExtensionCount;
-        createInfo.ppEnabledExtensionNames = glfwExtensions;
+        // Surface extensions only; headless contexts need none and never initialise GLFW
+        if (!headless)
+        {
+            uint32_t glfwExtensionCount = 0;
+            const char **glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+            createInfo.enabledExtensionCount = glfwExtensionCount;
+            createInfo.ppEnabledExtensionNames = glfwExtensions;
+        }
 
         if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS)
         {
@@ -64,24 +105,92 @@ namespace vst
 
     void VulkanContext::pickDeviceAndCreateLogical()
     {
-        device.pickPhysicalDevice(instance);
+        device.pickPhysicalDevice(instance, !headless);
         device.createLogicalDevice();
+
+        if (!allocator.init(device.getDevice(), device.getPhysicalDevice()))
+        {
+            throw std::runtime_error("Failed to initialise device memory allocator.");
+        }
+
+        pipelineCache.load(device.getDevice(), device.getPhysicalDevice());
     }
 
     void VulkanContext::setupSwapchain(GLFWwindow *window)
     {
-        swapchain.init(device.getPhysicalDevice(), device.getDevice(), window, surface);
+        glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
+        swapchain.init(device.getPhysicalDevice(), device.getDevice(), window, surface, presentProfile);
+    }
+
+    void VulkanContext::createOffscreenTargets(uint32_t width, uint32_t height)
+    {
+        offscreenExtent = {width, height};
+
+        for (uint32_t i = 0; i < kMaxFramesInFlight; ++i)
+        {
+            VkImageCreateInfo imageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent = {width, height, 1};
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+            VkImage image;
+            if (vkCreateImage(device.getDevice(), &imageInfo, nullptr, &image) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create offscreen image.");
+            }
+            offscreenImages.push_back(image);
+            offscreenAllocations.emplace_back();
+
+            if (!allocator.allocateForImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                            memory::AllocationUsage::Persistent, offscreenAllocations.back()))
+            {
+                throw std::runtime_error("Failed to allocate offscreen image memory.");
+            }
+            offscreenImageViews.push_back(vulkan_utils::createImageView(device.getDevice(), image));
+        }
+
+        LOG_INFO("Offscreen render targets created.");
+    }
+
+    void VulkanContext::destroyOffscreenTargets()
+    {
+        for (VkImageView view : offscreenImageViews)
+        {
+            vkDestroyImageView(device.getDevice(), view, nullptr);
+        }
+        for (VkImage image : offscreenImages)
+        {
+            vkDestroyImage(device.getDevice(), image, nullptr);
+        }
+        for (memory::Allocation &allocation : offscreenAllocations)
+        {
+            if (allocation.isValid())
+            {
+                allocator.free(allocation);
+            }
+        }
+        offscreenImageViews.clear();
+        offscreenImages.clear();
+        offscreenAllocations.clear();
     }
 
     void VulkanContext::setupRenderPass()
     {
         VkAttachmentDescription colorAttachment{};
-        colorAttachment.format = swapchain.getImageFormat();
+        colorAttachment.format = headless ? VK_FORMAT_R8G8B8A8_UNORM : swapchain.getImageFormat();
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
         colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // PRESENT_SRC_KHR is only valid with VK_KHR_swapchain enabled
+        colorAttachment.finalLayout = headless ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference colorRef{};
         colorRef.attachment = 0;
@@ -109,7 +218,7 @@ namespace vst
 
     void VulkanContext::createFramebuffers()
     {
-        auto imageViews = swapchain.getImageViews();
+        const std::vector<VkImageView> &imageViews = headless ? offscreenImageViews : swapchain.getImageViews();
         framebuffers.resize(imageViews.size());
 
         for (size_t i = 0; i < imageViews.size(); ++i)
@@ -121,8 +230,8 @@ namespace vst
             fbInfo.renderPass = renderPass;
             fbInfo.attachmentCount = 1;
             fbInfo.pAttachments = attachments;
-            fbInfo.width = swapchain.getExtent().width;
-            fbInfo.height = swapchain.getExtent().height;
+            fbInfo.width = getSwapchainExtent().width;
+            fbInfo.height = getSwapchainExtent().height;
             fbInfo.layers = 1;
 
             if (vkCreateFramebuffer(device.getDevice(), &fbInfo, nullptr, &framebuffers[i]) != VK_SUCCESS)
@@ -134,24 +243,59 @@ namespace vst
         LOG_INFO("Framebuffers created.");
     }
 
-    void VulkanContext::drawFrame(VkPipeline pipeline, VkPipelineLayout layout, VkDescriptorSet descriptorSet, VkBuffer vertexBuffer)
+    void VulkanContext::destroyFramebuffers()
     {
-        if (!pipeline)
-            throw std::runtime_error("drawFrame: pipeline is null");
-        if (!layout)
-            throw std::runtime_error("drawFrame: pipeline layout is null");
-        if (!descriptorSet)
-            throw std::runtime_error("drawFrame: descriptorSet is null");
-        if (!vertexBuffer)
-            throw std::runtime_error("drawFrame: vertexBuffer is null");
+        for (VkFramebuffer framebuffer : framebuffers)
+        {
+            vkDestroyFramebuffer(device.getDevice(), framebuffer, nullptr);
+        }
+        framebuffers.clear();
+    }
+
+    void VulkanContext::recreateSwapchain()
+    {
+        if (headless)
+        {
+            return;
+        }
+
+        // A minimised window has a zero extent, which no swapchain can have
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        while (width == 0 || height == 0)
+        {
+            glfwWaitEvents();
+            glfwGetFramebufferSize(window, &width, &height);
+        }
+
+        windowWidth = width;
+        windowHeight = height;
+
+        vkDeviceWaitIdle(device.getDevice());
+
+        // Recorded draws reference the old framebuffers and extent
+        for (auto &draws : recordedDraws)
+        {
+            for (const RecordedDraw &draw : draws)
+            {
+                vkFreeCommandBuffers(device.getDevice(), commandPool, 1, &draw.commandBuffer);
+            }
+        }
+        destroyImageSyncObjects();
+        destroyFramebuffers();
+        swapchain.cleanup();
 
-        vkWaitForFences(device.getDevice(), 1, &inFlightFence, VK_TRUE, UINT64_MAX);
-        vkResetFences(device.getDevice(), 1, &inFlightFence);
+        swapchain.init(device.getPhysicalDevice(), device.getDevice(), window, surface, presentProfile);
+        createFramebuffers();
+        createCommandBuffers();
+        createImageSyncObjects();
 
-        uint32_t imageIndex;
-        vkAcquireNextImageKHR(device.getDevice(), swapchain.getSwapchain(), UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+        LOG_INFO("Swapchain recreated at " << swapchain.getExtent().width << "x" << swapchain.getExtent().height);
+    }
 
-        VkCommandBuffer cmd = commandBuffers[imageIndex];
+    void VulkanContext::recordDraw(uint32_t imageIndex, const RecordedDraw &draw)
+    {
+        VkCommandBuffer cmd = draw.commandBuffer;
 
         VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
         vkBeginCommandBuffer(cmd, &beginInfo);
@@ -162,37 +306,203 @@ namespace vst
         renderPassInfo.renderPass = renderPass;
         renderPassInfo.framebuffer = framebuffers[imageIndex];
         renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = swapchain.getExtent();
+        renderPassInfo.renderArea.extent = getSwapchainExtent();
         renderPassInfo.clearValueCount = 1;
         renderPassInfo.pClearValues = &clearColor;
 
         vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
+        // Viewport and scissor are dynamic so pipelines survive swapchain recreation
+        VkExtent2D extent = getSwapchainExtent();
+        VkViewport viewport{0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f};
+        VkRect2D scissor{{0, 0}, extent};
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+
         // Bind and draw!
-        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &descriptorSet, 0, nullptr);
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.layout, 0, 1, &draw.descriptorSet, 0, nullptr);
         VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(cmd, 0, 1, &vertexBuffer, offsets);
+        vkCmdBindVertexBuffers(cmd, 0, 1, &draw.vertexBuffer, offsets);
         vkCmdDraw(cmd, 6, 1, 0, 0); // fullscreen quad (to be added soon)
 
         vkCmdEndRenderPass(cmd);
-        vkEndCommandBuffer(cmd);
+        if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to record draw command buffer.");
+        }
+    }
+
+    VkCommandBuffer VulkanContext::getDrawCommandBuffer(uint32_t imageIndex, const RecordedDraw &inputs)
+    {
+        std::vector<RecordedDraw> &draws = recordedDraws[imageIndex];
+        for (const RecordedDraw &draw : draws)
+        {
+            if (draw.matches(inputs))
+            {
+                return draw.commandBuffer;
+            }
+        }
+
+        // New inputs: record into a fresh command buffer, or replace the oldest once the image has enough.
+        // The caller has waited for this image's last frame, so none of its command buffers is pending.
+        RecordedDraw *draw;
+        if (draws.size() < kDrawsPerImage)
+        {
+            VkCommandBufferAllocateInfo allocInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+            allocInfo.commandPool = commandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer cmd;
+            if (vkAllocateCommandBuffers(device.getDevice(), &allocInfo, &cmd) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to allocate draw command buffer.");
+            }
+            draws.push_back(inputs);
+            draw = &draws.back();
+            draw->commandBuffer = cmd;
+        }
+        else
+        {
+            uint32_t &evict = nextEvictedDraw[imageIndex];
+            draw = &draws[evict];
+            evict = (evict + 1) % kDrawsPerImage;
+
+            VkCommandBuffer cmd = draw->commandBuffer;
+            *draw = inputs;
+            draw->commandBuffer = cmd;
+        }
 
-        VkSemaphore waitSemaphores[] = {imageAvailableSemaphore};
-        VkSemaphore signalSemaphores[] = {renderFinishedSemaphore};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+        recordDraw(imageIndex, *draw);
+        return draw->commandBuffer;
+    }
+
+    void VulkanContext::paceFrame()
+    {
+        if (!framePacing)
+        {
+            return;
+        }
+
+        // drawFrame() would wait for this anyway; doing it first keeps it from delaying the frame after the input is chosen
+        vkWaitForFences(device.getDevice(), 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+
+        auto now = std::chrono::steady_clock::now();
+        auto wake = nextFrameDue - kPacingSlack;
+        if (wake > now)
+        {
+            std::this_thread::sleep_until(wake);
+            now = std::chrono::steady_clock::now();
+        }
+
+        // After a stall restart from now rather than rushing through the missed frames
+        nextFrameDue = now > nextFrameDue ? now + refreshPeriod : nextFrameDue + refreshPeriod;
+    }
+
+    void VulkanContext::drawFrame(VkPipeline pipeline, VkPipelineLayout layout, VkDescriptorSet descriptorSet, VkBuffer vertexBuffer,
+                                  VkSemaphore waitSemaphore, uint64_t waitValue)
+    {
+        if (!pipeline)
+            throw std::runtime_error("drawFrame: pipeline is null");
+        if (!layout)
+            throw std::runtime_error("drawFrame: pipeline layout is null");
+        if (!descriptorSet)
+            throw std::runtime_error("drawFrame: descriptorSet is null");
+        if (!vertexBuffer)
+            throw std::runtime_error("drawFrame: vertexBuffer is null");
+
+        // Wayland never reports a resize as out of date, so watch the window size too
+        if (!headless)
+        {
+            int width = 0, height = 0;
+            glfwGetFramebufferSize(window, &width, &height);
+            if (width != windowWidth || height != windowHeight)
+            {
+                recreateSwapchain();
+            }
+        }
+
+        // Only blocks once kMaxFramesInFlight frames are queued
+        VkFence frameFence = inFlightFences[currentFrame];
+        VkSemaphore imageAvailable = imageAvailableSemaphores[currentFrame];
+        vkWaitForFences(device.getDevice(), 1, &frameFence, VK_TRUE, UINT64_MAX);
+
+        // Headless frames own their offscreen image, so the frame fence already covers it
+        uint32_t imageIndex = currentFrame;
+        if (!headless)
+        {
+            VkResult result = vkAcquireNextImageKHR(device.getDevice(), swapchain.getSwapchain(), UINT64_MAX,
+                                                    imageAvailable, VK_NULL_HANDLE, &imageIndex);
+            if (result == VK_ERROR_OUT_OF_DATE_KHR)
+            {
+                // Nothing was submitted, so the fence and semaphore stay usable for the next frame
+                recreateSwapchain();
+                return;
+            }
+            if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+            {
+                throw std::runtime_error("Failed to acquire swapchain image.");
+            }
+
+            // Images can come back out of order; wait for whichever frame last rendered to this one
+            if (imagesInFlight[imageIndex] != VK_NULL_HANDLE && imagesInFlight[imageIndex] != frameFence)
+            {
+                vkWaitForFences(device.getDevice(), 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+            }
+            imagesInFlight[imageIndex] = frameFence;
+        }
+
+        RecordedDraw inputs;
+        inputs.pipeline = pipeline;
+        inputs.layout = layout;
+        inputs.descriptorSet = descriptorSet;
+        inputs.vertexBuffer = vertexBuffer;
+        VkCommandBuffer cmd = getDrawCommandBuffer(imageIndex, inputs);
+
+        // The shared texture is only sampled in the fragment shader, so only that stage waits for the upload
+        VkSemaphore waitSemaphores[] = {imageAvailable, waitSemaphore};
+        VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[imageIndex]};
+        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT};
+        uint64_t waitValues[] = {0, waitValue};
+        uint64_t signalValues[] = {0};
+
+        // Nothing is acquired or presented headless, so only the upload is waited on and nothing signalled
+        uint32_t firstWait = headless ? 1 : 0;
 
         VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
+        submitInfo.waitSemaphoreCount = (waitSemaphore != VK_NULL_HANDLE ? 2 : 1) - firstWait;
+        submitInfo.pWaitSemaphores = waitSemaphores + firstWait;
+        submitInfo.pWaitDstStageMask = waitStages + firstWait;
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &cmd;
-        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.signalSemaphoreCount = headless ? 0 : 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
+        VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+        if (waitValue != 0)
+        {
+            timelineInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+            timelineInfo.pWaitSemaphoreValues = waitValues + firstWait;
+            timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+            timelineInfo.pSignalSemaphoreValues = signalValues;
+            submitInfo.pNext = &timelineInfo;
+        }
+
+        // Reset only once a submission is certain, or an early return would leave the fence unsignalled
+        vkResetFences(device.getDevice(), 1, &frameFence);
+
         auto queue = device.getGraphicsQueue();
-        vkQueueSubmit(queue, 1, &submitInfo, inFlightFence);
+        if (vkQueueSubmit(queue, 1, &submitInfo, frameFence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit draw command buffer.");
+        }
+
+        if (headless)
+        {
+            currentFrame = (currentFrame + 1) % kMaxFramesInFlight;
+            return;
+        }
 
         VkPresentInfoKHR presentInfo{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
         presentInfo.waitSemaphoreCount = 1;
@@ -202,7 +512,17 @@ namespace vst
         presentInfo.pSwapchains = &swapchainHandle;
         presentInfo.pImageIndices = &imageIndex;
 
-        vkQueuePresentKHR(queue, &presentInfo);
+        VkResult result = vkQueuePresentKHR(queue, &presentInfo);
+        currentFrame = (currentFrame + 1) % kMaxFramesInFlight;
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+        {
+            recreateSwapchain();
+        }
+        else if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to present swapchain image.");
+        }
     }
 
     void VulkanContext::createCommandPool()
@@ -211,6 +531,7 @@ namespace vst
 
         VkCommandPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // Recorded draws are re-recorded one at a time
         poolInfo.queueFamilyIndex = queueFamilyIndex;
 
         if (vkCreateCommandPool(device.getDevice(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
@@ -218,25 +539,25 @@ namespace vst
             throw std::runtime_error("Failed to create command pool.");
         }
 
+        if (device.getQueueFamilies().hasDedicatedTransfer())
+        {
+            poolInfo.queueFamilyIndex = device.getQueueFamilies().transferFamily;
+            if (vkCreateCommandPool(device.getDevice(), &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create transfer command pool.");
+            }
+        }
+
         LOG_INFO("Command pool created.");
     }
 
     void VulkanContext::createCommandBuffers()
     {
-        commandBuffers.resize(framebuffers.size());
-
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
-
-        if (vkAllocateCommandBuffers(device.getDevice(), &allocInfo, commandBuffers.data()) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to allocate command buffers.");
-        }
+        // Draw command buffers are allocated and recorded on first use, see getDrawCommandBuffer()
+        recordedDraws.assign(framebuffers.size(), {});
+        nextEvictedDraw.assign(framebuffers.size(), 0);
 
-        LOG_INFO("Command buffers allocated.");
+        LOG_INFO("Draw command buffer slots prepared for " << framebuffers.size() << " swapchain images.");
     }
 
     void VulkanContext::createSyncObjects()
@@ -245,30 +566,109 @@ namespace vst
         VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
         fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        if (vkCreateSemaphore(device.getDevice(), &semInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-            vkCreateSemaphore(device.getDevice(), &semInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS ||
-            vkCreateFence(device.getDevice(), &fenceInfo, nullptr, &inFlightFence) != VK_SUCCESS)
+        imageAvailableSemaphores.resize(kMaxFramesInFlight, VK_NULL_HANDLE);
+        inFlightFences.resize(kMaxFramesInFlight, VK_NULL_HANDLE);
+        for (uint32_t i = 0; i < kMaxFramesInFlight; ++i)
+        {
+            if (vkCreateSemaphore(device.getDevice(), &semInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+                vkCreateFence(device.getDevice(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create sync objects.");
+            }
+        }
+        currentFrame = 0;
+
+        createImageSyncObjects();
+
+        LOG_INFO("Sync objects created for " << kMaxFramesInFlight << " frames in flight.");
+    }
+
+    void VulkanContext::createImageSyncObjects()
+    {
+        // Presentation holds renderFinished until the image is shown, so each image needs its own
+        VkSemaphoreCreateInfo semInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        renderFinishedSemaphores.resize(framebuffers.size(), VK_NULL_HANDLE);
+        for (VkSemaphore &semaphore : renderFinishedSemaphores)
         {
-            throw std::runtime_error("Failed to create sync objects.");
+            if (vkCreateSemaphore(device.getDevice(), &semInfo, nullptr, &semaphore) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create sync objects.");
+            }
         }
+        imagesInFlight.assign(framebuffers.size(), VK_NULL_HANDLE);
+    }
 
-        LOG_INFO("Sync objects created.");
+    void VulkanContext::destroyImageSyncObjects()
+    {
+        for (VkSemaphore semaphore : renderFinishedSemaphores)
+        {
+            vkDestroySemaphore(device.getDevice(), semaphore, nullptr);
+        }
+        renderFinishedSemaphores.clear();
+        imagesInFlight.clear();
     }
 
     void VulkanContext::cleanup()
     {
+        // Already cleaned up, or never initialised; the destructor calls this again
+        if (instance == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        if (!inFlightFences.empty())
+        {
+            // Queued frames still use the sync objects and framebuffers
+            vkDeviceWaitIdle(device.getDevice());
+
+            for (uint32_t i = 0; i < inFlightFences.size(); ++i)
+            {
+                vkDestroySemaphore(device.getDevice(), imageAvailableSemaphores[i], nullptr);
+                vkDestroyFence(device.getDevice(), inFlightFences[i], nullptr);
+            }
+            imageAvailableSemaphores.clear();
+            inFlightFences.clear();
+            destroyImageSyncObjects();
+            recordedDraws.clear();
+            destroyFramebuffers();
+        }
+
+        destroyOffscreenTargets();
         swapchain.cleanup();
 
+        pipelineCache.save();
+        pipelineCache.destroy();
+
+        // Everything sub-allocated must have been released by now
+        if (allocator.getDevice() != VK_NULL_HANDLE)
+        {
+            allocator.logStats();
+            allocator.destroy();
+        }
+
         if (surface != VK_NULL_HANDLE)
         {
             vkDestroySurfaceKHR(instance, surface, nullptr);
         }
 
+        // Destroying the pools frees every command buffer still allocated from them
+        if (transferCommandPool != VK_NULL_HANDLE)
+        {
+            vkDestroyCommandPool(device.getDevice(), transferCommandPool, nullptr);
+            transferCommandPool = VK_NULL_HANDLE;
+        }
+        if (commandPool != VK_NULL_HANDLE)
+        {
+            vkDestroyCommandPool(device.getDevice(), commandPool, nullptr);
+            commandPool = VK_NULL_HANDLE;
+        }
+
         device.~VulkanDevice(); // OR move this into the VulkanDevice destructor
 
         if (instance != VK_NULL_HANDLE)
         {
             vkDestroyInstance(instance, nullptr);
+            instance = VK_NULL_HANDLE;
         }
 
         LOG_INFO("Vulkan context cleaned up.");
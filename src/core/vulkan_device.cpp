@@ -1,14 +1,22 @@
 #include "core/vulkan_device.hpp"
 #include "utils/logger.hpp"
+#include <cstring>
 #include <stdexcept>
 #include <vector>
 namespace vst
 {
     const std::vector<const char *> requiredDeviceExtensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
         VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME,
         VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME};
 
+    // Cross-process semaphores; without them uploads are ordered by host waits
+    const std::vector<const char *> optionalDeviceExtensions = {
+        VK_KHR_EXTERNAL_SEMAPHORE_EXTENSION_NAME,
+        VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME};
+
+    // Imports mapped shared memory as buffers; without it SHM frames go through a staging copy
+    const char *const externalMemoryHostExtension = VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME;
+
     VulkanDevice::VulkanDevice() {}
 
     VulkanDevice::~VulkanDevice()
@@ -19,9 +27,10 @@ namespace vst
         }
     }
 
-    void VulkanDevice::pickPhysicalDevice(VkInstance inst)
+    void VulkanDevice::pickPhysicalDevice(VkInstance inst, bool presentation)
     {
         instance = inst;
+        this->presentation = presentation;
         uint32_t deviceCount = 0;
         vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
 
@@ -53,37 +62,135 @@ namespace vst
         std::vector<VkQueueFamilyProperties> props(queueCount);
         vkGetPhysicalDeviceQueueFamilyProperties(device, &queueCount, props.data());
 
+        queueFamilies = QueueFamilyIndices{};
         for (uint32_t i = 0; i < props.size(); i++)
         {
             if (props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
             {
                 queueFamilies.graphicsFamily = i;
-                return true;
+                break;
             }
         }
+        if (!queueFamilies.isComplete())
+            return false;
+
+        // Software drivers such as lavapipe are listed too, so skip anything that cannot share memory
+        for (const char *name : requiredExtensions())
+        {
+            if (!isExtensionSupported(device, name))
+                return false;
+        }
 
+        // Transfer-only families are usually backed by copy engines that run beside rendering;
+        // a compute family without graphics is the async compute queue
+        queueFamilies.transferFamily = queueFamilies.graphicsFamily;
+        queueFamilies.computeFamily = queueFamilies.graphicsFamily;
+        for (uint32_t i = 0; i < props.size(); i++)
+        {
+            VkQueueFlags flags = props[i].queueFlags;
+            if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+                !queueFamilies.hasDedicatedTransfer())
+            {
+                queueFamilies.transferFamily = i;
+            }
+            if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) &&
+                !queueFamilies.hasDedicatedCompute())
+            {
+                queueFamilies.computeFamily = i;
+            }
+        }
+
+        return true;
+    }
+
+    bool VulkanDevice::isExtensionSupported(const char *name) const
+    {
+        return isExtensionSupported(physicalDevice, name);
+    }
+
+    bool VulkanDevice::isExtensionSupported(VkPhysicalDevice device, const char *name)
+    {
+        uint32_t count = 0;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr);
+        std::vector<VkExtensionProperties> extensions(count);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &count, extensions.data());
+
+        for (const auto &ext : extensions)
+        {
+            if (std::strcmp(ext.extensionName, name) == 0)
+                return true;
+        }
         return false;
     }
 
+    std::vector<const char *> VulkanDevice::requiredExtensions() const
+    {
+        std::vector<const char *> extensions = requiredDeviceExtensions;
+        if (presentation)
+            extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        return extensions;
+    }
+
     void VulkanDevice::createLogicalDevice()
     {
         if (!queueFamilies.isComplete())
             throw std::runtime_error("Queue families not selected.");
 
+        // One queue per distinct family
         float priority = 1.0f;
-        VkDeviceQueueCreateInfo queueCreate{};
-        queueCreate.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreate.queueFamilyIndex = queueFamilies.graphicsFamily;
-        queueCreate.queueCount = 1;
-        queueCreate.pQueuePriorities = &priority;
+        std::vector<VkDeviceQueueCreateInfo> queueCreates;
+        for (uint32_t family : {queueFamilies.graphicsFamily, queueFamilies.transferFamily, queueFamilies.computeFamily})
+        {
+            bool seen = false;
+            for (const auto &existing : queueCreates)
+                seen = seen || existing.queueFamilyIndex == family;
+            if (seen)
+                continue;
+
+            VkDeviceQueueCreateInfo queueCreate{};
+            queueCreate.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queueCreate.queueFamilyIndex = family;
+            queueCreate.queueCount = 1;
+            queueCreate.pQueuePriorities = &priority;
+            queueCreates.push_back(queueCreate);
+        }
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        createInfo.queueCreateInfoCount = 1;
-        createInfo.pQueueCreateInfos = &queueCreate;
+        createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreates.size());
+        createInfo.pQueueCreateInfos = queueCreates.data();
+
+        std::vector<const char *> extensions = requiredExtensions();
+        externalSemaphoreFd = true;
+        for (const char *name : optionalDeviceExtensions)
+        {
+            if (isExtensionSupported(name))
+                extensions.push_back(name);
+            else
+                externalSemaphoreFd = false;
+        }
+        externalMemoryHost = isExtensionSupported(externalMemoryHostExtension);
+        if (externalMemoryHost)
+            extensions.push_back(externalMemoryHostExtension);
 
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = requiredDeviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
+
+        // Timeline semaphores are core since Vulkan 1.2 but still have to be switched on
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES};
+        if (props.apiVersion >= VK_API_VERSION_1_2)
+        {
+            VkPhysicalDeviceFeatures2 features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+            features.pNext = &timelineFeatures;
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+            timelineFeatures.pNext = nullptr;
+        }
+        timelineSemaphores = timelineFeatures.timelineSemaphore == VK_TRUE;
+        if (timelineSemaphores)
+            createInfo.pNext = &timelineFeatures;
 
         if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS)
         {
@@ -91,6 +198,11 @@ namespace vst
         }
 
         vkGetDeviceQueue(device, queueFamilies.graphicsFamily, 0, &graphicsQueue);
+        vkGetDeviceQueue(device, queueFamilies.transferFamily, 0, &transferQueue);
+        vkGetDeviceQueue(device, queueFamilies.computeFamily, 0, &computeQueue);
+        LOG_INFO("Queue families: graphics " << queueFamilies.graphicsFamily
+                                             << ", transfer " << queueFamilies.transferFamily
+                                             << ", compute " << queueFamilies.computeFamily);
         LOG_INFO("Logical device successfully created.");
     }
 
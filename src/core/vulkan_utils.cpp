@@ -22,8 +22,7 @@ namespace vst::vulkan_utils
         throw std::runtime_error("Failed to find suitable memory type.");
     }
 
-    // static void createImage(VkDevice device, VkPhysicalDevice physicalDevice, int width, int height, VkImage &image, VkDeviceMemory &memory, bool exportMemory)
-    void createImage(VkDevice device, VkPhysicalDevice physicalDevice, int width, int height, VkImage &image, VkDeviceMemory &memory, bool exportMemory)
+    static void createImageHandle(VkDevice device, int width, int height, VkImage &image, bool exportMemory)
     {
         VkImageCreateInfo imageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
         imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -46,6 +45,12 @@ namespace vst::vulkan_utils
 
         if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
             throw std::runtime_error("Failed to create image.");
+    }
+
+    // static void createImage(VkDevice device, VkPhysicalDevice physicalDevice, int width, int height, VkImage &image, VkDeviceMemory &memory, bool exportMemory)
+    void createImage(VkDevice device, VkPhysicalDevice physicalDevice, int width, int height, VkImage &image, VkDeviceMemory &memory, bool exportMemory)
+    {
+        createImageHandle(device, width, height, image, exportMemory);
 
         VkMemoryRequirements memReqs;
         vkGetImageMemoryRequirements(device, image, &memReqs);
@@ -68,6 +73,21 @@ namespace vst::vulkan_utils
         vkBindImageMemory(device, image, memory, 0);
     }
 
+    void createImage(memory::DeviceAllocator &allocator, int width, int height,
+                     VkImage &image, memory::Allocation &allocation, bool exportMemory)
+    {
+        createImageHandle(allocator.getDevice(), width, height, image, exportMemory);
+
+        memory::AllocationUsage usage = exportMemory ? memory::AllocationUsage::Exportable
+                                                     : memory::AllocationUsage::Persistent;
+        if (!allocator.allocateForImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, usage, allocation))
+        {
+            vkDestroyImage(allocator.getDevice(), image, nullptr);
+            image = VK_NULL_HANDLE;
+            throw std::runtime_error("Failed to allocate image memory.");
+        }
+    }
+
     VkImageView createImageView(VkDevice device, VkImage image)
     {
         VkImageViewCreateInfo viewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
@@ -112,6 +132,38 @@ namespace vst::vulkan_utils
         vkBindBufferMemory(device, buffer, bufferMemory, 0);
     }
 
+    void createBuffer(memory::DeviceAllocator &allocator, VkDeviceSize size,
+                      VkBuffer &buffer, memory::Allocation &allocation,
+                      VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                      memory::AllocationUsage allocationUsage)
+    {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(allocator.getDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create buffer");
+
+        if (!allocator.allocateForBuffer(buffer, properties, allocationUsage, allocation))
+        {
+            vkDestroyBuffer(allocator.getDevice(), buffer, nullptr);
+            buffer = VK_NULL_HANDLE;
+            throw std::runtime_error("Failed to allocate buffer memory");
+        }
+    }
+
+    void destroyBuffer(memory::DeviceAllocator &allocator, VkBuffer &buffer, memory::Allocation &allocation)
+    {
+        if (buffer != VK_NULL_HANDLE)
+        {
+            vkDestroyBuffer(allocator.getDevice(), buffer, nullptr);
+            buffer = VK_NULL_HANDLE;
+        }
+        allocator.free(allocation);
+    }
+
     void transitionImageLayout(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue,
                                VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout)
     {
@@ -211,6 +263,22 @@ namespace vst::vulkan_utils
         return sampler;
     }
 
+    VkShaderModule createShaderModule(VkDevice device, const uint32_t *code, size_t codeSize)
+    {
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = codeSize;
+        createInfo.pCode = code;
+
+        VkShaderModule shaderModule;
+        if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create shader module.");
+        }
+
+        return shaderModule;
+    }
+
     void copyBufferToImage(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue,
                            VkBuffer buffer, VkImage image, int width, int height)
     {
@@ -261,4 +329,125 @@ namespace vst::vulkan_utils
         vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
     }
 
+    void recordOwnershipBarrier(VkCommandBuffer cmd, VkImage image, uint32_t srcFamily, uint32_t dstFamily,
+                                VkImageLayout oldLayout, VkImageLayout newLayout,
+                                VkPipelineStageFlags stage, VkAccessFlags access, bool release)
+    {
+        VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = srcFamily;
+        barrier.dstQueueFamilyIndex = dstFamily;
+        barrier.image = image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+        // Each half only carries its own side's stage and access; the other side is ignored
+        VkPipelineStageFlags srcStage = release ? stage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        VkPipelineStageFlags dstStage = release ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : stage;
+        barrier.srcAccessMask = release ? access : 0;
+        barrier.dstAccessMask = release ? 0 : access;
+
+        vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    void uploadBufferToImage(VkDevice device, const SubmitQueue &graphics, const SubmitQueue &transfer,
+                             VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+    {
+        bool handOver = transfer.family != graphics.family;
+
+        VkCommandBufferAllocateInfo allocInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        VkCommandBuffer copyCmd;
+        allocInfo.commandPool = transfer.commandPool;
+        vkAllocateCommandBuffers(device, &allocInfo, &copyCmd);
+        vkBeginCommandBuffer(copyCmd, &beginInfo);
+
+        // Old contents are discarded, so the transfer queue may take the image without an acquire
+        VkImageMemoryBarrier toTransfer{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        toTransfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toTransfer.image = image;
+        toTransfer.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageExtent = {width, height, 1};
+        vkCmdCopyBufferToImage(copyCmd, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        if (handOver)
+        {
+            recordOwnershipBarrier(copyCmd, image, transfer.family, graphics.family,
+                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, true);
+        }
+        else
+        {
+            VkImageMemoryBarrier toShader = toTransfer;
+            toShader.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            toShader.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            toShader.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            toShader.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &toShader);
+        }
+        vkEndCommandBuffer(copyCmd);
+
+        if (!handOver)
+        {
+            VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &copyCmd;
+            vkQueueSubmit(transfer.queue, 1, &submitInfo, VK_NULL_HANDLE);
+            vkQueueWaitIdle(transfer.queue);
+            vkFreeCommandBuffers(device, transfer.commandPool, 1, &copyCmd);
+            return;
+        }
+
+        VkCommandBuffer acquireCmd;
+        allocInfo.commandPool = graphics.commandPool;
+        vkAllocateCommandBuffers(device, &allocInfo, &acquireCmd);
+        vkBeginCommandBuffer(acquireCmd, &beginInfo);
+        recordOwnershipBarrier(acquireCmd, image, transfer.family, graphics.family,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false);
+        vkEndCommandBuffer(acquireCmd);
+
+        VkSemaphoreCreateInfo semInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        VkSemaphore copied;
+        if (vkCreateSemaphore(device, &semInfo, nullptr, &copied) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create upload semaphore.");
+
+        VkSubmitInfo copySubmit{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        copySubmit.commandBufferCount = 1;
+        copySubmit.pCommandBuffers = &copyCmd;
+        copySubmit.signalSemaphoreCount = 1;
+        copySubmit.pSignalSemaphores = &copied;
+        vkQueueSubmit(transfer.queue, 1, &copySubmit, VK_NULL_HANDLE);
+
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo acquireSubmit{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        acquireSubmit.waitSemaphoreCount = 1;
+        acquireSubmit.pWaitSemaphores = &copied;
+        acquireSubmit.pWaitDstStageMask = &waitStage;
+        acquireSubmit.commandBufferCount = 1;
+        acquireSubmit.pCommandBuffers = &acquireCmd;
+        vkQueueSubmit(graphics.queue, 1, &acquireSubmit, VK_NULL_HANDLE);
+
+        // The acquire waited on the copy, so the graphics queue idling covers both
+        vkQueueWaitIdle(graphics.queue);
+        vkDestroySemaphore(device, copied, nullptr);
+        vkFreeCommandBuffers(device, transfer.commandPool, 1, &copyCmd);
+        vkFreeCommandBuffers(device, graphics.commandPool, 1, &acquireCmd);
+    }
+
 } // namespace vst::vulkan_utils
@@ -0,0 +1,232 @@
+#include "ipc/control_protocol.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace vst::ipc
+{
+
+    static bool fill_socket_address(const std::string &path, sockaddr_un &addr)
+    {
+        if (path.size() >= sizeof(addr.sun_path))
+        {
+            std::cerr << "[ERROR] Socket path too long: " << path << std::endl;
+            return false;
+        }
+
+        addr = sockaddr_un{};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        return true;
+    }
+
+    int setup_control_server_socket(const std::string &path, int backlog)
+    {
+        sockaddr_un addr;
+        if (!fill_socket_address(path, addr))
+            return -1;
+
+        unlink(path.c_str());
+
+        // SEQPACKET keeps message boundaries, so a record is always one whole message
+        int server_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (server_fd < 0)
+        {
+            perror("socket");
+            return -1;
+        }
+
+        if (bind(server_fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+            perror("bind");
+            close(server_fd);
+            return -1;
+        }
+
+        if (listen(server_fd, backlog) < 0)
+        {
+            perror("listen");
+            close(server_fd);
+            return -1;
+        }
+
+        return server_fd;
+    }
+
+    int connect_control_socket(const std::string &path)
+    {
+        sockaddr_un addr;
+        if (!fill_socket_address(path, addr))
+            return -1;
+
+        int client_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (client_fd < 0)
+        {
+            perror("socket");
+            return -1;
+        }
+
+        if (connect(client_fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+            perror("connect");
+            close(client_fd);
+            return -1;
+        }
+
+        return client_fd;
+    }
+
+    int send_control_message(int socket_fd, ControlMessageType type, const void *payload, uint32_t payloadSize,
+                             const int *fds_to_send, uint32_t fdCount)
+    {
+        if (payloadSize > kMaxControlPayload || (payloadSize > 0 && !payload) ||
+            fdCount > kMaxRingImages || (fdCount > 0 && !fds_to_send))
+            return -1;
+
+        ControlMessageHeader header{};
+        header.magic = kControlMagic;
+        header.version = kControlProtocolVersion;
+        header.type = static_cast<uint16_t>(type);
+        header.payloadSize = payloadSize;
+
+        struct iovec iov[2];
+        iov[0].iov_base = &header;
+        iov[0].iov_len = sizeof(header);
+        iov[1].iov_base = const_cast<void *>(payload);
+        iov[1].iov_len = payloadSize;
+
+        char cmsg_buf[CMSG_SPACE(sizeof(int) * kMaxRingImages)] = {};
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = payloadSize > 0 ? 2 : 1;
+
+        if (fdCount > 0)
+        {
+            msg.msg_control = cmsg_buf;
+            msg.msg_controllen = CMSG_SPACE(sizeof(int) * fdCount);
+
+            cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fdCount);
+            memcpy(CMSG_DATA(cmsg), fds_to_send, sizeof(int) * fdCount);
+        }
+
+        // MSG_NOSIGNAL: a consumer that went away must not kill the producer with SIGPIPE
+        ssize_t sent = sendmsg(socket_fd, &msg, MSG_NOSIGNAL);
+        return (sent == static_cast<ssize_t>(sizeof(header) + payloadSize)) ? 0 : -1;
+    }
+
+    int receive_control_message(int socket_fd, ControlMessageType &type, void *payload, uint32_t payloadCapacity,
+                                std::vector<int> *received_fds)
+    {
+        if (received_fds)
+            received_fds->clear();
+
+        ControlMessageHeader header{};
+        char buffer[kMaxControlPayload];
+
+        struct iovec iov[2];
+        iov[0].iov_base = &header;
+        iov[0].iov_len = sizeof(header);
+        iov[1].iov_base = buffer;
+        iov[1].iov_len = sizeof(buffer);
+
+        char cmsg_buf[CMSG_SPACE(sizeof(int) * kMaxRingImages)] = {};
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        msg.msg_control = cmsg_buf;
+        msg.msg_controllen = sizeof(cmsg_buf);
+
+        ssize_t received = recvmsg(socket_fd, &msg, MSG_CMSG_CLOEXEC);
+        if (received == 0)
+        {
+            errno = ECONNRESET;
+            return -1;
+        }
+        if (received < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("recvmsg");
+            return -1;
+        }
+
+        // Take ownership of any passed fds first so no error path leaks them
+        std::vector<int> fds;
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            {
+                size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    int fd;
+                    memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                    fds.push_back(fd);
+                }
+            }
+        }
+
+        bool valid = !(msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) &&
+                     received >= static_cast<ssize_t>(sizeof(header)) &&
+                     header.magic == kControlMagic &&
+                     header.version == kControlProtocolVersion &&
+                     received == static_cast<ssize_t>(sizeof(header) + header.payloadSize);
+        if (!valid)
+        {
+            std::cerr << "[ERROR] Malformed control message (" << received << " bytes)" << std::endl;
+            for (int fd : fds)
+                close(fd);
+            errno = EPROTO;
+            return -1;
+        }
+
+        type = static_cast<ControlMessageType>(header.type);
+        if (payloadCapacity > 0)
+        {
+            uint32_t copied = header.payloadSize < payloadCapacity ? header.payloadSize : payloadCapacity;
+            memcpy(payload, buffer, copied);
+            memset(static_cast<char *>(payload) + copied, 0, payloadCapacity - copied);
+        }
+
+        if (received_fds)
+        {
+            received_fds->swap(fds);
+        }
+        else
+        {
+            for (int fd : fds)
+                close(fd);
+        }
+
+        return 0;
+    }
+
+    int send_image_description(int socket_fd, const ImageDescription &desc, const int *image_fds)
+    {
+        return send_control_message(socket_fd, ControlMessageType::ImageDesc, &desc, sizeof(desc),
+                                    image_fds, desc.imageCount);
+    }
+
+    int send_sync_description(int socket_fd, const SyncDescription &desc, int semaphore_fd)
+    {
+        return send_control_message(socket_fd, ControlMessageType::SyncDesc, &desc, sizeof(desc),
+                                    semaphore_fd >= 0 ? &semaphore_fd : nullptr, semaphore_fd >= 0 ? 1 : 0);
+    }
+
+    int send_frame_ready(int socket_fd, const FrameReady &frame, int sync_fd)
+    {
+        return send_control_message(socket_fd, ControlMessageType::FrameReady, &frame, sizeof(frame),
+                                    sync_fd >= 0 ? &sync_fd : nullptr, sync_fd >= 0 ? 1 : 0);
+    }
+
+    int send_bye(int socket_fd)
+    {
+        return send_control_message(socket_fd, ControlMessageType::Bye, nullptr, 0);
+    }
+
+} // namespace vst::ipc
@@ -0,0 +1,290 @@
+#include "ipc/control_server.hpp"
+#include "utils/logger.hpp"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace vst::ipc
+{
+
+    ControlServer::~ControlServer()
+    {
+        stop();
+    }
+
+    bool ControlServer::start(const std::string &socketPath, const ImageDescription &desc, const std::vector<int> &imageFds)
+    {
+        if (m_running)
+        {
+            LOG_ERR("Control server already running");
+            return false;
+        }
+        if (imageFds.empty() || imageFds.size() > kMaxRingImages)
+        {
+            LOG_ERR("Control server needs 1 to " + std::to_string(kMaxRingImages) + " image fds");
+            return false;
+        }
+
+        m_desc = desc;
+        m_desc.imageCount = static_cast<uint32_t>(imageFds.size());
+        m_imageFds = imageFds;
+
+        m_listenFd = setup_control_server_socket(socketPath);
+        m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+        m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_listenFd < 0 || m_epollFd < 0 || m_wakeFd < 0)
+        {
+            LOG_ERR("Failed to set up control server: " + std::string(strerror(errno)));
+            stop();
+            return false;
+        }
+
+        // Accept in a loop until EAGAIN, so the listening socket must not block
+        int flags = fcntl(m_listenFd, F_GETFL, 0);
+        fcntl(m_listenFd, F_SETFL, flags | O_NONBLOCK);
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = m_listenFd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &ev);
+        ev.data.fd = m_wakeFd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev);
+
+        m_running = true;
+        m_thread = std::thread(&ControlServer::run, this);
+        return true;
+    }
+
+    void ControlServer::setSyncDescription(const SyncDescription &desc, int semaphoreFd)
+    {
+        m_sync = desc;
+        m_semaphoreFd = semaphoreFd;
+    }
+
+    void ControlServer::stop()
+    {
+        if (m_running.exchange(false))
+        {
+            uint64_t one = 1;
+            if (write(m_wakeFd, &one, sizeof(one)) < 0)
+            {
+                LOG_ERR("Failed to wake control server thread");
+            }
+        }
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+
+        for (int clientFd : m_clients)
+        {
+            send_bye(clientFd);
+            close(clientFd);
+        }
+        m_clients.clear();
+        m_clientCount = 0;
+
+        for (int *fd : {&m_listenFd, &m_epollFd, &m_wakeFd, &m_pendingSyncFd, &m_lastSyncFd})
+        {
+            if (*fd >= 0)
+            {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+    }
+
+    void ControlServer::notifyFrameReady(uint64_t frameIndex, uint32_t imageIndex, uint64_t timestampNs,
+                                         uint64_t signalValue, int syncFd)
+    {
+        if (!m_running)
+        {
+            if (syncFd >= 0)
+                close(syncFd);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_frameMutex);
+            m_pendingFrame = FrameReady{};
+            m_pendingFrame.frameIndex = frameIndex;
+            m_pendingFrame.timestampNs = timestampNs;
+            m_pendingFrame.imageIndex = imageIndex;
+            m_pendingFrame.signalValue = signalValue;
+            m_framePending = true;
+
+            // A frame that was overwritten before it was sent needs no waiting on
+            if (m_pendingSyncFd >= 0)
+                close(m_pendingSyncFd);
+            m_pendingSyncFd = syncFd;
+        }
+
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        {
+            LOG_ERR("Failed to signal control server: " + std::string(strerror(errno)));
+        }
+    }
+
+    void ControlServer::run()
+    {
+        constexpr int kMaxEvents = 16;
+        epoll_event events[kMaxEvents];
+
+        while (m_running)
+        {
+            int count = epoll_wait(m_epollFd, events, kMaxEvents, -1);
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                LOG_ERR("epoll_wait failed: " + std::string(strerror(errno)));
+                break;
+            }
+
+            for (int i = 0; i < count; ++i)
+            {
+                int fd = events[i].data.fd;
+                if (fd == m_listenFd)
+                {
+                    acceptClients();
+                }
+                else if (fd == m_wakeFd)
+                {
+                    uint64_t value;
+                    while (read(m_wakeFd, &value, sizeof(value)) > 0)
+                    {
+                    }
+                    broadcastFrameReady();
+                }
+                else
+                {
+                    handleClient(fd, events[i].events);
+                }
+            }
+        }
+    }
+
+    void ControlServer::acceptClients()
+    {
+        int clientFd;
+        while ((clientFd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+        {
+            if (send_image_description(clientFd, m_desc, m_imageFds.data()) < 0)
+            {
+                LOG_ERR("Failed to send image description to consumer");
+                close(clientFd);
+                continue;
+            }
+
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            ev.data.fd = clientFd;
+            if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, clientFd, &ev) < 0)
+            {
+                LOG_ERR("Failed to watch consumer socket: " + std::string(strerror(errno)));
+                close(clientFd);
+                continue;
+            }
+
+            if (m_sync.mode != 0 && send_sync_description(clientFd, m_sync, m_semaphoreFd) < 0)
+            {
+                LOG_ERR("Failed to send sync description to consumer");
+                epoll_ctl(m_epollFd, EPOLL_CTL_DEL, clientFd, nullptr);
+                close(clientFd);
+                continue;
+            }
+
+            // Tell the newcomer which image is current instead of making it wait a frame
+            if (m_haveLastFrame)
+            {
+                send_frame_ready(clientFd, m_lastFrame, m_lastSyncFd);
+            }
+
+            m_clients.push_back(clientFd);
+            m_clientCount = m_clients.size();
+            LOG_INFO("Consumer connected (" + std::to_string(m_clients.size()) + " total)");
+        }
+    }
+
+    void ControlServer::handleClient(int clientFd, uint32_t events)
+    {
+        if (events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP))
+        {
+            dropClient(clientFd);
+            return;
+        }
+
+        // Consumers only ever say goodbye today; anything else is ignored
+        ControlMessageType type;
+        while (receive_control_message(clientFd, type, nullptr, 0) == 0)
+        {
+            if (type == ControlMessageType::Bye)
+            {
+                dropClient(clientFd);
+                return;
+            }
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            dropClient(clientFd);
+        }
+    }
+
+    void ControlServer::dropClient(int clientFd)
+    {
+        auto it = std::find(m_clients.begin(), m_clients.end(), clientFd);
+        if (it == m_clients.end())
+        {
+            return;
+        }
+
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, clientFd, nullptr);
+        close(clientFd);
+        m_clients.erase(it);
+        m_clientCount = m_clients.size();
+        LOG_INFO("Consumer disconnected (" + std::to_string(m_clients.size()) + " left)");
+    }
+
+    void ControlServer::broadcastFrameReady()
+    {
+        FrameReady frame;
+        int syncFd;
+        {
+            std::lock_guard<std::mutex> lock(m_frameMutex);
+            if (!m_framePending)
+            {
+                return;
+            }
+            frame = m_pendingFrame;
+            syncFd = m_pendingSyncFd;
+            m_framePending = false;
+            m_pendingSyncFd = -1;
+        }
+        m_lastFrame = frame;
+        m_haveLastFrame = true;
+        if (m_lastSyncFd >= 0)
+            close(m_lastSyncFd);
+        m_lastSyncFd = syncFd;
+
+        // Iterate over a copy: a failed send drops the client from m_clients
+        std::vector<int> clients = m_clients;
+        for (int clientFd : clients)
+        {
+            // A full socket only means that consumer is behind; anything else means it is gone
+            if (send_frame_ready(clientFd, frame, syncFd) < 0 &&
+                errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                dropClient(clientFd);
+            }
+        }
+    }
+
+} // namespace vst::ipc
@@ -21,6 +21,19 @@ namespace vst
                                      VkCommandPool commandPool,
                                      VkQueue graphicsQueue,
                                      bool exportMemory)
+    {
+        // Everything on the one queue
+        SubmitQueue queue{graphicsQueue, VK_QUEUE_FAMILY_IGNORED, commandPool};
+        return loadTexture(path, device, physicalDevice, queue, queue, exportMemory);
+    }
+
+    TextureImage ImageLoader::loadTexture(const std::string &path,
+                                          VkDevice device,
+                                          VkPhysicalDevice physicalDevice,
+                                          const SubmitQueue &graphics,
+                                          const SubmitQueue &transfer,
+                                          bool exportMemory,
+                                          memory::DeviceAllocator *allocator)
     {
         int texWidth, texHeight, texChannels;
         stbi_uc *pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
@@ -32,15 +45,28 @@ namespace vst
         VkDeviceSize imageSize = texWidth * texHeight * 4; // RGBA
 
         VkBuffer stagingBuffer;
-        VkDeviceMemory stagingMemory;
-        createBuffer(device, physicalDevice, imageSize, stagingBuffer, stagingMemory,
-                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        void *data;
-        vkMapMemory(device, stagingMemory, 0, imageSize, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(device, stagingMemory);
+        VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+        memory::Allocation stagingAllocation;
+        if (allocator)
+        {
+            // Freed right after the upload, so it comes from the transient ring
+            createBuffer(*allocator, imageSize, stagingBuffer, stagingAllocation,
+                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         memory::AllocationUsage::Transient);
+            memcpy(stagingAllocation.mapped, pixels, static_cast<size_t>(imageSize));
+        }
+        else
+        {
+            createBuffer(device, physicalDevice, imageSize, stagingBuffer, stagingMemory,
+                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+            void *data;
+            vkMapMemory(device, stagingMemory, 0, imageSize, 0, &data);
+            memcpy(data, pixels, static_cast<size_t>(imageSize));
+            vkUnmapMemory(device, stagingMemory);
+        }
 
         stbi_image_free(pixels);
 
@@ -48,21 +74,30 @@ namespace vst
         texture.width = texWidth;
         texture.height = texHeight;
 
-        createImage(device, physicalDevice, texWidth, texHeight, texture.image, texture.memory, exportMemory);
-
-        transitionImageLayout(device, commandPool, graphicsQueue,
-                              texture.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-        copyBufferToImage(device, commandPool, graphicsQueue,
-                          stagingBuffer, texture.image, texWidth, texHeight);
+        if (allocator)
+        {
+            createImage(*allocator, texWidth, texHeight, texture.image, texture.allocation, exportMemory);
+            texture.memory = texture.allocation.memory;
+        }
+        else
+        {
+            createImage(device, physicalDevice, texWidth, texHeight, texture.image, texture.memory, exportMemory);
+        }
 
-        transitionImageLayout(device, commandPool, graphicsQueue,
-                              texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        uploadBufferToImage(device, graphics, transfer, stagingBuffer, texture.image,
+                            static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
 
         texture.view = createImageView(device, texture.image);
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingMemory, nullptr);
+        if (allocator)
+        {
+            destroyBuffer(*allocator, stagingBuffer, stagingAllocation);
+        }
+        else
+        {
+            vkDestroyBuffer(device, stagingBuffer, nullptr);
+            vkFreeMemory(device, stagingMemory, nullptr);
+        }
 
         return texture;
     }
@@ -0,0 +1,539 @@
+#include "media/shm_texture.hpp"
+#include "core/vulkan_context.hpp"
+#include "core/vulkan_utils.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace vst
+{
+
+    ShmTexture::ShmTexture(VulkanContext &ctx)
+        : context(ctx)
+    {
+    }
+
+    ShmTexture::~ShmTexture()
+    {
+        destroy();
+    }
+
+    void ShmTexture::create(memory::ShmVideoHandler &handler)
+    {
+        memory::ShmPixelFormat pixelFormat = handler.getPixelFormat();
+        m_convert = pixelFormat != memory::ShmPixelFormat::RGBA8;
+        if (pixelFormat == memory::ShmPixelFormat::BGR8)
+        {
+            m_sourceFormat = SourceFormat::BGR24;
+        }
+        else if (pixelFormat == memory::ShmPixelFormat::NV12)
+        {
+            m_sourceFormat = SourceFormat::NV12;
+        }
+        else if (pixelFormat == memory::ShmPixelFormat::I420)
+        {
+            m_sourceFormat = SourceFormat::I420;
+        }
+        else if (m_convert)
+        {
+            throw std::runtime_error("SHM texture needs an RGBA8, BGR8, NV12 or I420 segment.");
+        }
+
+        if (m_convert)
+        {
+            if (!m_converter)
+            {
+                throw std::runtime_error("SHM texture needs a colour converter for segments that are not RGBA8.");
+            }
+
+            // Uploads, conversions and draws share the graphics queue
+            uint32_t familyCount = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(context.getPhysicalDevice(), &familyCount, nullptr);
+            std::vector<VkQueueFamilyProperties> families(familyCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(context.getPhysicalDevice(), &familyCount, families.data());
+            if (!(families[context.getGraphicsQueueFamily()].queueFlags & VK_QUEUE_COMPUTE_BIT))
+            {
+                throw std::runtime_error("SHM texture needs a graphics queue that runs compute to convert frames.");
+            }
+        }
+
+        VkDevice device = context.getDevice();
+        memory::ShmVideoFrameHeader metadata = handler.getFrameMetadata();
+        texWidth = metadata.width;
+        texHeight = metadata.height;
+        uint32_t frameRows = m_convert && m_sourceFormat != SourceFormat::BGR24 ? texHeight * 3 / 2 : texHeight;
+        m_frameSize = static_cast<VkDeviceSize>(metadata.rowStride) * frameRows;
+        m_lastFrameSeq = 0;
+
+        createImage(m_convert ? VK_IMAGE_USAGE_STORAGE_BIT : 0);
+        imageView = vulkan_utils::createImageView(device, image);
+        m_currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (m_convert)
+        {
+            // One set per imported slot and one per staging buffer, whichever path is taken
+            uint32_t setCount = handler.getSlotCount() + kUploadSlots;
+            VkDescriptorPoolSize poolSizes[] = {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, setCount},
+                                                {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, setCount}};
+            VkDescriptorPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+            poolInfo.maxSets = setCount;
+            poolInfo.poolSizeCount = 2;
+            poolInfo.pPoolSizes = poolSizes;
+            if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_convertPool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create SHM conversion descriptor pool.");
+            }
+        }
+
+        if (context.hasExternalMemoryHost() && importSlots(handler))
+        {
+            if (m_convert)
+            {
+                for (VkBuffer buffer : m_slotBuffers)
+                {
+                    m_slotConvertSets.push_back(allocateConvertSet(buffer));
+                }
+            }
+            createUploadRing();
+            LOG_INFO("SHM texture imports " << m_slotBuffers.size() << " slots as host memory, frames are not copied on the CPU");
+            return;
+        }
+
+        createUploadRing();
+        LOG_INFO("SHM texture uploads through a staging buffer");
+    }
+
+    void ShmTexture::createImage(VkImageUsageFlags usage)
+    {
+        VkImageCreateInfo imageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = {texWidth, texHeight, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+        if (vkCreateImage(context.getDevice(), &imageInfo, nullptr, &image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create SHM texture image.");
+        }
+        if (!context.getAllocator().allocateForImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                     memory::AllocationUsage::Persistent, m_imageAllocation))
+        {
+            vkDestroyImage(context.getDevice(), image, nullptr);
+            image = VK_NULL_HANDLE;
+            throw std::runtime_error("Failed to allocate SHM texture image memory.");
+        }
+    }
+
+    void ShmTexture::createUploadRing()
+    {
+        VkDevice device = context.getDevice();
+
+        VkCommandPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = context.getGraphicsQueueFamily();
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create SHM upload command pool.");
+        }
+
+        VkBufferUsageFlags stagingUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        if (m_convert)
+        {
+            stagingUsage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        }
+
+        m_uploadSlots.resize(kUploadSlots);
+        for (UploadSlot &slot : m_uploadSlots)
+        {
+            // Frames are read from the imported slots directly when there are any
+            if (!isImportingHostMemory())
+            {
+                vulkan_utils::createBuffer(context.getAllocator(), m_frameSize, slot.staging, slot.stagingAllocation,
+                                           stagingUsage,
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+                if (m_convert)
+                {
+                    slot.convertSet = allocateConvertSet(slot.staging);
+                }
+            }
+
+            VkCommandBufferAllocateInfo allocInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+            allocInfo.commandPool = m_commandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+            fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+            if (vkAllocateCommandBuffers(device, &allocInfo, &slot.commandBuffer) != VK_SUCCESS ||
+                vkCreateFence(device, &fenceInfo, nullptr, &slot.fence) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create SHM upload slot.");
+            }
+        }
+        m_nextUploadSlot = 0;
+    }
+
+    VkDescriptorSet ShmTexture::allocateConvertSet(VkBuffer source)
+    {
+        VkDescriptorSetLayout setLayout = m_converter->getDescriptorSetLayout();
+        VkDescriptorSetAllocateInfo setInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+        setInfo.descriptorPool = m_convertPool;
+        setInfo.descriptorSetCount = 1;
+        setInfo.pSetLayouts = &setLayout;
+
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        if (vkAllocateDescriptorSets(context.getDevice(), &setInfo, &set) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate SHM conversion descriptor set.");
+        }
+        m_converter->updateDescriptorSet(context.getDevice(), set, source, imageView);
+        return set;
+    }
+
+    bool ShmTexture::importSlots(const memory::ShmVideoHandler &handler)
+    {
+        VkDevice device = context.getDevice();
+        auto vkGetMemoryHostPointerPropertiesEXT = reinterpret_cast<PFN_vkGetMemoryHostPointerPropertiesEXT>(
+            vkGetDeviceProcAddr(device, "vkGetMemoryHostPointerPropertiesEXT"));
+        if (!vkGetMemoryHostPointerPropertiesEXT)
+        {
+            return false;
+        }
+
+        VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProps{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT};
+        VkPhysicalDeviceProperties2 props{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+        props.pNext = &hostProps;
+        vkGetPhysicalDeviceProperties2(context.getPhysicalDevice(), &props);
+        VkDeviceSize alignment = hostProps.minImportedHostPointerAlignment;
+
+        const VkExternalMemoryHandleTypeFlagBits handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+        for (uint32_t slot = 0; slot < handler.getSlotCount(); ++slot)
+        {
+            size_t size = 0;
+            const uint8_t *data = handler.getSlotData(slot, size);
+
+            // Slots are page aligned, but some drivers want larger pointer alignment
+            if (!data || alignment == 0 || reinterpret_cast<uintptr_t>(data) % alignment != 0 || size % alignment != 0)
+            {
+                LOG_WARN("SHM slot " << slot << " is not aligned to " << alignment << " bytes, using staging uploads");
+                releaseSlots();
+                return false;
+            }
+
+            // The import never writes, but the API takes a mutable pointer
+            void *hostPointer = const_cast<uint8_t *>(data);
+            VkMemoryHostPointerPropertiesEXT pointerProps{VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT};
+            if (vkGetMemoryHostPointerPropertiesEXT(device, handleType, hostPointer, &pointerProps) != VK_SUCCESS)
+            {
+                LOG_WARN("Driver cannot import SHM slot " << slot << ", using staging uploads");
+                releaseSlots();
+                return false;
+            }
+
+            VkExternalMemoryBufferCreateInfo externalInfo{VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO};
+            externalInfo.handleTypes = handleType;
+            VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+            bufferInfo.pNext = &externalInfo;
+            bufferInfo.size = size;
+            bufferInfo.usage = m_convert ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            VkBuffer buffer;
+            if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+            {
+                releaseSlots();
+                return false;
+            }
+            m_slotBuffers.push_back(buffer);
+            m_slotMemories.push_back(VK_NULL_HANDLE);
+
+            VkMemoryRequirements memReqs;
+            vkGetBufferMemoryRequirements(device, buffer, &memReqs);
+            uint32_t typeBits = memReqs.memoryTypeBits & pointerProps.memoryTypeBits;
+            if (typeBits == 0)
+            {
+                LOG_WARN("No memory type can hold both a buffer and SHM slot " << slot << ", using staging uploads");
+                releaseSlots();
+                return false;
+            }
+
+            VkImportMemoryHostPointerInfoEXT importInfo{VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT};
+            importInfo.handleType = handleType;
+            importInfo.pHostPointer = hostPointer;
+            VkMemoryAllocateInfo memoryInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+            memoryInfo.pNext = &importInfo;
+            memoryInfo.allocationSize = size;
+            memoryInfo.memoryTypeIndex = vulkan_utils::findMemoryType(context.getPhysicalDevice(), typeBits, 0);
+
+            if (vkAllocateMemory(device, &memoryInfo, nullptr, &m_slotMemories.back()) != VK_SUCCESS ||
+                vkBindBufferMemory(device, buffer, m_slotMemories.back(), 0) != VK_SUCCESS)
+            {
+                LOG_WARN("Failed to import SHM slot " << slot << ", using staging uploads");
+                releaseSlots();
+                return false;
+            }
+        }
+
+        return !m_slotBuffers.empty();
+    }
+
+    void ShmTexture::releaseSlots()
+    {
+        VkDevice device = context.getDevice();
+        for (VkBuffer buffer : m_slotBuffers)
+        {
+            vkDestroyBuffer(device, buffer, nullptr);
+        }
+        for (VkDeviceMemory memory : m_slotMemories)
+        {
+            if (memory != VK_NULL_HANDLE)
+            {
+                vkFreeMemory(device, memory, nullptr);
+            }
+        }
+        m_slotBuffers.clear();
+        m_slotMemories.clear();
+        m_slotConvertSets.clear();
+    }
+
+    void ShmTexture::releaseFinishedUploads()
+    {
+        for (UploadSlot &slot : m_uploadSlots)
+        {
+            if (slot.lease.isValid() && vkGetFenceStatus(context.getDevice(), slot.fence) == VK_SUCCESS)
+            {
+                slot.lease.release();
+            }
+        }
+    }
+
+    void ShmTexture::collectRegions(const memory::ShmVideoFrameLease &lease)
+    {
+        // Slot rows are padded to a cache line; RGBA8 keeps that a whole number of texels
+        VkBufferImageCopy region{};
+        region.bufferRowLength = static_cast<uint32_t>(lease.stride() / 4);
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageExtent = {texWidth, texHeight, 1};
+        m_regions.clear();
+
+        // The dirty mask is relative to the previous frame, so it only helps if the image holds that one
+        uint32_t tileSize = lease.tileSize();
+        if (tileSize == 0 || m_lastFrameSeq == 0 || lease.frameSeq() != m_lastFrameSeq + 1)
+        {
+            m_regions.push_back(region);
+            return;
+        }
+
+        for (uint32_t tileY = 0; tileY < lease.tilesY(); ++tileY)
+        {
+            for (uint32_t tileX = 0; tileX < lease.tilesX(); ++tileX)
+            {
+                if (!lease.isTileDirty(tileX, tileY))
+                {
+                    continue;
+                }
+
+                uint32_t x = tileX * tileSize;
+                uint32_t y = tileY * tileSize;
+                region.bufferOffset = static_cast<VkDeviceSize>(y) * lease.stride() + static_cast<VkDeviceSize>(x) * 4;
+                region.imageOffset = {static_cast<int32_t>(x), static_cast<int32_t>(y), 0};
+                region.imageExtent = {std::min(tileSize, texWidth - x), std::min(tileSize, texHeight - y), 1};
+                m_regions.push_back(region);
+            }
+        }
+
+        // A fully rewritten frame is one copy rather than one per tile
+        if (m_regions.size() == static_cast<size_t>(lease.tilesX()) * lease.tilesY())
+        {
+            region.bufferOffset = 0;
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {texWidth, texHeight, 1};
+            m_regions.assign(1, region);
+        }
+    }
+
+    void ShmTexture::upload(memory::ShmVideoFrameLease &&lease)
+    {
+        if (!lease.isValid() || image == VK_NULL_HANDLE)
+        {
+            throw std::runtime_error("SHM texture upload without a frame or image.");
+        }
+        if (isImportingHostMemory() && lease.slotIndex() >= m_slotBuffers.size())
+        {
+            throw std::runtime_error("SHM frame lease names an unknown slot.");
+        }
+
+        // Hand back slots the GPU is done with, so the producer can reuse them
+        releaseFinishedUploads();
+
+        if (!m_convert)
+        {
+            collectRegions(lease);
+        }
+        uint64_t frameSeq = lease.frameSeq();
+        if (!m_convert && m_regions.empty())
+        {
+            // Nothing changed since the frame the image already holds
+            m_lastFrameSeq = frameSeq;
+            lease.release();
+            return;
+        }
+
+        // The slot was last used kUploadSlots uploads ago, so this normally returns at once
+        UploadSlot &slot = m_uploadSlots[m_nextUploadSlot];
+        m_nextUploadSlot = (m_nextUploadSlot + 1) % kUploadSlots;
+        vkWaitForFences(context.getDevice(), 1, &slot.fence, VK_TRUE, UINT64_MAX);
+        slot.lease.release();
+
+        VkBuffer source = slot.staging;
+        VkDescriptorSet convertSet = slot.convertSet;
+        if (isImportingHostMemory())
+        {
+            source = m_slotBuffers[lease.slotIndex()];
+            convertSet = m_convert ? m_slotConvertSets[lease.slotIndex()] : VK_NULL_HANDLE;
+        }
+        else
+        {
+            std::memcpy(slot.stagingAllocation.mapped, lease.data(), static_cast<size_t>(m_frameSize));
+        }
+
+        VkCommandBuffer cmd = slot.commandBuffer;
+        vkResetCommandBuffer(cmd, 0);
+
+        VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cmd, &beginInfo);
+
+        VkImageLayout writeLayout = m_convert ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        VkPipelineStageFlags writeStage = m_convert ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+        VkAccessFlags writeAccess = m_convert ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        // Earlier draws on this queue sample the image, so the write waits for their fragment shading.
+        // The old contents are kept, since a partial copy only rewrites the dirty tiles.
+        VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        barrier.oldLayout = m_currentLayout;
+        barrier.newLayout = writeLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = writeAccess;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, writeStage,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        if (m_convert)
+        {
+            m_converter->record(cmd, convertSet, m_sourceFormat, texWidth, texHeight, static_cast<uint32_t>(lease.stride()));
+        }
+        else
+        {
+            vkCmdCopyBufferToImage(cmd, source, image, writeLayout, static_cast<uint32_t>(m_regions.size()), m_regions.data());
+        }
+
+        barrier.oldLayout = writeLayout;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = writeAccess;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(cmd, writeStage, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to record SHM upload.");
+        }
+
+        VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &cmd;
+        vkResetFences(context.getDevice(), 1, &slot.fence);
+        if (vkQueueSubmit(context.getGraphicsQueue(), 1, &submitInfo, slot.fence) != VK_SUCCESS)
+        {
+            // Nothing was queued, so the fence would never signal; swap in a signalled one
+            vkDestroyFence(context.getDevice(), slot.fence, nullptr);
+            VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+            fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+            vkCreateFence(context.getDevice(), &fenceInfo, nullptr, &slot.fence);
+            throw std::runtime_error("Failed to submit SHM upload.");
+        }
+        m_currentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        m_lastFrameSeq = frameSeq;
+
+        // The GPU reads an imported slot itself, so it stays pinned until the fence signals
+        if (isImportingHostMemory())
+        {
+            slot.lease = std::move(lease);
+        }
+        else
+        {
+            lease.release();
+        }
+    }
+
+    void ShmTexture::waitIdle()
+    {
+        for (UploadSlot &slot : m_uploadSlots)
+        {
+            if (slot.fence != VK_NULL_HANDLE)
+            {
+                vkWaitForFences(context.getDevice(), 1, &slot.fence, VK_TRUE, UINT64_MAX);
+            }
+            slot.lease.release();
+        }
+    }
+
+    void ShmTexture::destroy()
+    {
+        VkDevice device = context.getDevice();
+        if (device == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        // Queued uploads still read the slots and staging buffers
+        waitIdle();
+        for (UploadSlot &slot : m_uploadSlots)
+        {
+            vkDestroyFence(device, slot.fence, nullptr);
+            vulkan_utils::destroyBuffer(context.getAllocator(), slot.staging, slot.stagingAllocation);
+        }
+        m_uploadSlots.clear();
+        if (m_commandPool != VK_NULL_HANDLE)
+        {
+            vkDestroyCommandPool(device, m_commandPool, nullptr);
+            m_commandPool = VK_NULL_HANDLE;
+        }
+        releaseSlots();
+        // Frees the conversion sets too
+        if (m_convertPool != VK_NULL_HANDLE)
+        {
+            vkDestroyDescriptorPool(device, m_convertPool, nullptr);
+            m_convertPool = VK_NULL_HANDLE;
+        }
+        if (imageView != VK_NULL_HANDLE)
+        {
+            vkDestroyImageView(device, imageView, nullptr);
+            imageView = VK_NULL_HANDLE;
+        }
+        if (image != VK_NULL_HANDLE)
+        {
+            vkDestroyImage(device, image, nullptr);
+            image = VK_NULL_HANDLE;
+        }
+        if (m_imageAllocation.isValid())
+        {
+            context.getAllocator().free(m_imageAllocation);
+        }
+        texWidth = 0;
+        texHeight = 0;
+        m_lastFrameSeq = 0;
+    }
+
+} // namespace vst
@@ -69,7 +69,7 @@ namespace vst
         vkFreeMemory(device, stagingMemory, nullptr);
     }
 
-    void TextureImage::destroy(VkDevice device, TextureImage &texture)
+    void TextureImage::destroy(VkDevice device, TextureImage &texture, memory::DeviceAllocator *allocator)
     {
         if (texture.view != VK_NULL_HANDLE)
         {
@@ -83,7 +83,14 @@ namespace vst
             texture.image = VK_NULL_HANDLE;
         }
 
-        if (texture.memory != VK_NULL_HANDLE)
+        if (texture.allocation.isValid())
+        {
+            // Possibly part of a shared block; only the allocator it came from may free it
+            if (allocator)
+                allocator->free(texture.allocation);
+            texture.memory = VK_NULL_HANDLE;
+        }
+        else if (texture.memory != VK_NULL_HANDLE)
         {
             vkFreeMemory(device, texture.memory, nullptr);
             texture.memory = VK_NULL_HANDLE;
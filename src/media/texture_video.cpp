@@ -238,6 +238,11 @@ namespace vst
         imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT |
                           VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
                           VK_IMAGE_USAGE_SAMPLED_BIT;
+        if (m_converter)
+        {
+            // The colour converter writes the image from a compute shader
+            imageInfo.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+        }
 
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -254,30 +259,13 @@ namespace vst
 
         std::cout << "Memory size: " << memRequirements.size << '\n';
 
-        // External memory allocation info for DMA-BUF export
-        VkExportMemoryAllocateInfo exportAllocInfo{};
-        exportAllocInfo.sType = VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO;
-        exportAllocInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.pNext = &exportAllocInfo; // Add export support
-        allocInfo.allocationSize = memRequirements.size;
-
-        // Find a suitable memory type for DMA-BUF export
-        allocInfo.memoryTypeIndex = vst::vulkan_utils::findMemoryType(
-            context.getPhysicalDevice(),
-            memRequirements.memoryTypeBits,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        std::cout << "Memory type index: " << allocInfo.memoryTypeIndex << '\n';
-
-        if (vkAllocateMemory(context.getDevice(), &allocInfo, nullptr, &memory) != VK_SUCCESS)
+        // Exportable pool: a VkDeviceMemory of its own, since the whole allocation is shared over DMA-BUF
+        if (!context.getAllocator().allocateForImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                     memory::AllocationUsage::Exportable, m_imageAllocation))
         {
             throw std::runtime_error("failed to allocate image memory!");
         }
-
-        vkBindImageMemory(context.getDevice(), image, memory, 0);
+        memory = m_imageAllocation.memory;
 
         std::cout << "Image created and memory bound\n";
 
@@ -335,6 +323,7 @@ namespace vst
 
     void TextureVideo::destroy()
     {
+        destroyUploadRing();
         if (sampler != VK_NULL_HANDLE)
         {
             vkDestroySampler(context.getDevice(), sampler, nullptr);
@@ -350,14 +339,157 @@ namespace vst
             vkDestroyImage(context.getDevice(), image, nullptr);
             image = VK_NULL_HANDLE;
         }
-        if (memory != VK_NULL_HANDLE)
+        context.getAllocator().free(m_imageAllocation);
+        memory = VK_NULL_HANDLE;
+    }
+
+    void TextureVideo::createUploadRing()
+    {
+        VkDevice device = context.getDevice();
+        VkDeviceSize imageSize = static_cast<VkDeviceSize>(texWidth) * texHeight * 4; // RGBA 4 channels
+
+        // Conversions need a compute queue; compute queues also copy, so RGBA frames go there too.
+        // Copies into a GENERAL image are valid, which keeps one layout for both kinds of upload.
+        m_uploadFamily = m_converter ? context.getComputeQueueFamily() : context.getTransferQueueFamily();
+        m_uploadQueue = m_converter ? context.getComputeQueue() : context.getTransferQueue();
+        m_writeLayout = m_converter ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        m_transferHandOver = m_uploadFamily != context.getGraphicsQueueFamily();
+
+        // Own pool so each slot's command buffer can be reset and re-recorded
+        VkCommandPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = m_uploadFamily;
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &m_uploadPool) != VK_SUCCESS)
         {
-            vkFreeMemory(context.getDevice(), memory, nullptr);
-            memory = VK_NULL_HANDLE;
+            throw std::runtime_error("failed to create upload command pool!");
         }
+
+        if (m_transferHandOver)
+        {
+            VkCommandPoolCreateInfo acquirePoolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+            acquirePoolInfo.queueFamilyIndex = context.getGraphicsQueueFamily();
+            if (vkCreateCommandPool(device, &acquirePoolInfo, nullptr, &m_acquirePool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create acquire command pool!");
+            }
+        }
+
+        if (m_converter)
+        {
+            VkDescriptorPoolSize poolSizes[] = {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, kUploadSlots},
+                                                {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, kUploadSlots}};
+            VkDescriptorPoolCreateInfo descriptorPoolInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+            descriptorPoolInfo.maxSets = kUploadSlots;
+            descriptorPoolInfo.poolSizeCount = 2;
+            descriptorPoolInfo.pPoolSizes = poolSizes;
+            if (vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &m_convertPool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create colour conversion descriptor pool!");
+            }
+        }
+
+        // RGBA is the largest layout a slot ever holds, raw frames fit in the same buffer
+        VkBufferUsageFlags stagingUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        if (m_converter)
+        {
+            stagingUsage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        }
+
+        m_uploadSlots.resize(kUploadSlots);
+        for (auto &slot : m_uploadSlots)
+        {
+            // Host-visible blocks stay mapped, so the slot keeps the allocator's pointer
+            vst::vulkan_utils::createBuffer(context.getAllocator(), imageSize, slot.staging, slot.stagingAllocation,
+                                            stagingUsage,
+                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            slot.mapped = slot.stagingAllocation.mapped;
+
+            if (m_converter)
+            {
+                VkDescriptorSetLayout setLayout = m_converter->getDescriptorSetLayout();
+                VkDescriptorSetAllocateInfo setInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+                setInfo.descriptorPool = m_convertPool;
+                setInfo.descriptorSetCount = 1;
+                setInfo.pSetLayouts = &setLayout;
+                if (vkAllocateDescriptorSets(device, &setInfo, &slot.convertSet) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("failed to allocate colour conversion descriptor set!");
+                }
+                m_converter->updateDescriptorSet(device, slot.convertSet, slot.staging, imageView);
+            }
+
+            VkCommandBufferAllocateInfo allocInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+            allocInfo.commandPool = m_uploadPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+            fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+            if (vkAllocateCommandBuffers(device, &allocInfo, &slot.commandBuffer) != VK_SUCCESS ||
+                vkCreateFence(device, &fenceInfo, nullptr, &slot.fence) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create upload slot!");
+            }
+
+            if (!m_transferHandOver)
+            {
+                continue;
+            }
+
+            // The acquire never changes, so it is recorded once and resubmitted every upload
+            allocInfo.commandPool = m_acquirePool;
+            VkSemaphoreCreateInfo semInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+            if (vkAllocateCommandBuffers(device, &allocInfo, &slot.acquireCommandBuffer) != VK_SUCCESS ||
+                vkCreateSemaphore(device, &semInfo, nullptr, &slot.copied) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create upload slot!");
+            }
+
+            VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+            vkBeginCommandBuffer(slot.acquireCommandBuffer, &beginInfo);
+            vst::vulkan_utils::recordOwnershipBarrier(slot.acquireCommandBuffer, image,
+                                                      m_uploadFamily, context.getGraphicsQueueFamily(),
+                                                      m_writeLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false);
+            vkEndCommandBuffer(slot.acquireCommandBuffer);
+        }
+        m_nextUploadSlot = 0;
     }
 
-    void TextureVideo::updateFromFrame(const cv::Mat &frame)
+    void TextureVideo::destroyUploadRing()
+    {
+        VkDevice device = context.getDevice();
+        for (auto &slot : m_uploadSlots)
+        {
+            if (slot.fence != VK_NULL_HANDLE)
+            {
+                vkWaitForFences(device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+                vkDestroyFence(device, slot.fence, nullptr);
+            }
+            vst::vulkan_utils::destroyBuffer(context.getAllocator(), slot.staging, slot.stagingAllocation);
+            if (slot.copied != VK_NULL_HANDLE)
+            {
+                vkDestroySemaphore(device, slot.copied, nullptr);
+            }
+        }
+        m_uploadSlots.clear();
+
+        // Frees the slots' descriptor sets and command buffers too
+        if (m_convertPool != VK_NULL_HANDLE)
+        {
+            vkDestroyDescriptorPool(device, m_convertPool, nullptr);
+            m_convertPool = VK_NULL_HANDLE;
+        }
+        for (VkCommandPool *pool : {&m_uploadPool, &m_acquirePool})
+        {
+            if (*pool != VK_NULL_HANDLE)
+            {
+                vkDestroyCommandPool(device, *pool, nullptr);
+                *pool = VK_NULL_HANDLE;
+            }
+        }
+    }
+
+    void TextureVideo::updateFromFrame(const cv::Mat &frame, VkSemaphore signalSemaphore, uint64_t signalValue)
     {
         if (frame.empty())
         {
@@ -369,48 +501,182 @@ namespace vst
             throw std::runtime_error("Frame size does not match texture size!");
         }
 
-        // Create staging buffer
-        VkDeviceSize imageSize = texWidth * texHeight * 4; // RGBA 4 channels
+        if (frame.type() != CV_8UC3 && frame.type() != CV_8UC4)
+        {
+            throw std::runtime_error("Unsupported frame format!");
+        }
 
-        // Create temporary staging buffer
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
+        submitUpload(frame, frame.channels() == 3, SourceFormat::BGR24, signalSemaphore, signalValue);
+    }
 
-        vst::vulkan_utils::createBuffer(context.getDevice(), context.getPhysicalDevice(), imageSize, stagingBuffer, stagingBufferMemory,
-                                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    void TextureVideo::updateFromYuv(const cv::Mat &frame, SourceFormat format, VkSemaphore signalSemaphore, uint64_t signalValue)
+    {
+        if (frame.empty())
+        {
+            return;
+        }
 
-        // Copy frame data
-        void *data;
-        vkMapMemory(context.getDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
-        if (frame.channels() == 3)
+        if (format == SourceFormat::BGR24 || frame.type() != CV_8UC1 || ((texWidth | texHeight) & 1))
         {
-            // Frame is BGR -> need to expand to RGBA
-            cv::Mat rgbaFrame;
-            cv::cvtColor(frame, rgbaFrame, cv::COLOR_BGR2RGBA);
-            std::memcpy(data, rgbaFrame.data, static_cast<size_t>(imageSize));
+            throw std::runtime_error("Unsupported frame format!");
         }
-        else if (frame.channels() == 4)
+
+        if (frame.cols != static_cast<int>(texWidth) || frame.rows != static_cast<int>(texHeight * 3 / 2))
         {
-            std::memcpy(data, frame.data, static_cast<size_t>(imageSize));
+            throw std::runtime_error("Frame size does not match texture size!");
+        }
+
+        submitUpload(frame, true, format, signalSemaphore, signalValue);
+    }
+
+    void TextureVideo::submitUpload(const cv::Mat &frame, bool raw, SourceFormat format, VkSemaphore signalSemaphore,
+                                    uint64_t signalValue)
+    {
+        if (m_uploadSlots.empty())
+        {
+            createUploadRing();
+        }
+
+        // The slot was last used kUploadSlots uploads ago, so this normally returns at once
+        UploadSlot &slot = m_uploadSlots[m_nextUploadSlot];
+        m_nextUploadSlot = (m_nextUploadSlot + 1) % kUploadSlots;
+        vkWaitForFences(context.getDevice(), 1, &slot.fence, VK_TRUE, UINT64_MAX);
+
+        // Write straight into the mapped staging memory; no per-frame allocation.
+        // With a converter raw frames are copied as decoded and expanded on the GPU.
+        bool convertOnGpu = raw && m_converter;
+        if (convertOnGpu || !raw)
+        {
+            cv::Mat staged(frame.rows, frame.cols, frame.type(), slot.mapped);
+            frame.copyTo(staged);
         }
         else
         {
-            throw std::runtime_error("Unsupported frame format!");
+            cv::Mat staged(static_cast<int>(texHeight), static_cast<int>(texWidth), CV_8UC4, slot.mapped);
+            int conversion = format == SourceFormat::NV12   ? cv::COLOR_YUV2RGBA_NV12
+                             : format == SourceFormat::I420 ? cv::COLOR_YUV2RGBA_I420
+                                                            : cv::COLOR_BGR2RGBA;
+            cv::cvtColor(frame, staged, conversion);
+        }
+
+        VkCommandBuffer cmd = slot.commandBuffer;
+        vkResetCommandBuffer(cmd, 0);
+
+        VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cmd, &beginInfo);
+
+        VkPipelineStageFlags writeStage = convertOnGpu ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+        VkAccessFlags writeAccess = convertOnGpu ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        // The image is sampled between uploads, so move it to the write layout and back around the upload.
+        // Every texel is overwritten, so on another queue family the old contents are simply discarded
+        // and no acquire from the graphics queue is needed. Nothing orders this after draws still
+        // sampling the image; that holds only because the ring is deeper than the frames in flight
+        // (ProducerApp::kMinDmaRingSize).
+        VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        barrier.oldLayout = m_transferHandOver ? VK_IMAGE_LAYOUT_UNDEFINED : m_currentLayout;
+        barrier.newLayout = m_writeLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = writeAccess;
+        vkCmdPipelineBarrier(cmd,
+                             m_transferHandOver ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             writeStage,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        if (convertOnGpu)
+        {
+            m_converter->record(cmd, slot.convertSet, format, texWidth, texHeight);
+        }
+        else
+        {
+            VkBufferImageCopy region{};
+            region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            region.imageExtent = {texWidth, texHeight, 1};
+            vkCmdCopyBufferToImage(cmd, slot.staging, image, m_writeLayout, 1, &region);
+        }
+
+        if (m_transferHandOver)
+        {
+            // Release to the graphics queue; the slot's acquire completes the transfer
+            vst::vulkan_utils::recordOwnershipBarrier(cmd, image,
+                                                      m_uploadFamily, context.getGraphicsQueueFamily(),
+                                                      m_writeLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                      writeStage, writeAccess, true);
+        }
+        else
+        {
+            barrier.oldLayout = m_writeLayout;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = writeAccess;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(cmd,
+                                 writeStage, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+        m_currentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        vkEndCommandBuffer(cmd);
+
+        // The upload runs on its own queue beside rendering; with a hand-over the graphics
+        // queue waits for it on the GPU, acquires the image and signals completion from there
+        VkPipelineStageFlags acquireWaitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        if (m_transferHandOver)
+        {
+            VkSubmitInfo copySubmit{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+            copySubmit.commandBufferCount = 1;
+            copySubmit.pCommandBuffers = &cmd;
+            copySubmit.signalSemaphoreCount = 1;
+            copySubmit.pSignalSemaphores = &slot.copied;
+            if (vkQueueSubmit(m_uploadQueue, 1, &copySubmit, VK_NULL_HANDLE) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to submit frame upload!");
+            }
         }
-        vkUnmapMemory(context.getDevice(), stagingBufferMemory);
 
-        // Transition image layout and copy buffer to image
-        vst::vulkan_utils::copyBufferToImage(context.getDevice(),
-                                             context.getCommandPool(),
-                                             context.getGraphicsQueue(),
-                                             stagingBuffer,
-                                             image,
-                                             texWidth,
-                                             texHeight);
+        VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = m_transferHandOver ? &slot.acquireCommandBuffer : &cmd;
+        if (m_transferHandOver)
+        {
+            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.pWaitSemaphores = &slot.copied;
+            submitInfo.pWaitDstStageMask = &acquireWaitStage;
+        }
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+        if (signalSemaphore != VK_NULL_HANDLE)
+        {
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &signalSemaphore;
+            if (signalValue != 0)
+            {
+                timelineInfo.signalSemaphoreValueCount = 1;
+                timelineInfo.pSignalSemaphoreValues = &signalValue;
+                submitInfo.pNext = &timelineInfo;
+            }
+        }
 
-        // Clean up staging
-        vkDestroyBuffer(context.getDevice(), stagingBuffer, nullptr);
-        vkFreeMemory(context.getDevice(), stagingBufferMemory, nullptr);
+        vkResetFences(context.getDevice(), 1, &slot.fence);
+        VkQueue queue = m_transferHandOver ? context.getGraphicsQueue() : m_uploadQueue;
+        if (vkQueueSubmit(queue, 1, &submitInfo, slot.fence) != VK_SUCCESS)
+        {
+            // Nothing was queued, so the fence would never signal; swap in a signalled one
+            vkDestroyFence(context.getDevice(), slot.fence, nullptr);
+            VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+            fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+            vkCreateFence(context.getDevice(), &fenceInfo, nullptr, &slot.fence);
+            throw std::runtime_error("failed to submit frame upload!");
+        }
+
+        // Without a semaphore the caller has no other way to know the upload is done
+        if (signalSemaphore == VK_NULL_HANDLE)
+        {
+            vkWaitForFences(context.getDevice(), 1, &slot.fence, VK_TRUE, UINT64_MAX);
+        }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,570 @@
+#include "memory/device_allocator.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+
+namespace vst::memory
+{
+
+    // Smallest buddy allocation; orders count up from here
+    static constexpr VkDeviceSize kMinBuddySize = 256;
+
+    static VkDeviceSize nextPowerOfTwo(VkDeviceSize value)
+    {
+        VkDeviceSize result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static uint32_t orderForSize(VkDeviceSize size)
+    {
+        uint32_t order = 0;
+        while ((kMinBuddySize << order) < size)
+        {
+            ++order;
+        }
+        return order;
+    }
+
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static void addToStats(PoolStats &stats, VkDeviceSize reserved, VkDeviceSize used, uint32_t allocations)
+    {
+        stats.blockCount++;
+        stats.reservedBytes += reserved;
+        stats.usedBytes += used;
+        stats.allocationCount += allocations;
+    }
+
+    DeviceAllocator::~DeviceAllocator()
+    {
+        destroy();
+    }
+
+    bool DeviceAllocator::init(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize, VkDeviceSize ringSize)
+    {
+        destroy();
+
+        if (device == VK_NULL_HANDLE || physicalDevice == VK_NULL_HANDLE)
+        {
+            LOG_ERR("Device allocator needs a device");
+            return false;
+        }
+
+        m_device = device;
+        m_physicalDevice = physicalDevice;
+        m_blockSize = nextPowerOfTwo(std::max(blockSize, kMinBuddySize));
+        m_ringSize = std::max<VkDeviceSize>(ringSize, kMinBuddySize);
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        m_maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+        return true;
+    }
+
+    void DeviceAllocator::destroy()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        uint32_t leaked = 0;
+        for (auto &entry : m_blocks)
+        {
+            Block &block = entry.second;
+            leaked += block.allocationCount;
+            if (block.mapped)
+            {
+                vkUnmapMemory(m_device, block.memory);
+            }
+            vkFreeMemory(m_device, block.memory, nullptr);
+        }
+        if (leaked > 0)
+        {
+            LOG_WARN("Device allocator destroyed with " << leaked << " live allocations");
+        }
+
+        m_blocks.clear();
+        m_buddyBlocks.clear();
+        m_rings.clear();
+        m_device = VK_NULL_HANDLE;
+        m_physicalDevice = VK_NULL_HANDLE;
+    }
+
+    bool DeviceAllocator::allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties,
+                                   AllocationUsage usage, bool linear, Allocation &allocation)
+    {
+        allocation = Allocation{};
+
+        uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+        if (memoryTypeIndex == UINT32_MAX)
+        {
+            LOG_ERR("No memory type matches the requested properties");
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_subAllocations++;
+
+        switch (usage)
+        {
+        case AllocationUsage::Exportable:
+            LOG_ERR("Exportable memory is only allocated through allocateForImage");
+            return false;
+        case AllocationUsage::Transient:
+            // Anything too big for the ring would starve it; the buddy pool copes better
+            if (requirements.size <= m_ringSize / 2 &&
+                allocateRing(memoryTypeIndex, linear, requirements.size, requirements.alignment, allocation))
+            {
+                return true;
+            }
+            break;
+        case AllocationUsage::Persistent:
+            break;
+        }
+
+        if (nextPowerOfTwo(std::max(requirements.size, requirements.alignment)) > m_blockSize)
+        {
+            return allocateDedicated(memoryTypeIndex, requirements.size, AllocationUsage::Persistent, nullptr, allocation);
+        }
+        return allocateBuddy(memoryTypeIndex, linear, requirements.size, requirements.alignment, allocation);
+    }
+
+    bool DeviceAllocator::allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, AllocationUsage usage,
+                                            Allocation &allocation)
+    {
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(m_device, buffer, &requirements);
+
+        if (!allocate(requirements, properties, usage, true, allocation))
+        {
+            return false;
+        }
+
+        if (vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+        {
+            LOG_ERR("Failed to bind buffer memory");
+            free(allocation);
+            return false;
+        }
+        return true;
+    }
+
+    bool DeviceAllocator::allocateForImage(VkImage image, VkMemoryPropertyFlags properties, AllocationUsage usage,
+                                           Allocation &allocation)
+    {
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(m_device, image, &requirements);
+
+        if (usage == AllocationUsage::Exportable)
+        {
+            allocation = Allocation{};
+
+            uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+            if (memoryTypeIndex == UINT32_MAX)
+            {
+                LOG_ERR("No memory type matches the requested properties");
+                return false;
+            }
+
+            // One allocation per image, so the exported fd covers exactly this image. No
+            // VkMemoryDedicatedAllocateInfo: consumers import at offset 0 without one.
+            VkExportMemoryAllocateInfo exportInfo{VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO};
+            exportInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_subAllocations++;
+            if (!allocateDedicated(memoryTypeIndex, requirements.size, AllocationUsage::Exportable, &exportInfo, allocation))
+            {
+                return false;
+            }
+        }
+        else if (!allocate(requirements, properties, usage, false, allocation))
+        {
+            return false;
+        }
+
+        if (vkBindImageMemory(m_device, image, allocation.memory, allocation.offset) != VK_SUCCESS)
+        {
+            LOG_ERR("Failed to bind image memory");
+            free(allocation);
+            return false;
+        }
+        return true;
+    }
+
+    void DeviceAllocator::free(Allocation &allocation)
+    {
+        if (!allocation.isValid())
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_blocks.find(allocation.blockId);
+        if (it == m_blocks.end())
+        {
+            LOG_WARN("Freeing an allocation the device allocator does not own");
+            allocation = Allocation{};
+            return;
+        }
+
+        Block &block = it->second;
+        switch (block.kind)
+        {
+        case BlockKind::Dedicated:
+            releaseBlock(allocation.blockId);
+            break;
+        case BlockKind::Buddy:
+            buddyFree(block, allocation.offset);
+            // Keep one empty block per pool around so allocation churn does not reach the driver
+            if (block.allocationCount == 0 && m_buddyBlocks[block.poolKey].size() > 1)
+            {
+                releaseBlock(allocation.blockId);
+            }
+            break;
+        case BlockKind::Ring:
+            ringFree(block, allocation.offset);
+            break;
+        }
+
+        allocation = Allocation{};
+    }
+
+    AllocatorStats DeviceAllocator::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        AllocatorStats stats;
+        for (const auto &entry : m_blocks)
+        {
+            const Block &block = entry.second;
+            PoolStats &pool = block.pool == AllocationUsage::Exportable  ? stats.exportable
+                              : block.pool == AllocationUsage::Transient ? stats.transient
+                                                                         : stats.persistent;
+            addToStats(pool, block.size, block.used, block.allocationCount);
+        }
+        stats.deviceAllocations = m_deviceAllocations;
+        stats.subAllocations = m_subAllocations;
+        stats.maxMemoryAllocationCount = m_maxAllocationCount;
+        return stats;
+    }
+
+    void DeviceAllocator::logStats() const
+    {
+        AllocatorStats stats = getStats();
+        auto logPool = [](const char *name, const PoolStats &pool)
+        {
+            LOG_INFO("  " << name << ": " << pool.allocationCount << " allocations, "
+                          << (pool.usedBytes >> 10) << " / " << (pool.reservedBytes >> 10) << " KiB in "
+                          << pool.blockCount << " blocks");
+        };
+
+        uint32_t blocks = stats.persistent.blockCount + stats.transient.blockCount + stats.exportable.blockCount;
+        LOG_INFO("Device memory: " << blocks << " of " << stats.maxMemoryAllocationCount << " allocations live, "
+                                   << stats.deviceAllocations << " vkAllocateMemory calls for "
+                                   << stats.subAllocations << " requests");
+        logPool("persistent", stats.persistent);
+        logPool("transient", stats.transient);
+        logPool("exportable", stats.exportable);
+    }
+
+    uint32_t DeviceAllocator::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+    {
+        for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+        {
+            if ((typeBits & (1u << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+            {
+                return i;
+            }
+        }
+        return UINT32_MAX;
+    }
+
+    bool DeviceAllocator::allocateDeviceMemory(uint32_t memoryTypeIndex, VkDeviceSize size, const void *pNext, Block &block)
+    {
+        if (m_maxAllocationCount != 0 && m_blocks.size() >= m_maxAllocationCount)
+        {
+            LOG_ERR("maxMemoryAllocationCount (" << m_maxAllocationCount << ") reached");
+            return false;
+        }
+
+        VkMemoryAllocateInfo allocInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+        allocInfo.pNext = pNext;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+        {
+            LOG_ERR("Failed to allocate " << (size >> 10) << " KiB of device memory");
+            return false;
+        }
+        m_deviceAllocations++;
+        block.size = size;
+
+        // Map host-visible memory once for the block's lifetime
+        if (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            if (vkMapMemory(m_device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped) != VK_SUCCESS)
+            {
+                LOG_ERR("Failed to map device memory");
+                vkFreeMemory(m_device, block.memory, nullptr);
+                block.memory = VK_NULL_HANDLE;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint32_t DeviceAllocator::addBlock(Block &&block)
+    {
+        uint32_t blockId = m_nextBlockId++;
+        m_blocks.emplace(blockId, std::move(block));
+        return blockId;
+    }
+
+    void DeviceAllocator::releaseBlock(uint32_t blockId)
+    {
+        auto it = m_blocks.find(blockId);
+        if (it == m_blocks.end())
+        {
+            return;
+        }
+
+        Block &block = it->second;
+        if (block.kind == BlockKind::Buddy)
+        {
+            auto &blocks = m_buddyBlocks[block.poolKey];
+            blocks.erase(std::remove(blocks.begin(), blocks.end(), blockId), blocks.end());
+        }
+        else if (block.kind == BlockKind::Ring)
+        {
+            m_rings.erase(block.poolKey);
+        }
+
+        if (block.mapped)
+        {
+            vkUnmapMemory(m_device, block.memory);
+        }
+        vkFreeMemory(m_device, block.memory, nullptr);
+        m_blocks.erase(it);
+    }
+
+    bool DeviceAllocator::allocateDedicated(uint32_t memoryTypeIndex, VkDeviceSize size, AllocationUsage pool,
+                                            const void *pNext, Allocation &allocation)
+    {
+        Block block;
+        block.kind = BlockKind::Dedicated;
+        block.pool = pool;
+        if (!allocateDeviceMemory(memoryTypeIndex, size, pNext, block))
+        {
+            return false;
+        }
+        block.used = size;
+        block.allocationCount = 1;
+
+        uint32_t blockId = addBlock(std::move(block));
+        fillAllocation(blockId, m_blocks.at(blockId), 0, size, allocation);
+        return true;
+    }
+
+    bool DeviceAllocator::allocateBuddy(uint32_t memoryTypeIndex, bool linear, VkDeviceSize size, VkDeviceSize alignment,
+                                        Allocation &allocation)
+    {
+        // Buddy offsets are aligned to their own size, so rounding up to the alignment covers it
+        uint32_t order = orderForSize(std::max(size, alignment));
+        uint32_t poolKey = memoryTypeIndex * 2 + (linear ? 1 : 0);
+
+        VkDeviceSize offset = 0;
+        for (uint32_t blockId : m_buddyBlocks[poolKey])
+        {
+            Block &block = m_blocks.at(blockId);
+            if (buddyAlloc(block, order, offset))
+            {
+                fillAllocation(blockId, block, offset, size, allocation);
+                return true;
+            }
+        }
+
+        Block block;
+        block.kind = BlockKind::Buddy;
+        block.pool = AllocationUsage::Persistent;
+        block.poolKey = poolKey;
+        if (!allocateDeviceMemory(memoryTypeIndex, m_blockSize, nullptr, block))
+        {
+            return false;
+        }
+        block.freeLists.resize(orderForSize(m_blockSize) + 1);
+        block.freeLists.back().insert(0);
+
+        uint32_t blockId = addBlock(std::move(block));
+        m_buddyBlocks[poolKey].push_back(blockId);
+
+        Block &added = m_blocks.at(blockId);
+        buddyAlloc(added, order, offset);
+        fillAllocation(blockId, added, offset, size, allocation);
+        return true;
+    }
+
+    bool DeviceAllocator::allocateRing(uint32_t memoryTypeIndex, bool linear, VkDeviceSize size, VkDeviceSize alignment,
+                                       Allocation &allocation)
+    {
+        uint32_t poolKey = memoryTypeIndex * 2 + (linear ? 1 : 0);
+
+        auto it = m_rings.find(poolKey);
+        if (it == m_rings.end())
+        {
+            Block block;
+            block.kind = BlockKind::Ring;
+            block.pool = AllocationUsage::Transient;
+            block.poolKey = poolKey;
+            if (!allocateDeviceMemory(memoryTypeIndex, m_ringSize, nullptr, block))
+            {
+                return false;
+            }
+            it = m_rings.emplace(poolKey, addBlock(std::move(block))).first;
+        }
+
+        Block &block = m_blocks.at(it->second);
+        VkDeviceSize offset = 0;
+        if (!ringAlloc(block, size, alignment, offset))
+        {
+            return false;
+        }
+        fillAllocation(it->second, block, offset, size, allocation);
+        return true;
+    }
+
+    bool DeviceAllocator::buddyAlloc(Block &block, uint32_t order, VkDeviceSize &offset)
+    {
+        uint32_t found = order;
+        while (found < block.freeLists.size() && block.freeLists[found].empty())
+        {
+            ++found;
+        }
+        if (found >= block.freeLists.size())
+        {
+            return false;
+        }
+
+        offset = *block.freeLists[found].begin();
+        block.freeLists[found].erase(block.freeLists[found].begin());
+
+        // Split down to the requested order, keeping the upper halves free
+        while (found > order)
+        {
+            --found;
+            block.freeLists[found].insert(offset + (kMinBuddySize << found));
+        }
+
+        block.liveOrders[offset] = order;
+        block.used += kMinBuddySize << order;
+        block.allocationCount++;
+        return true;
+    }
+
+    void DeviceAllocator::buddyFree(Block &block, VkDeviceSize offset)
+    {
+        auto live = block.liveOrders.find(offset);
+        if (live == block.liveOrders.end())
+        {
+            return;
+        }
+
+        uint32_t order = live->second;
+        block.liveOrders.erase(live);
+        block.used -= kMinBuddySize << order;
+        block.allocationCount--;
+
+        // Merge with free buddies as far up as possible
+        while (order + 1 < block.freeLists.size())
+        {
+            VkDeviceSize buddy = offset ^ (kMinBuddySize << order);
+            auto it = block.freeLists[order].find(buddy);
+            if (it == block.freeLists[order].end())
+            {
+                break;
+            }
+            block.freeLists[order].erase(it);
+            offset = std::min(offset, buddy);
+            ++order;
+        }
+        block.freeLists[order].insert(offset);
+    }
+
+    bool DeviceAllocator::ringAlloc(Block &block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset)
+    {
+        auto &entries = block.ringEntries;
+        if (entries.empty())
+        {
+            offset = 0;
+        }
+        else
+        {
+            VkDeviceSize head = entries.back().offset + entries.back().size;
+            VkDeviceSize tail = entries.front().offset;
+            bool wrapped = entries.back().offset < tail;
+
+            offset = alignUp(head, alignment);
+            if (wrapped)
+            {
+                // Free space lies between the newest and the oldest allocation
+                if (offset + size > tail)
+                    return false;
+            }
+            else if (offset + size > block.size)
+            {
+                // Wrap to the start if the oldest allocation leaves room there
+                if (size > tail)
+                    return false;
+                offset = 0;
+            }
+        }
+
+        if (offset + size > block.size)
+        {
+            return false;
+        }
+
+        entries.push_back({offset, size, false});
+        block.used += size;
+        block.allocationCount++;
+        return true;
+    }
+
+    void DeviceAllocator::ringFree(Block &block, VkDeviceSize offset)
+    {
+        auto &entries = block.ringEntries;
+        for (auto &entry : entries)
+        {
+            if (entry.offset == offset && !entry.freed)
+            {
+                entry.freed = true;
+                block.used -= entry.size;
+                block.allocationCount--;
+                break;
+            }
+        }
+
+        // Space is reclaimed from the oldest end only
+        while (!entries.empty() && entries.front().freed)
+        {
+            entries.pop_front();
+        }
+    }
+
+    void DeviceAllocator::fillAllocation(uint32_t blockId, const Block &block, VkDeviceSize offset, VkDeviceSize size,
+                                         Allocation &allocation) const
+    {
+        allocation.memory = block.memory;
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.mapped = block.mapped ? static_cast<char *>(block.mapped) + offset : nullptr;
+        allocation.blockId = blockId;
+    }
+
+} // namespace vst::memory
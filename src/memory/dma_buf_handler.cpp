@@ -0,0 +1,114 @@
+#include "memory/dma_buf_handler.hpp"
+#include "utils/logger.hpp"
+
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace vst::memory
+{
+
+    // Retries ioctls interrupted by signals, which DMA_BUF_IOCTL_SYNC may be while waiting on fences
+    static int ioctlRetry(int fd, unsigned long request, void *arg)
+    {
+        int ret;
+        do
+        {
+            ret = ioctl(fd, request, arg);
+        } while (ret == -1 && (errno == EINTR || errno == EAGAIN));
+        return ret;
+    }
+
+    static bool syncCpuAccess(const DmaBuffer &buffer, uint64_t flags)
+    {
+        if (buffer.fd < 0)
+        {
+            return false;
+        }
+
+        struct dma_buf_sync sync{};
+        sync.flags = flags;
+        if (ioctlRetry(buffer.fd, DMA_BUF_IOCTL_SYNC, &sync) == -1)
+        {
+            LOG_ERR("DMA_BUF_IOCTL_SYNC failed: " << strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    bool DmaBufHandler::isHeapAvailable(const std::string &heapPath)
+    {
+        return access(heapPath.c_str(), R_OK) == 0;
+    }
+
+    bool DmaBufHandler::allocate(size_t size, DmaBuffer &buffer, const std::string &heapPath)
+    {
+        int heapFd = open(heapPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (heapFd == -1)
+        {
+            LOG_ERR("Failed to open DMA-BUF heap " << heapPath << ": " << strerror(errno));
+            return false;
+        }
+
+        struct dma_heap_allocation_data allocation{};
+        allocation.len = size;
+        allocation.fd_flags = O_RDWR | O_CLOEXEC;
+        int ret = ioctlRetry(heapFd, DMA_HEAP_IOCTL_ALLOC, &allocation);
+        close(heapFd);
+
+        if (ret == -1)
+        {
+            LOG_ERR("Failed to allocate " << size << " bytes from " << heapPath << ": " << strerror(errno));
+            return false;
+        }
+
+        return import(static_cast<int>(allocation.fd), size, true, buffer);
+    }
+
+    bool DmaBufHandler::import(int fd, size_t size, bool writable, DmaBuffer &buffer)
+    {
+        int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        void *data = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            LOG_ERR("Failed to map DMA-BUF (" << size << " bytes): " << strerror(errno));
+            close(fd);
+            return false;
+        }
+
+        buffer.fd = fd;
+        buffer.data = data;
+        buffer.size = size;
+        buffer.writable = writable;
+        return true;
+    }
+
+    bool DmaBufHandler::beginCpuAccess(const DmaBuffer &buffer, bool write)
+    {
+        return syncCpuAccess(buffer, DMA_BUF_SYNC_START | (write ? DMA_BUF_SYNC_WRITE : DMA_BUF_SYNC_READ));
+    }
+
+    bool DmaBufHandler::endCpuAccess(const DmaBuffer &buffer, bool write)
+    {
+        return syncCpuAccess(buffer, DMA_BUF_SYNC_END | (write ? DMA_BUF_SYNC_WRITE : DMA_BUF_SYNC_READ));
+    }
+
+    void DmaBufHandler::release(DmaBuffer &buffer)
+    {
+        if (buffer.data)
+        {
+            munmap(buffer.data, buffer.size);
+        }
+        if (buffer.fd >= 0)
+        {
+            close(buffer.fd);
+        }
+        buffer = DmaBuffer{};
+    }
+
+} // namespace vst::memory
@@ -53,36 +53,63 @@ namespace vst
         VkImage srcImage,
         uint32_t width,
         uint32_t height)
+    {
+        vulkan_utils::SubmitQueue queue{graphicsQueue, VK_QUEUE_FAMILY_IGNORED, commandPool};
+        return downloadImageToCpu(device, physicalDevice, queue, queue, srcImage, width, height);
+    }
+
+    CpuTextureData TextureDownloader::downloadImageToCpu(
+        VkDevice device,
+        VkPhysicalDevice physicalDevice,
+        const vulkan_utils::SubmitQueue &graphics,
+        const vulkan_utils::SubmitQueue &transfer,
+        VkImage srcImage,
+        uint32_t width,
+        uint32_t height,
+        memory::DeviceAllocator *allocator)
     {
         VkDeviceSize imageSize = width * height * 4;
 
         // Create buffer
         VkBuffer buffer;
-        VkDeviceMemory bufferMemory;
+        VkDeviceMemory bufferMemory = VK_NULL_HANDLE;
+        memory::Allocation allocation;
 
-        VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
-        bufferInfo.size = imageSize;
-        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (allocator)
+        {
+            vulkan_utils::createBuffer(*allocator, imageSize, buffer, allocation,
+                                       VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                       memory::AllocationUsage::Transient);
+            bufferMemory = allocation.memory;
+        }
+        else
+        {
+            VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+            bufferInfo.size = imageSize;
+            bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
-            throw std::runtime_error("Failed to create buffer for image download.");
+            if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create buffer for image download.");
 
-        VkMemoryRequirements memReq;
-        vkGetBufferMemoryRequirements(device, buffer, &memReq);
+            VkMemoryRequirements memReq;
+            vkGetBufferMemoryRequirements(device, buffer, &memReq);
 
-        VkMemoryAllocateInfo allocInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-        allocInfo.allocationSize = memReq.size;
-        allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memReq.memoryTypeBits,
-                                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            VkMemoryAllocateInfo allocInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+            allocInfo.allocationSize = memReq.size;
+            allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memReq.memoryTypeBits,
+                                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-            throw std::runtime_error("Failed to allocate memory for image download.");
+            if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+                throw std::runtime_error("Failed to allocate memory for image download.");
 
-        vkBindBufferMemory(device, buffer, bufferMemory, 0);
+            vkBindBufferMemory(device, buffer, bufferMemory, 0);
+        }
 
         // Copy image to buffer
-        VkCommandBuffer cmd = beginSingleCommandBuffer(device, commandPool);
+        const VkImageLayout layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        bool handOver = transfer.family != graphics.family;
 
         VkBufferImageCopy region{};
         region.bufferOffset = 0;
@@ -92,15 +119,105 @@ namespace vst
         region.imageSubresource.layerCount = 1;
         region.imageExtent = {width, height, 1};
 
-        vkCmdCopyImageToBuffer(cmd, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
-
-        endSingleCommandBuffer(device, commandPool, graphicsQueue, cmd);
+        if (!handOver)
+        {
+            VkCommandBuffer cmd = beginSingleCommandBuffer(device, transfer.commandPool);
+            vkCmdCopyImageToBuffer(cmd, srcImage, layout, buffer, 1, &region);
+            endSingleCommandBuffer(device, transfer.commandPool, transfer.queue, cmd);
+        }
+        else
+        {
+            // graphics releases -> transfer acquires, copies, releases -> graphics acquires
+            VkCommandBuffer lend = beginSingleCommandBuffer(device, graphics.commandPool);
+            vulkan_utils::recordOwnershipBarrier(lend, srcImage, graphics.family, transfer.family, layout, layout,
+                                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_WRITE_BIT, true);
+            vkEndCommandBuffer(lend);
+
+            VkCommandBuffer copy = beginSingleCommandBuffer(device, transfer.commandPool);
+            vulkan_utils::recordOwnershipBarrier(copy, srcImage, graphics.family, transfer.family, layout, layout,
+                                                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, false);
+            vkCmdCopyImageToBuffer(copy, srcImage, layout, buffer, 1, &region);
+            vulkan_utils::recordOwnershipBarrier(copy, srcImage, transfer.family, graphics.family, layout, layout,
+                                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, true);
+            vkEndCommandBuffer(copy);
+
+            VkCommandBuffer giveBack = beginSingleCommandBuffer(device, graphics.commandPool);
+            vulkan_utils::recordOwnershipBarrier(giveBack, srcImage, transfer.family, graphics.family, layout, layout,
+                                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT, false);
+            vkEndCommandBuffer(giveBack);
+
+            VkSemaphoreCreateInfo semInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+            VkSemaphore lent, copied;
+            vkCreateSemaphore(device, &semInfo, nullptr, &lent);
+            vkCreateSemaphore(device, &semInfo, nullptr, &copied);
+            VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+            VkFence done;
+            vkCreateFence(device, &fenceInfo, nullptr, &done);
+
+            VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            VkSubmitInfo submits[3] = {{VK_STRUCTURE_TYPE_SUBMIT_INFO}, {VK_STRUCTURE_TYPE_SUBMIT_INFO}, {VK_STRUCTURE_TYPE_SUBMIT_INFO}};
+            submits[0].commandBufferCount = 1;
+            submits[0].pCommandBuffers = &lend;
+            submits[0].signalSemaphoreCount = 1;
+            submits[0].pSignalSemaphores = &lent;
+
+            submits[1].waitSemaphoreCount = 1;
+            submits[1].pWaitSemaphores = &lent;
+            submits[1].pWaitDstStageMask = &waitStage;
+            submits[1].commandBufferCount = 1;
+            submits[1].pCommandBuffers = &copy;
+            submits[1].signalSemaphoreCount = 1;
+            submits[1].pSignalSemaphores = &copied;
+
+            submits[2].waitSemaphoreCount = 1;
+            submits[2].pWaitSemaphores = &copied;
+            submits[2].pWaitDstStageMask = &waitStage;
+            submits[2].commandBufferCount = 1;
+            submits[2].pCommandBuffers = &giveBack;
+
+            vkQueueSubmit(graphics.queue, 1, &submits[0], VK_NULL_HANDLE);
+            vkQueueSubmit(transfer.queue, 1, &submits[1], VK_NULL_HANDLE);
+            vkQueueSubmit(graphics.queue, 1, &submits[2], done);
+
+            // Only this readback is waited for, not everything else queued on graphics
+            vkWaitForFences(device, 1, &done, VK_TRUE, UINT64_MAX);
+
+            vkDestroyFence(device, done, nullptr);
+            vkDestroySemaphore(device, lent, nullptr);
+            vkDestroySemaphore(device, copied, nullptr);
+            vkFreeCommandBuffers(device, graphics.commandPool, 1, &lend);
+            vkFreeCommandBuffers(device, transfer.commandPool, 1, &copy);
+            vkFreeCommandBuffers(device, graphics.commandPool, 1, &giveBack);
+        }
 
-        void *mapped;
-        vkMapMemory(device, bufferMemory, 0, imageSize, 0, &mapped);
+        // Allocator blocks are already mapped
+        void *mapped = allocation.mapped;
+        if (!allocator)
+            vkMapMemory(device, bufferMemory, 0, imageSize, 0, &mapped);
 
         return CpuTextureData{
-            mapped, bufferMemory, buffer, imageSize};
+            mapped, bufferMemory, buffer, imageSize, allocation};
+    }
+
+    void TextureDownloader::release(VkDevice device, CpuTextureData &data, memory::DeviceAllocator *allocator)
+    {
+        if (data.allocation.isValid())
+        {
+            // Part of a shared block; only the allocator it came from may free it
+            if (allocator)
+                vulkan_utils::destroyBuffer(*allocator, data.buffer, data.allocation);
+        }
+        else
+        {
+            if (data.memory != VK_NULL_HANDLE)
+            {
+                vkUnmapMemory(device, data.memory);
+                vkFreeMemory(device, data.memory, nullptr);
+            }
+            if (data.buffer != VK_NULL_HANDLE)
+                vkDestroyBuffer(device, data.buffer, nullptr);
+        }
+        data = CpuTextureData{};
     }
 
 } // namespace vst
@@ -1,414 +1,1879 @@
 #include "memory/shm_video_handler.hpp"
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <unistd.h>
+#include <cerrno>
+#include <climits>
 #include <cstring>
+#include <algorithm>
+#include <new>
 #include <iostream>
 #include <chrono>
 #include <thread>
 #include <opencv2/imgproc.hpp>
 #include "utils/logger.hpp"
+#include "tools/benchmark.hpp"
 
 namespace vst
 {
     namespace memory
     {
+        // The segment is shared between processes, so the non-private futex ops are used
+        static int futexWait(std::atomic<uint32_t> *word, uint32_t expected, const struct timespec *timeout)
+        {
+            return static_cast<int>(syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT, expected, timeout, nullptr, 0));
+        }
+
+        static int futexWakeAll(std::atomic<uint32_t> *word)
+        {
+            return static_cast<int>(syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0));
+        }
+
+        // Bumps the reader futex word and wakes the producer if it is waiting on slow readers
+        static void wakeProducer(ShmVideoSegmentHeader *segment)
+        {
+            segment->readerFutex.fetch_add(1, std::memory_order_seq_cst);
+            if (segment->producerWaiters.load(std::memory_order_seq_cst) > 0)
+            {
+                futexWakeAll(&segment->readerFutex);
+            }
+        }
+
+        static const char *backingName(ShmVideoBacking backing)
+        {
+            switch (backing)
+            {
+            case ShmVideoBacking::None:
+                return "none";
+            case ShmVideoBacking::PosixShm:
+                return "shm_open";
+            case ShmVideoBacking::HugeTlbFs:
+                return "hugetlbfs";
+            case ShmVideoBacking::Memfd:
+                return "memfd";
+            }
+            return "unknown";
+        }
+
+        static std::string hugeTlbPath(const std::string &name)
+        {
+            return std::string(kHugeTlbMountPoint) + "/" + name;
+        }
+
+        static const char *policyName(BackpressurePolicy policy)
+        {
+            switch (policy)
+            {
+            case BackpressurePolicy::LatestOnly:
+                return "latest-only";
+            case BackpressurePolicy::DropOldest:
+                return "drop-oldest";
+            case BackpressurePolicy::BlockProducer:
+                return "block-producer";
+            }
+            return "unknown";
+        }
+
+        static ShmPixelFormat pixelFormatForChannels(uint32_t channels)
+        {
+            switch (channels)
+            {
+            case 1:
+                return ShmPixelFormat::Gray8;
+            case 3:
+                return ShmPixelFormat::RGB8;
+            case 4:
+                return ShmPixelFormat::RGBA8;
+            default:
+                return ShmPixelFormat::Unknown;
+            }
+        }
+
+        static bool isPlanarFormat(ShmPixelFormat pixelFormat)
+        {
+            return pixelFormat == ShmPixelFormat::NV12 || pixelFormat == ShmPixelFormat::I420;
+        }
+
+        // Bytes per pixel of the first plane, 0 for an unknown format
+        static uint32_t channelsForFormat(ShmPixelFormat pixelFormat)
+        {
+            switch (pixelFormat)
+            {
+            case ShmPixelFormat::Gray8:
+            case ShmPixelFormat::NV12:
+            case ShmPixelFormat::I420:
+                return 1;
+            case ShmPixelFormat::RGB8:
+            case ShmPixelFormat::BGR8:
+                return 3;
+            case ShmPixelFormat::RGBA8:
+                return 4;
+            default:
+                return 0;
+            }
+        }
+
+        static const char *pixelFormatName(ShmPixelFormat pixelFormat)
+        {
+            switch (pixelFormat)
+            {
+            case ShmPixelFormat::Gray8:
+                return "gray8";
+            case ShmPixelFormat::RGB8:
+                return "rgb8";
+            case ShmPixelFormat::RGBA8:
+                return "rgba8";
+            case ShmPixelFormat::BGR8:
+                return "bgr8";
+            case ShmPixelFormat::NV12:
+                return "nv12";
+            case ShmPixelFormat::I420:
+                return "i420";
+            default:
+                return "unknown";
+            }
+        }
+
+        // Rows of the single matrix that views a whole frame (planar YUV stacks chroma under luma)
+        static int frameRowsForFormat(ShmPixelFormat pixelFormat, uint32_t height)
+        {
+            return static_cast<int>(isPlanarFormat(pixelFormat) ? height * 3 / 2 : height);
+        }
+
+        static uint64_t alignUp(uint64_t value, uint64_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // OpenCV matrix type for the given number of 8-bit channels, or -1 if unsupported
+        static int matTypeForChannels(uint32_t channels)
+        {
+            switch (channels)
+            {
+            case 1:
+                return CV_8UC1;
+            case 3:
+                return CV_8UC3;
+            case 4:
+                return CV_8UC4;
+            default:
+                LOG_ERR("Unsupported number of channels: " + std::to_string(channels));
+                return -1;
+            }
+        }
+
+        // OpenCV matrix type of the single matrix that views a whole frame, or -1 if unsupported
+        static int matTypeForFormat(ShmPixelFormat pixelFormat)
+        {
+            if (isPlanarFormat(pixelFormat))
+            {
+                return CV_8UC1;
+            }
+            return matTypeForChannels(channelsForFormat(pixelFormat));
+        }
+
+        ShmVideoFrameLease::ShmVideoFrameLease()
+            : m_segment(nullptr),
+              m_slot(nullptr),
+              m_reader(nullptr),
+              m_slotIndex(0),
+              m_frameIndex(0),
+              m_totalFrames(0),
+              m_fps(0.0),
+              m_timestamp(0),
+              m_frameSeq(0),
+              m_decodeTimeNs(0),
+              m_publishTimeNs(0)
+        {
+        }
+
+        ShmVideoFrameLease::~ShmVideoFrameLease()
+        {
+            release();
+        }
+
+        ShmVideoFrameLease::ShmVideoFrameLease(ShmVideoFrameLease &&other) noexcept
+            : ShmVideoFrameLease()
+        {
+            *this = std::move(other);
+        }
+
+        ShmVideoFrameLease &ShmVideoFrameLease::operator=(ShmVideoFrameLease &&other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                m_segment = other.m_segment;
+                m_slot = other.m_slot;
+                m_reader = other.m_reader;
+                m_slotIndex = other.m_slotIndex;
+                m_frame = other.m_frame;
+                m_frameIndex = other.m_frameIndex;
+                m_totalFrames = other.m_totalFrames;
+                m_fps = other.m_fps;
+                m_timestamp = other.m_timestamp;
+                m_frameSeq = other.m_frameSeq;
+                m_decodeTimeNs = other.m_decodeTimeNs;
+                m_publishTimeNs = other.m_publishTimeNs;
+                other.m_segment = nullptr;
+                other.m_slot = nullptr;
+                other.m_reader = nullptr;
+                other.m_frame = cv::Mat();
+            }
+            return *this;
+        }
+
+        ShmPixelFormat ShmVideoFrameLease::pixelFormat() const
+        {
+            return m_segment ? static_cast<ShmPixelFormat>(m_segment->pixelFormat) : ShmPixelFormat::Unknown;
+        }
+
+        uint32_t ShmVideoFrameLease::planeCount() const
+        {
+            return m_segment ? m_segment->planeCount : 0;
+        }
+
+        const uint8_t *ShmVideoFrameLease::planeData(uint32_t plane) const
+        {
+            if (!m_slot || plane >= m_segment->planeCount)
+            {
+                return nullptr;
+            }
+            return m_frame.data + m_segment->planeOffsets[plane];
+        }
+
+        size_t ShmVideoFrameLease::planeStride(uint32_t plane) const
+        {
+            if (!m_slot || plane >= m_segment->planeCount)
+            {
+                return 0;
+            }
+            return m_segment->planeStrides[plane];
+        }
+
+        const uint64_t *ShmVideoFrameLease::dirtyTileMask() const
+        {
+            return m_slot ? m_slot->dirtyTiles : nullptr;
+        }
+
+        bool ShmVideoFrameLease::isTileDirty(uint32_t tileX, uint32_t tileY) const
+        {
+            if (!m_slot || tileX >= m_segment->tilesX || tileY >= m_segment->tilesY)
+            {
+                return false;
+            }
+            uint32_t tile = tileY * m_segment->tilesX + tileX;
+            return (m_slot->dirtyTiles[tile / 64] >> (tile % 64)) & 1;
+        }
+
+        uint32_t ShmVideoFrameLease::tileSize() const
+        {
+            return m_segment ? m_segment->tileSize : 0;
+        }
+
+        uint32_t ShmVideoFrameLease::tilesX() const
+        {
+            return m_segment ? m_segment->tilesX : 0;
+        }
+
+        uint32_t ShmVideoFrameLease::tilesY() const
+        {
+            return m_segment ? m_segment->tilesY : 0;
+        }
+
+        void ShmVideoFrameLease::release()
+        {
+            if (m_slot)
+            {
+                // Drop the record first: dying in between leaks the pin rather than releasing it twice
+                if (m_reader)
+                {
+                    m_reader->pins[m_slotIndex].fetch_sub(1, std::memory_order_seq_cst);
+                }
+                m_slot->pinCount.fetch_sub(1, std::memory_order_seq_cst);
+                wakeProducer(m_segment);
+                m_slot = nullptr;
+                m_reader = nullptr;
+                m_segment = nullptr;
+            }
+            m_frame = cv::Mat();
+        }
 
         ShmVideoHandler::ShmVideoHandler()
             : m_shmFd(-1),
               m_shmSize(0),
               m_shmPtr(nullptr),
+              m_backing(ShmVideoBacking::None),
               m_header(nullptr),
               m_frameData(nullptr),
+              m_lastReadSeq(0),
+              m_readerIndex(-1),
+              m_writeSlot(-1),
+              m_writeSequence(0),
               m_isOpen(false)
         {
         }
 
-        ShmVideoHandler::~ShmVideoHandler()
+        ShmVideoHandler::~ShmVideoHandler()
+        {
+            closeSharedMemory();
+        }
+
+        bool ShmVideoHandler::createSharedMemory(const std::string &name, uint32_t width, uint32_t height, uint32_t channels,
+                                                 uint32_t slotCount, BackpressurePolicy policy,
+                                                 const ShmVideoOptions &options)
+        {
+            ShmPixelFormat pixelFormat = pixelFormatForChannels(channels);
+            if (pixelFormat == ShmPixelFormat::Unknown)
+            {
+                LOG_ERR("Unsupported number of channels: " + std::to_string(channels));
+                return false;
+            }
+
+            return createSharedMemory(name, width, height, pixelFormat, slotCount, policy, options);
+        }
+
+        bool ShmVideoHandler::createSharedMemory(const std::string &name, uint32_t width, uint32_t height,
+                                                 ShmPixelFormat pixelFormat, uint32_t slotCount,
+                                                 BackpressurePolicy policy, const ShmVideoOptions &options)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (slotCount < 2 || slotCount > kMaxSlotCount)
+            {
+                LOG_ERR("Shared video ring needs between 2 and " + std::to_string(kMaxSlotCount) +
+                        " slots, got " + std::to_string(slotCount));
+                return false;
+            }
+
+            uint32_t channels = channelsForFormat(pixelFormat);
+            if (channels == 0)
+            {
+                LOG_ERR("Unsupported pixel format: " + std::to_string(static_cast<uint32_t>(pixelFormat)));
+                return false;
+            }
+
+            if (isPlanarFormat(pixelFormat) && ((width | height) & 1))
+            {
+                LOG_ERR(std::string("Frames in ") + pixelFormatName(pixelFormat) + " need an even width and height");
+                return false;
+            }
+
+            // Close any existing shared memory
+            closeSegment();
+
+            // Store the name (remove leading '/' if present)
+            m_shmName = name;
+            if (!m_shmName.empty() && m_shmName[0] == '/')
+            {
+                m_shmName = m_shmName.substr(1);
+            }
+
+            // Calculate the size needed
+            ShmVideoLayout layout = computeLayout(width, height, pixelFormat, slotCount);
+            size_t size = layout.totalSize;
+
+            // A memfd has no name to fall back to; otherwise prefer huge pages when asked,
+            // and use shm_open without them (or if they are unavailable)
+            if (options.memfd)
+            {
+                if (!createMemfdSegment(size, options))
+                {
+                    return false;
+                }
+            }
+            else if (!options.hugePages || !createHugeTlbSegment(size, options))
+            {
+                m_shmSize = size;
+
+                // Create the shared memory object
+                m_shmFd = shm_open(("/" + m_shmName).c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+                if (m_shmFd == -1)
+                {
+                    LOG_ERR("Failed to create shared memory object: " + std::string(strerror(errno)));
+                    return false;
+                }
+
+                // Set the size of the shared memory object
+                if (ftruncate(m_shmFd, m_shmSize) == -1)
+                {
+                    LOG_ERR("Failed to set size of shared memory: " + std::string(strerror(errno)));
+                    close(m_shmFd);
+                    m_shmFd = -1;
+                    return false;
+                }
+
+                // Map the shared memory object
+                m_backing = ShmVideoBacking::PosixShm;
+                if (!mapSegment(options))
+                {
+                    LOG_ERR("Failed to map shared memory: " + std::string(strerror(errno)));
+                    close(m_shmFd);
+                    m_shmFd = -1;
+                    m_backing = ShmVideoBacking::None;
+                    return false;
+                }
+            }
+
+            // Set up the header and frame data pointers
+            m_header = new (m_shmPtr) ShmVideoSegmentHeader();
+            m_frameData = static_cast<uint8_t *>(m_shmPtr) + layout.frameDataOffset;
+
+            // Initialize the header; magic is written last so a reader never
+            // accepts a half-initialised segment
+            m_header->abiVersion = kShmVideoAbiVersion;
+            m_header->width = width;
+            m_header->height = height;
+            m_header->channels = channels;
+            m_header->pixelFormat = static_cast<uint32_t>(pixelFormat);
+            m_header->rowStride = layout.rowStride;
+            m_header->slotCount = slotCount;
+            m_header->slotHeaderOffset = layout.slotHeaderOffset;
+            m_header->frameDataOffset = layout.frameDataOffset;
+            m_header->slotStride = layout.slotStride;
+            m_header->planeCount = layout.planeCount;
+            for (uint32_t plane = 0; plane < kMaxPlanes; ++plane)
+            {
+                m_header->planeStrides[plane] = layout.planeStrides[plane];
+                m_header->planeOffsets[plane] = layout.planeOffsets[plane];
+            }
+            m_header->publishedSeq.store(0, std::memory_order_relaxed);
+            m_header->latestSlot.store(0, std::memory_order_relaxed);
+            m_header->isEndOfVideo.store(0, std::memory_order_relaxed);
+            m_header->frameFutex.store(0, std::memory_order_relaxed);
+            m_header->waiters.store(0, std::memory_order_relaxed);
+            m_header->policy = static_cast<uint32_t>(policy);
+
+            // Grow the tiles until the bitmap fits in the slot header
+            uint32_t tileSize = kMinTileSize;
+            while (static_cast<uint64_t>((width + tileSize - 1) / tileSize) * ((height + tileSize - 1) / tileSize) > kMaxDirtyTiles)
+            {
+                tileSize *= 2;
+            }
+            m_header->tileSize = tileSize;
+            m_header->tilesX = (width + tileSize - 1) / tileSize;
+            m_header->tilesY = (height + tileSize - 1) / tileSize;
+            m_header->readerFutex.store(0, std::memory_order_relaxed);
+            m_header->producerWaiters.store(0, std::memory_order_relaxed);
+            for (uint32_t i = 0; i < kMaxReaders; ++i)
+            {
+                m_header->readers[i].pid.store(0, std::memory_order_relaxed);
+                m_header->readers[i].cursor.store(0, std::memory_order_relaxed);
+                for (uint32_t slot = 0; slot < kMaxSlotCount; ++slot)
+                {
+                    m_header->readers[i].pins[slot].store(0, std::memory_order_relaxed);
+                }
+            }
+
+            // Initialize the slot headers
+            for (uint32_t i = 0; i < slotCount; ++i)
+            {
+                ShmVideoSlotHeader *slot = new (slotHeader(i)) ShmVideoSlotHeader();
+                slot->sequence.store(0, std::memory_order_relaxed);
+                slot->frameSeq.store(0, std::memory_order_relaxed);
+                slot->pinCount.store(0, std::memory_order_relaxed);
+                slot->frameIndex = 0;
+                slot->totalFrames = 0;
+                slot->fps = 0.0;
+                slot->timestamp = 0;
+                slot->decodeTimeNs = 0;
+                slot->publishTimeNs = 0;
+                std::memset(slot->dirtyTiles, 0xFF, sizeof(slot->dirtyTiles));
+            }
+
+            // Every slot starts empty, so every tile is stale
+            m_staleTiles.assign(static_cast<size_t>(slotCount) * kDirtyMaskWords, ~0ull);
+            std::atomic_thread_fence(std::memory_order_release);
+            m_header->magic = kShmVideoMagic;
+
+            m_lastReadSeq = 0;
+            m_isOpen = true;
+
+            LOG_INFO("Created shared memory for video: " + m_shmName +
+                     " (size: " + std::to_string(m_shmSize) + " bytes, dimensions: " +
+                     std::to_string(width) + "x" + std::to_string(height) + " " + pixelFormatName(pixelFormat) +
+                     ", slots: " + std::to_string(slotCount) + ", policy: " + policyName(policy) +
+                     ", backing: " + backingName(m_backing) + ")");
+
+            return true;
+        }
+
+        bool ShmVideoHandler::openSharedMemory(const std::string &name, const ShmVideoOptions &options)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // Close any existing shared memory
+            closeSegment();
+
+            // Store the name (remove leading '/' if present)
+            m_shmName = name;
+            if (!m_shmName.empty() && m_shmName[0] == '/')
+            {
+                m_shmName = m_shmName.substr(1);
+            }
+
+            // Open the shared memory object, which may live on hugetlbfs instead of /dev/shm
+            m_backing = ShmVideoBacking::PosixShm;
+            m_shmFd = shm_open(("/" + m_shmName).c_str(), O_RDWR, S_IRUSR | S_IWUSR);
+            if (m_shmFd == -1 && errno == ENOENT)
+            {
+                m_backing = ShmVideoBacking::HugeTlbFs;
+                m_shmFd = open(hugeTlbPath(m_shmName).c_str(), O_RDWR);
+            }
+            if (m_shmFd == -1)
+            {
+                LOG_ERR("Failed to open shared memory object: " + std::string(strerror(errno)));
+                m_backing = ShmVideoBacking::None;
+                return false;
+            }
+
+            // Get the size of the shared memory object
+            struct stat sb;
+            if (fstat(m_shmFd, &sb) == -1)
+            {
+                LOG_ERR("Failed to get size of shared memory: " + std::string(strerror(errno)));
+                close(m_shmFd);
+                m_shmFd = -1;
+                m_backing = ShmVideoBacking::None;
+                return false;
+            }
+            m_shmSize = sb.st_size;
+
+            return attachSegment(options);
+        }
+
+        bool ShmVideoHandler::openSharedMemory(int fd, const ShmVideoOptions &options)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // Close any existing shared memory
+            closeSegment();
+            m_shmName = "memfd";
+
+            // Sealed sizes are what lets readers skip revalidating the segment; refuse anything else
+            int seals = fcntl(fd, F_GET_SEALS);
+            if (seals == -1 || (seals & (F_SEAL_SHRINK | F_SEAL_GROW)) != (F_SEAL_SHRINK | F_SEAL_GROW))
+            {
+                LOG_ERR("Shared video fd is not a size-sealed memfd");
+                close(fd);
+                return false;
+            }
+
+            struct stat sb;
+            if (fstat(fd, &sb) == -1)
+            {
+                LOG_ERR("Failed to get size of shared memory: " + std::string(strerror(errno)));
+                close(fd);
+                return false;
+            }
+
+            m_shmFd = fd;
+            m_shmSize = sb.st_size;
+            m_backing = ShmVideoBacking::Memfd;
+            return attachSegment(options);
+        }
+
+        bool ShmVideoHandler::attachSegment(const ShmVideoOptions &options)
+        {
+            // Map the shared memory object
+            if (!mapSegment(options))
+            {
+                LOG_ERR("Failed to map shared memory: " + std::string(strerror(errno)));
+                close(m_shmFd);
+                m_shmFd = -1;
+                m_backing = ShmVideoBacking::None;
+                return false;
+            }
+
+            // Set up the header and frame data pointers
+            m_header = static_cast<ShmVideoSegmentHeader *>(m_shmPtr);
+
+            // Check this is a segment we understand before trusting any of its fields
+            std::string invalidReason;
+            if (m_shmSize < sizeof(ShmVideoSegmentHeader) || m_header->magic != kShmVideoMagic)
+            {
+                invalidReason = "not a VST video segment (or not initialised yet)";
+            }
+            else if (m_header->abiVersion != kShmVideoAbiVersion)
+            {
+                invalidReason = "ABI version " + std::to_string(m_header->abiVersion) + ", expected " +
+                                std::to_string(kShmVideoAbiVersion);
+            }
+            else if (m_header->slotCount < 2 || m_header->slotCount > kMaxSlotCount || m_header->tileSize < kMinTileSize ||
+                     static_cast<uint64_t>(m_header->tilesX) * m_header->tilesY > kMaxDirtyTiles ||
+                     m_header->policy > static_cast<uint32_t>(BackpressurePolicy::BlockProducer) ||
+                     channelsForFormat(static_cast<ShmPixelFormat>(m_header->pixelFormat)) == 0 ||
+                     channelsForFormat(static_cast<ShmPixelFormat>(m_header->pixelFormat)) != m_header->channels)
+            {
+                invalidReason = "invalid stream description";
+            }
+            else
+            {
+                // The layout must match ours exactly and fit in the segment
+                ShmVideoLayout layout = computeLayout(m_header->width, m_header->height,
+                                                      static_cast<ShmPixelFormat>(m_header->pixelFormat), m_header->slotCount);
+                bool planesMatch = layout.planeCount == m_header->planeCount;
+                for (uint32_t plane = 0; plane < kMaxPlanes && planesMatch; ++plane)
+                {
+                    planesMatch = layout.planeStrides[plane] == m_header->planeStrides[plane] &&
+                                  layout.planeOffsets[plane] == m_header->planeOffsets[plane];
+                }
+                if (layout.rowStride != m_header->rowStride || layout.slotHeaderOffset != m_header->slotHeaderOffset ||
+                    layout.frameDataOffset != m_header->frameDataOffset || layout.slotStride != m_header->slotStride ||
+                    !planesMatch)
+                {
+                    invalidReason = "unexpected layout";
+                }
+                else if (m_shmSize < layout.totalSize)
+                {
+                    invalidReason = "segment is too small for its video ring";
+                }
+            }
+
+            if (!invalidReason.empty())
+            {
+                LOG_ERR("Cannot use shared memory segment " + m_shmName + ": " + invalidReason);
+                munmap(m_shmPtr, m_shmSize);
+                m_shmPtr = nullptr;
+                close(m_shmFd);
+                m_shmFd = -1;
+                m_backing = ShmVideoBacking::None;
+                m_header = nullptr;
+                m_frameData = nullptr;
+                return false;
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            m_frameData = static_cast<uint8_t *>(m_shmPtr) + m_header->frameDataOffset;
+            registerReader();
+            m_isOpen = true;
+
+            LOG_INFO("Opened shared memory for video: " + m_shmName +
+                     " (size: " + std::to_string(m_shmSize) + " bytes, dimensions: " +
+                     std::to_string(m_header->width) + "x" + std::to_string(m_header->height) +
+                     " " + pixelFormatName(static_cast<ShmPixelFormat>(m_header->pixelFormat)) +
+                     ", slots: " + std::to_string(m_header->slotCount) +
+                     ", policy: " + policyName(static_cast<BackpressurePolicy>(m_header->policy)) +
+                     ", backing: " + backingName(m_backing) + ")");
+
+            return true;
+        }
+
+        bool ShmVideoHandler::beginWrite(cv::Mat &slotFrame, int timeoutMs)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            if (!m_isOpen || !m_header || !m_frameData)
+            {
+                LOG_ERR("Shared memory is not open");
+                return false;
+            }
+
+            if (m_writeSlot >= 0)
+            {
+                LOG_ERR("beginWrite() called while another write is still open");
+                return false;
+            }
+
+            ShmPixelFormat pixelFormat = static_cast<ShmPixelFormat>(m_header->pixelFormat);
+            int type = matTypeForFormat(pixelFormat);
+            if (type < 0)
+            {
+                return false;
+            }
+
+            // Claim the oldest unpinned slot; its sequence is odd until commit or abort
+            uint64_t sequence = 0;
+            int slot = -1;
+            if (static_cast<BackpressurePolicy>(m_header->policy) != BackpressurePolicy::BlockProducer)
+            {
+                slot = openWriteSlot(sequence, UINT64_MAX);
+                if (slot < 0)
+                {
+                    // Leases of a reader that died holding them are only dropped by reaping it
+                    reapDeadReaders();
+                    slot = openWriteSlot(sequence, UINT64_MAX);
+                }
+                if (slot < 0)
+                {
+                    LOG_WARN("Every free slot is leased by a reader, no slot to write");
+                    return false;
+                }
+            }
+            else
+            {
+                // Only reuse slots every registered reader has consumed. The waiter
+                // count is raised before sampling the futex word so a reader that
+                // advances after our scan either sees it or changes the word.
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+                ShmVideoSegmentHeader *segment = m_header;
+                segment->producerWaiters.fetch_add(1, std::memory_order_seq_cst);
+                bool reaped = false;
+                while (true)
+                {
+                    uint32_t futexValue = m_header->readerFutex.load(std::memory_order_seq_cst);
+                    slot = openWriteSlot(sequence, minReaderCursor());
+                    if (slot >= 0)
+                    {
+                        break;
+                    }
+
+                    if (!reaped)
+                    {
+                        // A reader that died without closing would stall us forever
+                        reapDeadReaders();
+                        reaped = true;
+                        continue;
+                    }
+
+                    auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        deadline - std::chrono::steady_clock::now());
+                    if (remaining.count() <= 0)
+                    {
+                        break;
+                    }
+
+                    struct timespec timeout;
+                    timeout.tv_sec = static_cast<time_t>(remaining.count() / 1000000000LL);
+                    timeout.tv_nsec = static_cast<long>(remaining.count() % 1000000000LL);
+
+                    // Let other threads use the handler while we sleep, then make sure
+                    // the segment and the write state survived the wait
+                    lock.unlock();
+                    futexWait(&segment->readerFutex, futexValue, &timeout);
+                    lock.lock();
+
+                    if (!m_isOpen || m_header != segment)
+                    {
+                        LOG_ERR("Shared memory was closed while waiting for a slot");
+                        return false;
+                    }
+                    if (m_writeSlot >= 0)
+                    {
+                        segment->producerWaiters.fetch_sub(1, std::memory_order_seq_cst);
+                        LOG_ERR("beginWrite() called while another write is still open");
+                        return false;
+                    }
+                }
+                segment->producerWaiters.fetch_sub(1, std::memory_order_seq_cst);
+
+                if (slot < 0)
+                {
+                    LOG_WARN("Readers did not catch up within " + std::to_string(timeoutMs) + " ms, no slot to write");
+                    return false;
+                }
+            }
+
+            m_writeSlot = slot;
+            m_writeSequence = sequence;
+            slotFrame = cv::Mat(frameRowsForFormat(pixelFormat, m_header->height), static_cast<int>(m_header->width), type,
+                                slotPixels(slot), m_header->rowStride);
+            return true;
+        }
+
+        bool ShmVideoHandler::commitWrite(uint32_t frameIndex, uint32_t totalFrames, double fps, uint64_t timestamp,
+                                          uint64_t decodeTimeNs)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (!m_isOpen || !m_header || !m_frameData)
+            {
+                LOG_ERR("Shared memory is not open");
+                return false;
+            }
+
+            if (m_writeSlot < 0)
+            {
+                LOG_ERR("commitWrite() called without beginWrite()");
+                return false;
+            }
+
+            // The caller may have touched any pixel, so every tile is dirty
+            return publishWriteSlot(frameIndex, totalFrames, fps, timestamp, decodeTimeNs, nullptr);
+        }
+
+        bool ShmVideoHandler::publishWriteSlot(uint32_t frameIndex, uint32_t totalFrames, double fps, uint64_t timestamp,
+                                               uint64_t decodeTimeNs, const uint64_t *dirtyMask)
+        {
+            // Update the slot metadata
+            ShmVideoSlotHeader *header = slotHeader(m_writeSlot);
+            uint64_t frameSeq = m_header->publishedSeq.load(std::memory_order_relaxed) + 1;
+            header->frameSeq.store(frameSeq, std::memory_order_relaxed);
+            header->frameIndex = frameIndex;
+            header->totalFrames = totalFrames;
+            header->fps = fps;
+            header->timestamp = timestamp;
+            if (dirtyMask)
+            {
+                std::memcpy(header->dirtyTiles, dirtyMask, sizeof(header->dirtyTiles));
+            }
+            else
+            {
+                std::memset(header->dirtyTiles, 0xFF, sizeof(header->dirtyTiles));
+            }
+
+            // The written slot is now current; every other slot misses this frame's changes
+            for (uint32_t slot = 0; slot < m_header->slotCount; ++slot)
+            {
+                uint64_t *stale = &m_staleTiles[static_cast<size_t>(slot) * kDirtyMaskWords];
+                for (uint32_t word = 0; word < kDirtyMaskWords; ++word)
+                {
+                    if (slot == static_cast<uint32_t>(m_writeSlot))
+                    {
+                        stale[word] = 0;
+                    }
+                    else
+                    {
+                        stale[word] |= dirtyMask ? dirtyMask[word] : ~0ull;
+                    }
+                }
+            }
+
+            // Stamp last so the publish time covers the whole copy into the slot
+            header->publishTimeNs = monotonicNowNs();
+            header->decodeTimeNs = decodeTimeNs ? decodeTimeNs : header->publishTimeNs;
+
+            // Close the slot, then publish it as the latest frame
+            header->sequence.store(m_writeSequence + 2, std::memory_order_release);
+            m_header->latestSlot.store(static_cast<uint32_t>(m_writeSlot), std::memory_order_release);
+            m_header->publishedSeq.store(frameSeq, std::memory_order_release);
+            m_writeSlot = -1;
+            wakeReaders();
+
+            return true;
+        }
+
+        void ShmVideoHandler::abortWrite()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (m_writeSlot < 0 || !m_header)
+            {
+                return;
+            }
+
+            // The slot may hold a partial frame, so mark it empty rather than restoring it
+            ShmVideoSlotHeader *header = slotHeader(m_writeSlot);
+            if (!m_staleTiles.empty())
+            {
+                std::fill_n(&m_staleTiles[static_cast<size_t>(m_writeSlot) * kDirtyMaskWords], kDirtyMaskWords, ~0ull);
+            }
+            header->frameSeq.store(0, std::memory_order_relaxed);
+            header->sequence.store(m_writeSequence + 2, std::memory_order_release);
+            m_writeSlot = -1;
+        }
+
+        bool ShmVideoHandler::writeFrame(const cv::Mat &frame, uint32_t frameIndex, uint32_t totalFrames, double fps, uint64_t timestamp,
+                                         uint64_t decodeTimeNs)
+        {
+            if (!m_isOpen || !m_header || !m_frameData)
+            {
+                LOG_ERR("Shared memory is not open");
+                return false;
+            }
+
+            // Check if the frame dimensions match the shared memory
+            if (frame.cols != static_cast<int>(m_header->width) ||
+                frame.rows != static_cast<int>(m_header->height))
+            {
+                LOG_ERR("Frame dimensions do not match shared memory");
+                return false;
+            }
+
+            if (frame.depth() != CV_8U)
+            {
+                LOG_ERR("Frames written to shared memory must have 8-bit channels");
+                return false;
+            }
+
+            ShmPixelFormat pixelFormat = static_cast<ShmPixelFormat>(m_header->pixelFormat);
+            if (isPlanarFormat(pixelFormat) && frame.channels() != 3)
+            {
+                LOG_ERR(std::string("Frames written to a ") + pixelFormatName(pixelFormat) + " segment must be BGR");
+                return false;
+            }
+
+            int conversion = -1;
+            if (pixelFormat == ShmPixelFormat::I420)
+            {
+                conversion = cv::COLOR_BGR2YUV_I420;
+            }
+            else if (pixelFormat == ShmPixelFormat::NV12)
+            {
+                // OpenCV has no direct BGR to NV12 conversion, go through I420
+                cv::cvtColor(frame, m_yuvScratch, cv::COLOR_BGR2YUV_I420);
+            }
+            else if (frame.channels() != static_cast<int>(m_header->channels))
+            {
+                if (pixelFormat == ShmPixelFormat::BGR8 && frame.channels() == 4)
+                {
+                    conversion = cv::COLOR_RGBA2BGR;
+                }
+                else if (m_header->channels == 3 && frame.channels() == 4)
+                {
+                    conversion = cv::COLOR_RGBA2RGB;
+                }
+                else if (m_header->channels == 4 && frame.channels() == 3)
+                {
+                    conversion = cv::COLOR_BGR2RGBA;
+                }
+                else
+                {
+                    LOG_ERR("Unsupported channel conversion");
+                    return false;
+                }
+            }
+            else if (frame.type() != matTypeForChannels(m_header->channels))
+            {
+                // copyTo() would reallocate the slot matrix rather than write into shared memory
+                LOG_ERR("Frame type does not match the shared memory channel count");
+                return false;
+            }
+
+            cv::Mat slotFrame;
+            if (!beginWrite(slotFrame))
+            {
+                LOG_WARN("Dropping frame " + std::to_string(frameIndex));
+                return false;
+            }
+
+            // Convert or copy straight into the slot; slotFrame already has the
+            // destination size and type, so OpenCV writes into shared memory
+            if (pixelFormat == ShmPixelFormat::NV12)
+            {
+                // Copy luma, then interleave the I420 chroma planes into the UV plane
+                size_t width = m_header->width;
+                size_t height = m_header->height;
+                const uint8_t *src = m_yuvScratch.data;
+                uint8_t *dst = slotFrame.data;
+                for (size_t y = 0; y < height; ++y)
+                {
+                    std::memcpy(dst + y * m_header->planeStrides[0], src + y * width, width);
+                }
+
+                const uint8_t *srcU = src + width * height;
+                const uint8_t *srcV = srcU + (width / 2) * (height / 2);
+                uint8_t *dstUV = dst + m_header->planeOffsets[1];
+                for (size_t y = 0; y < height / 2; ++y)
+                {
+                    const uint8_t *u = srcU + y * (width / 2);
+                    const uint8_t *v = srcV + y * (width / 2);
+                    uint8_t *uv = dstUV + y * m_header->planeStrides[1];
+                    for (size_t x = 0; x < width / 2; ++x)
+                    {
+                        uv[2 * x] = u[x];
+                        uv[2 * x + 1] = v[x];
+                    }
+                }
+            }
+            else if (conversion >= 0)
+            {
+                cv::cvtColor(frame, slotFrame, conversion);
+            }
+            else
+            {
+                frame.copyTo(slotFrame);
+            }
+
+            return commitWrite(frameIndex, totalFrames, fps, timestamp, decodeTimeNs);
+        }
+
+        bool ShmVideoHandler::writeFrameDelta(const cv::Mat &frame, uint32_t frameIndex, uint32_t totalFrames, double fps,
+                                              uint64_t timestamp, uint64_t decodeTimeNs)
+        {
+            bool havePrevious = false;
+            const uint8_t *previous = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                if (!m_isOpen || !m_header || !m_frameData || m_staleTiles.empty())
+                {
+                    LOG_ERR("Shared memory is not open for writing");
+                    return false;
+                }
+
+                if (isPlanarFormat(static_cast<ShmPixelFormat>(m_header->pixelFormat)))
+                {
+                    LOG_ERR("Delta publishing only supports packed pixel formats");
+                    return false;
+                }
+
+                if (frame.cols != static_cast<int>(m_header->width) ||
+                    frame.rows != static_cast<int>(m_header->height) ||
+                    frame.type() != matTypeForChannels(m_header->channels))
+                {
+                    LOG_ERR("Delta frames must already match the shared memory size and pixel format");
+                    return false;
+                }
+
+                // Diff against the latest published frame, which is never the slot we write
+                havePrevious = m_header->publishedSeq.load(std::memory_order_relaxed) > 0;
+                previous = slotPixels(m_header->latestSlot.load(std::memory_order_relaxed));
+            }
+
+            // beginWrite() takes the lock itself
+            cv::Mat slotFrame;
+            if (!beginWrite(slotFrame))
+            {
+                LOG_WARN("Dropping frame " + std::to_string(frameIndex));
+                return false;
+            }
+
+            // Held until publish: the stale masks and the claimed slot are only touched under the lock
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_isOpen || m_writeSlot < 0)
+            {
+                LOG_ERR("Shared memory was closed during a delta write");
+                return false;
+            }
+
+            const uint64_t *stale = &m_staleTiles[static_cast<size_t>(m_writeSlot) * kDirtyMaskWords];
+            uint64_t dirty[kDirtyMaskWords] = {};
+
+            const uint32_t tileSize = m_header->tileSize;
+            const size_t pixelSize = m_header->channels;
+            const size_t rowStride = m_header->rowStride;
+            for (uint32_t tileY = 0; tileY < m_header->tilesY; ++tileY)
+            {
+                int y0 = static_cast<int>(tileY * tileSize);
+                int y1 = std::min(y0 + static_cast<int>(tileSize), frame.rows);
+                for (uint32_t tileX = 0; tileX < m_header->tilesX; ++tileX)
+                {
+                    size_t x0 = static_cast<size_t>(tileX) * tileSize;
+                    size_t tileBytes = (std::min<size_t>(x0 + tileSize, frame.cols) - x0) * pixelSize;
+                    size_t offset = x0 * pixelSize;
+
+                    // memcmp is vectorised by libc and stops at the first difference
+                    bool changed = !havePrevious;
+                    for (int y = y0; y < y1 && !changed; ++y)
+                    {
+                        changed = std::memcmp(frame.ptr(y) + offset, previous + y * rowStride + offset, tileBytes) != 0;
+                    }
+
+                    uint32_t tile = tileY * m_header->tilesX + tileX;
+                    uint64_t bit = 1ull << (tile % 64);
+                    if (changed)
+                    {
+                        dirty[tile / 64] |= bit;
+                    }
+
+                    // Copy what changed now plus what this slot missed from earlier frames
+                    if (changed || (stale[tile / 64] & bit))
+                    {
+                        for (int y = y0; y < y1; ++y)
+                        {
+                            std::memcpy(slotFrame.ptr(y) + offset, frame.ptr(y) + offset, tileBytes);
+                        }
+                    }
+                }
+            }
+
+            return publishWriteSlot(frameIndex, totalFrames, fps, timestamp, decodeTimeNs, dirty);
+        }
+
+        bool ShmVideoHandler::readFrame(cv::Mat &frame, bool waitForNewFrame, int timeoutMs)
+        {
+            // Use a unique_lock instead of lock_guard so we can unlock it while waiting
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            if (!m_isOpen || !m_header || !m_frameData)
+            {
+                LOG_ERR("Shared memory is not open");
+                return false;
+            }
+
+            // Check if we need to wait for a new frame
+            if (waitForNewFrame && !waitForFrame(lock, timeoutMs))
+            {
+                return false;
+            }
+
+            return copyNextFrame(frame, waitForNewFrame);
+        }
+
+        bool ShmVideoHandler::tryReadFrame(cv::Mat &frame)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (!m_isOpen || !m_header || !m_frameData)
+            {
+                return false;
+            }
+
+            if (m_header->publishedSeq.load(std::memory_order_acquire) <= m_lastReadSeq)
+            {
+                return false;
+            }
+
+            return copyNextFrame(frame, true);
+        }
+
+        bool ShmVideoHandler::acquireFrame(ShmVideoFrameLease &lease, bool waitForNewFrame, int timeoutMs)
+        {
+            lease.release();
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            if (!m_isOpen || !m_header || !m_frameData)
+            {
+                LOG_ERR("Shared memory is not open");
+                return false;
+            }
+
+            if (waitForNewFrame && !waitForFrame(lock, timeoutMs))
+            {
+                return false;
+            }
+
+            return pinNextFrame(lease, waitForNewFrame);
+        }
+
+        bool ShmVideoHandler::tryAcquireFrame(ShmVideoFrameLease &lease)
+        {
+            lease.release();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (!m_isOpen || !m_header || !m_frameData)
+            {
+                return false;
+            }
+
+            if (m_header->publishedSeq.load(std::memory_order_acquire) <= m_lastReadSeq)
+            {
+                return false;
+            }
+
+            return pinNextFrame(lease, true);
+        }
+
+        bool ShmVideoHandler::pinNextFrame(ShmVideoFrameLease &lease, bool requireNewFrame)
+        {
+            ShmPixelFormat pixelFormat = static_cast<ShmPixelFormat>(m_header->pixelFormat);
+            int type = matTypeForFormat(pixelFormat);
+            if (type < 0)
+            {
+                return false;
+            }
+
+            const int maxPinAttempts = 8;
+            for (int attempt = 0; attempt < maxPinAttempts; ++attempt)
+            {
+                uint32_t slot = selectReadSlot(requireNewFrame);
+                if (slot >= m_header->slotCount)
+                {
+                    LOG_ERR("Invalid slot index in shared memory: " + std::to_string(slot));
+                    return false;
+                }
+
+                ShmVideoReaderSlot *reader = m_readerIndex >= 0 ? &m_header->readers[m_readerIndex] : nullptr;
+                if (reader && reader->pins[slot].load(std::memory_order_relaxed) == UINT8_MAX)
+                {
+                    LOG_ERR("Too many leases held on slot " + std::to_string(slot));
+                    return false;
+                }
+
+                // Pin first, then check the slot is not being written. The producer
+                // marks the slot odd before checking the pin count, so one of the
+                // two sides always sees the other.
+                ShmVideoSlotHeader *header = slotHeader(slot);
+                header->pinCount.fetch_add(1, std::memory_order_seq_cst);
+                uint64_t sequence = header->sequence.load(std::memory_order_seq_cst);
+                if (sequence & 1)
+                {
+                    header->pinCount.fetch_sub(1, std::memory_order_release);
+                    continue;
+                }
+
+                uint64_t frameSeq = header->frameSeq.load(std::memory_order_acquire);
+                if (frameSeq == 0 || (requireNewFrame && frameSeq <= m_lastReadSeq))
+                {
+                    header->pinCount.fetch_sub(1, std::memory_order_release);
+                    LOG_ERR("No new frame available");
+                    return false;
+                }
+
+                // Record the pin under this reader so it is dropped if we die holding it
+                if (reader)
+                {
+                    reader->pins[slot].fetch_add(1, std::memory_order_seq_cst);
+                }
+
+                lease.m_segment = m_header;
+                lease.m_slot = header;
+                lease.m_reader = reader;
+                lease.m_slotIndex = slot;
+                lease.m_frame = cv::Mat(frameRowsForFormat(pixelFormat, m_header->height), static_cast<int>(m_header->width),
+                                        type, slotPixels(slot), m_header->rowStride);
+                lease.m_frameIndex = header->frameIndex;
+                lease.m_totalFrames = header->totalFrames;
+                lease.m_fps = header->fps;
+                lease.m_timestamp = header->timestamp;
+                lease.m_frameSeq = frameSeq;
+                lease.m_decodeTimeNs = header->decodeTimeNs;
+                lease.m_publishTimeNs = header->publishTimeNs;
+
+                advanceCursor(frameSeq);
+                return true;
+            }
+
+            LOG_ERR("Could not pin the latest frame after " + std::to_string(maxPinAttempts) + " attempts");
+            return false;
+        }
+
+        bool ShmVideoHandler::waitForFrame(std::unique_lock<std::mutex> &lock, int timeoutMs)
+        {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+            while (true)
+            {
+                // Read the futex word first so a publish after the checks below still wakes us
+                uint32_t observed = m_header->frameFutex.load(std::memory_order_acquire);
+
+                if (m_header->publishedSeq.load(std::memory_order_acquire) > m_lastReadSeq)
+                {
+                    return true;
+                }
+
+                if (m_header->isEndOfVideo.load(std::memory_order_acquire))
+                {
+                    LOG_INFO("End of video reached");
+                    return false;
+                }
+
+                auto remaining = deadline - std::chrono::steady_clock::now();
+                if (remaining <= std::chrono::nanoseconds::zero())
+                {
+                    LOG_ERR("Timeout waiting for new frame");
+                    return false;
+                }
+
+                auto remainingNs = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+                struct timespec timeout;
+                timeout.tv_sec = remainingNs / 1000000000;
+                timeout.tv_nsec = remainingNs % 1000000000;
+
+                // Release the lock while sleeping so other threads can use the handler
+                m_header->waiters.fetch_add(1, std::memory_order_seq_cst);
+                lock.unlock();
+                if (futexWait(&m_header->frameFutex, observed, &timeout) == -1 &&
+                    errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+                {
+                    LOG_ERR("Failed to wait on frame futex: " + std::string(strerror(errno)));
+                    lock.lock();
+                    m_header->waiters.fetch_sub(1, std::memory_order_seq_cst);
+                    return false;
+                }
+                lock.lock();
+                m_header->waiters.fetch_sub(1, std::memory_order_seq_cst);
+
+                if (!m_isOpen || !m_header)
+                {
+                    return false;
+                }
+            }
+        }
+
+        bool ShmVideoHandler::copyNextFrame(cv::Mat &frame, bool requireNewFrame)
+        {
+            // Determine the OpenCV matrix type based on the pixel format
+            ShmPixelFormat pixelFormat = static_cast<ShmPixelFormat>(m_header->pixelFormat);
+            int type = matTypeForFormat(pixelFormat);
+            if (type < 0)
+            {
+                return false;
+            }
+
+            int width = m_header->width;
+            int rows = frameRowsForFormat(pixelFormat, m_header->height);
+
+            // Create or resize the output matrix; planar frames are copied into
+            // OpenCV's contiguous YUV layout
+            if (frame.empty() ||
+                frame.cols != width ||
+                frame.rows != rows ||
+                frame.type() != type ||
+                (isPlanarFormat(pixelFormat) && !frame.isContinuous()))
+            {
+                frame = cv::Mat(rows, width, type);
+            }
+
+            // Copy the chosen slot straight into the frame, retrying if the producer
+            // reused the slot while we were copying it
+            const int maxReadAttempts = 8;
+            for (int attempt = 0; attempt < maxReadAttempts; ++attempt)
+            {
+                uint32_t slot = selectReadSlot(requireNewFrame);
+                if (slot >= m_header->slotCount)
+                {
+                    LOG_ERR("Invalid slot index in shared memory: " + std::to_string(slot));
+                    return false;
+                }
+
+                ShmVideoSlotHeader *header = slotHeader(slot);
+                uint64_t before = header->sequence.load(std::memory_order_acquire);
+                if (before & 1)
+                {
+                    // The producer already moved on to this slot, look again
+                    continue;
+                }
+
+                uint64_t frameSeq = header->frameSeq.load(std::memory_order_relaxed);
+                if (frameSeq == 0 || (requireNewFrame && frameSeq <= m_lastReadSeq))
+                {
+                    LOG_ERR("No new frame available");
+                    return false;
+                }
+
+                copySlotPixels(slotPixels(slot), frame);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (header->sequence.load(std::memory_order_relaxed) == before)
+                {
+                    advanceCursor(frameSeq);
+                    return true;
+                }
+            }
+
+            LOG_ERR("Frame was overwritten while reading, giving up after " + std::to_string(maxReadAttempts) + " attempts");
+            return false;
+        }
+
+        // Replace the existing getFrameMetadata function with this safer version
+        ShmVideoFrameHeader ShmVideoHandler::getFrameMetadata()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            ShmVideoFrameHeader metadata{};
+            if (!m_isOpen || !m_header)
+            {
+                // Return an empty header with zero values if not open
+                return metadata;
+            }
+
+            metadata.width = m_header->width;
+            metadata.height = m_header->height;
+            metadata.channels = m_header->channels;
+            metadata.rowStride = m_header->rowStride;
+            metadata.pixelFormat = static_cast<ShmPixelFormat>(m_header->pixelFormat);
+            metadata.isEndOfVideo = m_header->isEndOfVideo.load(std::memory_order_acquire) != 0;
+            metadata.isNewFrame = m_header->publishedSeq.load(std::memory_order_acquire) > m_lastReadSeq;
+
+            // Take a consistent copy of the latest slot's metadata
+            for (int attempt = 0; attempt < 8; ++attempt)
+            {
+                uint32_t slot = m_header->latestSlot.load(std::memory_order_acquire);
+                if (slot >= m_header->slotCount)
+                {
+                    break;
+                }
+
+                ShmVideoSlotHeader *header = slotHeader(slot);
+                uint64_t before = header->sequence.load(std::memory_order_acquire);
+                if (before & 1)
+                {
+                    continue;
+                }
+
+                metadata.frameIndex = header->frameIndex;
+                metadata.totalFrames = header->totalFrames;
+                metadata.fps = header->fps;
+                metadata.timestamp = header->timestamp;
+                metadata.decodeTimeNs = header->decodeTimeNs;
+                metadata.publishTimeNs = header->publishTimeNs;
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (header->sequence.load(std::memory_order_relaxed) == before)
+                {
+                    break;
+                }
+            }
+
+            return metadata;
+        }
+
+        void ShmVideoHandler::closeSharedMemory()
         {
-            closeSharedMemory();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            closeSegment();
         }
 
-        bool ShmVideoHandler::createSharedMemory(const std::string &name, uint32_t width, uint32_t height, uint32_t channels)
+        void ShmVideoHandler::closeSegment()
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_isOpen)
+            {
+                unregisterReader();
 
-            // Close any existing shared memory
-            closeSharedMemory();
+                if (m_shmPtr != nullptr && m_shmPtr != MAP_FAILED)
+                {
+                    munmap(m_shmPtr, m_shmSize);
+                    m_shmPtr = nullptr;
+                }
 
-            // Store the name (remove leading '/' if present)
-            m_shmName = name;
-            if (!m_shmName.empty() && m_shmName[0] == '/')
-            {
-                m_shmName = m_shmName.substr(1);
-            }
+                if (m_shmFd != -1)
+                {
+                    close(m_shmFd);
+                    m_shmFd = -1;
+                }
 
-            // Calculate the size needed
-            m_shmSize = calculateShmSize(width, height, channels);
+                m_header = nullptr;
+                m_frameData = nullptr;
+                m_shmSize = 0;
+                m_backing = ShmVideoBacking::None;
+                m_writeSlot = -1;
+                m_staleTiles.clear();
+                m_isOpen = false;
 
-            // Create the shared memory object
-            m_shmFd = shm_open(("/" + m_shmName).c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
-            if (m_shmFd == -1)
-            {
-                LOG_ERR("Failed to create shared memory object: " + std::string(strerror(errno)));
-                return false;
+                LOG_INFO("Closed shared memory for video: " + m_shmName);
             }
+        }
 
-            // Set the size of the shared memory object
-            if (ftruncate(m_shmFd, m_shmSize) == -1)
+        BackpressurePolicy ShmVideoHandler::getBackpressurePolicy() const
+        {
+            if (!m_isOpen || !m_header)
             {
-                LOG_ERR("Failed to set size of shared memory: " + std::string(strerror(errno)));
-                close(m_shmFd);
-                m_shmFd = -1;
-                return false;
+                return BackpressurePolicy::LatestOnly;
             }
+            return static_cast<BackpressurePolicy>(m_header->policy);
+        }
 
-            // Map the shared memory object
-            m_shmPtr = mmap(NULL, m_shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_shmFd, 0);
-            if (m_shmPtr == MAP_FAILED)
+        ShmPixelFormat ShmVideoHandler::getPixelFormat() const
+        {
+            if (!m_isOpen || !m_header)
             {
-                LOG_ERR("Failed to map shared memory: " + std::string(strerror(errno)));
-                close(m_shmFd);
-                m_shmFd = -1;
-                return false;
+                return ShmPixelFormat::Unknown;
             }
+            return static_cast<ShmPixelFormat>(m_header->pixelFormat);
+        }
 
-            // Set up the header and frame data pointers
-            m_header = static_cast<ShmVideoFrameHeader *>(m_shmPtr);
-            m_frameData = static_cast<uint8_t *>(m_shmPtr) + sizeof(ShmVideoFrameHeader);
+        uint32_t ShmVideoHandler::getSlotCount() const
+        {
+            if (!m_isOpen || !m_header)
+            {
+                return 0;
+            }
+            return m_header->slotCount;
+        }
 
-            // Initialize the header
-            m_header->width = width;
-            m_header->height = height;
-            m_header->channels = channels;
-            m_header->frameIndex = 0;
-            m_header->totalFrames = 0;
-            m_header->fps = 0.0;
-            m_header->timestamp = 0;
-            m_header->isNewFrame = false;
-            m_header->isEndOfVideo = false;
+        const uint8_t *ShmVideoHandler::getSlotData(uint32_t slot, size_t &size) const
+        {
+            if (!m_isOpen || !m_header || slot >= m_header->slotCount)
+            {
+                size = 0;
+                return nullptr;
+            }
+            size = static_cast<size_t>(m_header->slotStride);
+            return slotPixels(slot);
+        }
 
-            m_isOpen = true;
+        bool ShmVideoHandler::isOpen() const
+        {
+            return m_isOpen;
+        }
 
-            LOG_INFO("Created shared memory for video: " + m_shmName +
-                     " (size: " + std::to_string(m_shmSize) + " bytes, dimensions: " +
-                     std::to_string(width) + "x" + std::to_string(height) + "x" + std::to_string(channels) + ")");
+        void ShmVideoHandler::signalEndOfVideo()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
 
-            return true;
+            if (m_isOpen && m_header)
+            {
+                m_header->isEndOfVideo.store(1, std::memory_order_release);
+                wakeReaders();
+            }
         }
 
-        bool ShmVideoHandler::openSharedMemory(const std::string &name)
+        void ShmVideoHandler::wakeReaders()
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
+            m_header->frameFutex.fetch_add(1, std::memory_order_seq_cst);
 
-            // Close any existing shared memory
-            closeSharedMemory();
+            // Skip the syscall when nobody is blocked
+            if (m_header->waiters.load(std::memory_order_seq_cst) > 0)
+            {
+                futexWakeAll(&m_header->frameFutex);
+            }
+        }
 
-            // Store the name (remove leading '/' if present)
-            m_shmName = name;
-            if (!m_shmName.empty() && m_shmName[0] == '/')
+        void ShmVideoHandler::removeSharedMemory(const std::string &name)
+        {
+            std::string shmName = name;
+            if (!shmName.empty() && shmName[0] == '/')
             {
-                m_shmName = m_shmName.substr(1);
+                shmName = shmName.substr(1);
             }
 
-            // Open the shared memory object
-            m_shmFd = shm_open(("/" + m_shmName).c_str(), O_RDWR, S_IRUSR | S_IWUSR);
-            if (m_shmFd == -1)
+            // The segment lives on exactly one of these; ENOENT from the other is expected
+            shm_unlink(("/" + shmName).c_str());
+            unlink(hugeTlbPath(shmName).c_str());
+        }
+
+        bool ShmVideoHandler::createHugeTlbSegment(size_t size, const ShmVideoOptions &options)
+        {
+            struct statfs fsInfo;
+            if (statfs(kHugeTlbMountPoint, &fsInfo) == -1 || fsInfo.f_type != static_cast<decltype(fsInfo.f_type)>(HUGETLBFS_MAGIC))
             {
-                LOG_ERR("Failed to open shared memory object: " + std::string(strerror(errno)));
+                LOG_WARN(std::string("No hugetlbfs mounted at ") + kHugeTlbMountPoint + ", falling back to shm_open");
                 return false;
             }
 
-            // Get the size of the shared memory object
-            struct stat sb;
-            if (fstat(m_shmFd, &sb) == -1)
+            // hugetlbfs files must be a whole number of huge pages
+            size_t hugePageSize = static_cast<size_t>(fsInfo.f_bsize);
+            size_t roundedSize = (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+
+            std::string path = hugeTlbPath(m_shmName);
+            m_shmFd = open(path.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+            if (m_shmFd == -1)
             {
-                LOG_ERR("Failed to get size of shared memory: " + std::string(strerror(errno)));
-                close(m_shmFd);
-                m_shmFd = -1;
+                LOG_WARN("Failed to create " + path + ": " + std::string(strerror(errno)) + ", falling back to shm_open");
                 return false;
             }
-            m_shmSize = sb.st_size;
 
-            // Map the shared memory object
-            m_shmPtr = mmap(NULL, m_shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_shmFd, 0);
-            if (m_shmPtr == MAP_FAILED)
+            m_shmSize = roundedSize;
+            m_backing = ShmVideoBacking::HugeTlbFs;
+            if (ftruncate(m_shmFd, m_shmSize) == -1 || !mapSegment(options))
             {
-                LOG_ERR("Failed to map shared memory: " + std::string(strerror(errno)));
+                // Typically ENOMEM: not enough huge pages reserved in the pool
+                LOG_WARN("Failed to map " + std::to_string(m_shmSize / hugePageSize) + " huge pages of " +
+                         std::to_string(hugePageSize) + " bytes: " + std::string(strerror(errno)) +
+                         ", falling back to shm_open");
                 close(m_shmFd);
+                unlink(path.c_str());
                 m_shmFd = -1;
+                m_shmSize = 0;
+                m_backing = ShmVideoBacking::None;
                 return false;
             }
 
-            // Set up the header and frame data pointers
-            m_header = static_cast<ShmVideoFrameHeader *>(m_shmPtr);
-            m_frameData = static_cast<uint8_t *>(m_shmPtr) + sizeof(ShmVideoFrameHeader);
-
-            m_isOpen = true;
-
-            LOG_INFO("Opened shared memory for video: " + m_shmName +
-                     " (size: " + std::to_string(m_shmSize) + " bytes, dimensions: " +
-                     std::to_string(m_header->width) + "x" + std::to_string(m_header->height) +
-                     "x" + std::to_string(m_header->channels) + ")");
-
             return true;
         }
 
-        bool ShmVideoHandler::writeFrame(const cv::Mat &frame, uint32_t frameIndex, uint32_t totalFrames, double fps, uint64_t timestamp)
+        bool ShmVideoHandler::createMemfdSegment(size_t size, const ShmVideoOptions &options)
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-
-            if (!m_isOpen || !m_header || !m_frameData)
+            // The name only labels the fd in /proc; nothing appears in /dev/shm, and the
+            // memory goes away with the last process holding the fd or a mapping
+            m_shmFd = memfd_create(m_shmName.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+            if (m_shmFd == -1)
             {
-                LOG_ERR("Shared memory is not open");
+                LOG_ERR("Failed to create memfd: " + std::string(strerror(errno)));
                 return false;
             }
 
-            // Check if the frame dimensions match the shared memory
-            if (frame.cols != static_cast<int>(m_header->width) ||
-                frame.rows != static_cast<int>(m_header->height))
+            // Sealed before any reader can see it, so no reader ever has to recheck the size
+            m_shmSize = size;
+            m_backing = ShmVideoBacking::Memfd;
+            if (ftruncate(m_shmFd, m_shmSize) == -1 ||
+                fcntl(m_shmFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1 ||
+                !mapSegment(options))
             {
-                LOG_ERR("Frame dimensions do not match shared memory");
+                LOG_ERR("Failed to set up memfd segment: " + std::string(strerror(errno)));
+                close(m_shmFd);
+                m_shmFd = -1;
+                m_shmSize = 0;
+                m_backing = ShmVideoBacking::None;
                 return false;
             }
 
-            // Update the header
-            m_header->frameIndex = frameIndex;
-            m_header->totalFrames = totalFrames;
-            m_header->fps = fps;
-            m_header->timestamp = timestamp;
+            return true;
+        }
 
-            // Convert the frame to the right format if needed
-            cv::Mat convertedFrame;
-            if (frame.channels() != static_cast<int>(m_header->channels))
+        bool ShmVideoHandler::mapSegment(const ShmVideoOptions &options)
+        {
+            int flags = MAP_SHARED;
+            if (options.populate)
             {
-                if (m_header->channels == 3 && frame.channels() == 4)
-                {
-                    cv::cvtColor(frame, convertedFrame, cv::COLOR_RGBA2RGB);
-                }
-                else if (m_header->channels == 4 && frame.channels() == 3)
-                {
-                    cv::cvtColor(frame, convertedFrame, cv::COLOR_BGR2RGBA);
-                }
-                else
-                {
-                    LOG_ERR("Unsupported channel conversion");
-                    return false;
-                }
+                // Take every page fault now instead of during the first frames
+                flags |= MAP_POPULATE;
             }
-            else
+
+            m_shmPtr = mmap(NULL, m_shmSize, PROT_READ | PROT_WRITE, flags, m_shmFd, 0);
+            if (m_shmPtr == MAP_FAILED)
             {
-                frame.copyTo(convertedFrame);
+                m_shmPtr = nullptr;
+                return false;
             }
 
-            // Copy the frame data
-            size_t frameDataSize = m_header->width * m_header->height * m_header->channels;
-            if (convertedFrame.isContinuous())
+            // Without hugetlbfs, still let transparent huge pages back the mapping where enabled
+            if (options.hugePages && (m_backing == ShmVideoBacking::PosixShm || m_backing == ShmVideoBacking::Memfd))
             {
-                std::memcpy(m_frameData, convertedFrame.data, frameDataSize);
+                madvise(m_shmPtr, m_shmSize, MADV_HUGEPAGE);
             }
-            else
+
+            if (options.lockPages && mlock(m_shmPtr, m_shmSize) == -1)
             {
-                // Copy row by row if the data is not continuous
-                for (uint32_t y = 0; y < m_header->height; ++y)
-                {
-                    std::memcpy(
-                        m_frameData + y * m_header->width * m_header->channels,
-                        convertedFrame.ptr(y),
-                        m_header->width * m_header->channels);
-                }
+                LOG_WARN("Failed to lock shared memory pages (check RLIMIT_MEMLOCK): " + std::string(strerror(errno)));
             }
 
-            // Set the new frame flag
-            m_header->isNewFrame = true;
-
             return true;
         }
 
-        bool ShmVideoHandler::readFrame(cv::Mat &frame, bool waitForNewFrame)
+        ShmVideoLayout ShmVideoHandler::computeLayout(uint32_t width, uint32_t height, ShmPixelFormat pixelFormat,
+                                                      uint32_t slotCount)
         {
-            // Use a unique_lock instead of lock_guard so we can unlock it temporarily
-            std::unique_lock<std::mutex> lock(m_mutex);
+            // Segment header, slot headers, then page-aligned frames with cache-line padded rows
+            ShmVideoLayout layout = {};
+            uint64_t rowStride = alignUp(static_cast<uint64_t>(width) * channelsForFormat(pixelFormat), kCacheLineSize);
+            uint64_t lumaBytes = rowStride * height;
+            uint64_t frameBytes = lumaBytes;
 
-            if (!m_isOpen || !m_header || !m_frameData)
+            layout.rowStride = static_cast<uint32_t>(rowStride);
+            layout.planeCount = 1;
+            layout.planeStrides[0] = layout.rowStride;
+            layout.planeOffsets[0] = 0;
+            if (pixelFormat == ShmPixelFormat::NV12)
             {
-                LOG_ERR("Shared memory is not open");
-                return false;
+                // Interleaved UV rows as wide as the luma rows
+                layout.planeCount = 2;
+                layout.planeStrides[1] = layout.rowStride;
+                layout.planeOffsets[1] = lumaBytes;
+                frameBytes = lumaBytes + rowStride * (height / 2);
             }
-
-            // Check if we need to wait for a new frame
-            if (waitForNewFrame)
+            else if (pixelFormat == ShmPixelFormat::I420)
             {
-                // Poll for a new frame with a timeout
-                const int maxAttempts = 100; // 5 seconds timeout (100 * 50ms)
-                int attempts = 0;
+                // Half-stride chroma rows, matching how OpenCV walks a strided I420 matrix
+                uint64_t chromaBytes = (rowStride / 2) * (height / 2);
+                layout.planeCount = 3;
+                layout.planeStrides[1] = layout.rowStride / 2;
+                layout.planeStrides[2] = layout.rowStride / 2;
+                layout.planeOffsets[1] = lumaBytes;
+                layout.planeOffsets[2] = lumaBytes + chromaBytes;
+                frameBytes = lumaBytes + 2 * chromaBytes;
+            }
 
-                while (!m_header->isNewFrame && !m_header->isEndOfVideo && attempts < maxAttempts)
-                {
-                    // Release the lock while waiting to avoid deadlock
-                    lock.unlock();
-                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                    lock.lock();
-                    attempts++;
-                }
+            layout.slotHeaderOffset = alignUp(sizeof(ShmVideoSegmentHeader), kCacheLineSize);
+            layout.frameDataOffset = alignUp(layout.slotHeaderOffset + sizeof(ShmVideoSlotHeader) * slotCount, kShmPageAlignment);
+            layout.slotStride = alignUp(frameBytes, kShmPageAlignment);
+            layout.totalSize = layout.frameDataOffset + layout.slotStride * slotCount;
+            return layout;
+        }
+
+        void ShmVideoHandler::copySlotPixels(const uint8_t *pixels, cv::Mat &frame) const
+        {
+            size_t width = m_header->width;
+            size_t height = m_header->height;
+            ShmPixelFormat pixelFormat = static_cast<ShmPixelFormat>(m_header->pixelFormat);
 
-                if (attempts >= maxAttempts)
+            if (!isPlanarFormat(pixelFormat))
+            {
+                size_t rowSize = width * m_header->channels;
+                size_t rowStride = m_header->rowStride;
+                if (frame.isContinuous() && rowStride == rowSize)
                 {
-                    LOG_ERR("Timeout waiting for new frame");
-                    return false;
+                    std::memcpy(frame.data, pixels, rowSize * height);
                 }
-
-                if (m_header->isEndOfVideo)
+                else
                 {
-                    LOG_INFO("End of video reached");
-                    return false;
+                    // Copy row by row, skipping the row padding in the slot
+                    for (size_t y = 0; y < height; ++y)
+                    {
+                        std::memcpy(frame.ptr(static_cast<int>(y)), pixels + y * rowStride, rowSize);
+                    }
                 }
+                return;
             }
 
-            // Check if there's a new frame
-            if (!m_header->isNewFrame && waitForNewFrame)
-            {
-                LOG_ERR("No new frame available");
-                return false;
-            }
-
-            // Determine the OpenCV matrix type based on the number of channels
-            int type;
-            switch (m_header->channels)
+            // Planar YUV: pack each plane back to back without padding, as OpenCV
+            // expects (chroma rows are width bytes apart for NV12, width / 2 for I420)
+            uint8_t *dst = frame.data;
+            for (uint32_t plane = 0; plane < m_header->planeCount; ++plane)
             {
-            case 1:
-                type = CV_8UC1;
-                break;
-            case 3:
-                type = CV_8UC3;
-                break;
-            case 4:
-                type = CV_8UC4;
-                break;
-            default:
-                LOG_ERR("Unsupported number of channels: " + std::to_string(m_header->channels));
-                return false;
+                size_t rows = plane == 0 ? height : height / 2;
+                size_t rowBytes = (plane == 0 || pixelFormat == ShmPixelFormat::NV12) ? width : width / 2;
+                const uint8_t *src = pixels + m_header->planeOffsets[plane];
+                for (size_t y = 0; y < rows; ++y)
+                {
+                    std::memcpy(dst + y * rowBytes, src + y * m_header->planeStrides[plane], rowBytes);
+                }
+                dst += rows * rowBytes;
             }
+        }
 
-            // Get dimensions and size before releasing lock
-            int width = m_header->width;
-            int height = m_header->height;
-            size_t frameDataSize = width * height * m_header->channels;
-
-            // Create a temporary buffer to hold the frame data
-            std::vector<uint8_t> tempBuffer(frameDataSize);
+        ShmVideoSlotHeader *ShmVideoHandler::slotHeader(uint32_t slot) const
+        {
+            uint8_t *base = reinterpret_cast<uint8_t *>(m_header) + m_header->slotHeaderOffset;
+            return reinterpret_cast<ShmVideoSlotHeader *>(base) + slot;
+        }
 
-            // Copy the frame data to our temporary buffer
-            std::memcpy(tempBuffer.data(), m_frameData, frameDataSize);
+        uint8_t *ShmVideoHandler::slotPixels(uint32_t slot) const
+        {
+            return m_frameData + slot * m_header->slotStride;
+        }
 
-            // Reset the new frame flag if we're reading it
-            if (waitForNewFrame)
+        uint32_t ShmVideoHandler::selectReadSlot(bool requireNewFrame) const
+        {
+            uint32_t latest = m_header->latestSlot.load(std::memory_order_acquire);
+            if (!requireNewFrame || static_cast<BackpressurePolicy>(m_header->policy) == BackpressurePolicy::LatestOnly)
             {
-                m_header->isNewFrame = false;
+                return latest;
             }
 
-            // We can release the lock now since we've copied all the data we need
-            lock.unlock();
-
-            // Create or resize the output matrix
-            if (frame.empty() ||
-                frame.cols != width ||
-                frame.rows != height ||
-                frame.type() != type)
+            // Oldest frame this reader has not consumed yet; frames already
+            // overwritten under DropOldest are simply skipped
+            uint32_t next = latest;
+            uint64_t nextSeq = UINT64_MAX;
+            for (uint32_t i = 0; i < m_header->slotCount; ++i)
             {
-                frame = cv::Mat(height, width, type);
+                uint64_t frameSeq = slotHeader(i)->frameSeq.load(std::memory_order_acquire);
+                if (frameSeq > m_lastReadSeq && frameSeq < nextSeq)
+                {
+                    next = i;
+                    nextSeq = frameSeq;
+                }
             }
+            return next;
+        }
 
-            // Copy from our temporary buffer to the frame
-            if (frame.isContinuous())
+        void ShmVideoHandler::advanceCursor(uint64_t frameSeq)
+        {
+            m_lastReadSeq = frameSeq;
+            if (m_readerIndex >= 0)
             {
-                std::memcpy(frame.data, tempBuffer.data(), frameDataSize);
+                m_header->readers[m_readerIndex].cursor.store(frameSeq, std::memory_order_seq_cst);
+                wakeProducer(m_header);
             }
-            else
+        }
+
+        void ShmVideoHandler::registerReader()
+        {
+            // Join at the latest frame rather than replaying what is still in the ring
+            uint64_t published = m_header->publishedSeq.load(std::memory_order_acquire);
+            m_lastReadSeq = published > 0 ? published - 1 : 0;
+            m_readerIndex = -1;
+
+            uint32_t pid = static_cast<uint32_t>(getpid());
+            for (uint32_t i = 0; i < kMaxReaders; ++i)
             {
-                // Copy row by row if the data is not continuous
-                int rowSize = width * m_header->channels;
-                for (int y = 0; y < height; ++y)
+                ShmVideoReaderSlot &reader = m_header->readers[i];
+                uint32_t expected = 0;
+                if (reader.pid.compare_exchange_strong(expected, pid, std::memory_order_seq_cst))
                 {
-                    std::memcpy(
-                        frame.ptr(y),
-                        tempBuffer.data() + y * rowSize,
-                        rowSize);
+                    reader.cursor.store(m_lastReadSeq, std::memory_order_seq_cst);
+                    m_readerIndex = static_cast<int>(i);
+                    LOG_INFO("Registered as reader " + std::to_string(i) + " of " + m_shmName);
+                    return;
                 }
             }
 
-            return true;
+            LOG_WARN("Reader table of " + m_shmName + " is full, reading without a registered cursor");
         }
 
-        // Replace the existing getFrameMetadata function with this safer version
-        ShmVideoFrameHeader ShmVideoHandler::getFrameMetadata()
+        void ShmVideoHandler::unregisterReader()
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-
-            if (!m_isOpen || !m_header)
+            if (m_readerIndex < 0 || !m_header)
             {
-                // Return an empty header with zero values if not open
-                ShmVideoFrameHeader emptyHeader{};
-                return emptyHeader;
+                return;
             }
 
-            // Return a copy of the header structure
-            return *m_header;
+            m_header->readers[m_readerIndex].pid.store(0, std::memory_order_seq_cst);
+            wakeProducer(m_header);
+            m_readerIndex = -1;
         }
 
-        void ShmVideoHandler::closeSharedMemory()
+        uint64_t ShmVideoHandler::minReaderCursor() const
         {
-            // Try to lock without blocking to prevent deadlock
-            std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
-            if (!lock.try_lock())
+            uint64_t minCursor = UINT64_MAX;
+            for (uint32_t i = 0; i < kMaxReaders; ++i)
             {
-                // If we can't get the lock immediately, log a warning and proceed anyway
-                LOG_ERR("Could not acquire lock for closeSharedMemory, proceeding without lock");
+                const ShmVideoReaderSlot &reader = m_header->readers[i];
+                if (reader.pid.load(std::memory_order_seq_cst) == 0)
+                {
+                    continue;
+                }
+
+                uint64_t cursor = reader.cursor.load(std::memory_order_seq_cst);
+                if (cursor < minCursor)
+                {
+                    minCursor = cursor;
+                }
             }
+            return minCursor;
+        }
 
-            if (m_isOpen)
+        void ShmVideoHandler::reapDeadReaders()
+        {
+            for (uint32_t i = 0; i < kMaxReaders; ++i)
             {
-                if (m_shmPtr != nullptr && m_shmPtr != MAP_FAILED)
+                ShmVideoReaderSlot &reader = m_header->readers[i];
+                uint32_t pid = reader.pid.load(std::memory_order_relaxed);
+                if (pid == 0 || kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH)
                 {
-                    munmap(m_shmPtr, m_shmSize);
-                    m_shmPtr = nullptr;
+                    continue;
                 }
 
-                if (m_shmFd != -1)
+                // Drop the leases the reader still held before the entry can be reused
+                uint32_t released = 0;
+                for (uint32_t slot = 0; slot < m_header->slotCount; ++slot)
                 {
-                    close(m_shmFd);
-                    m_shmFd = -1;
+                    uint8_t pins = reader.pins[slot].exchange(0, std::memory_order_seq_cst);
+                    if (pins > 0)
+                    {
+                        slotHeader(slot)->pinCount.fetch_sub(pins, std::memory_order_seq_cst);
+                        released += pins;
+                    }
                 }
 
-                m_header = nullptr;
-                m_frameData = nullptr;
-                m_shmSize = 0;
-                m_isOpen = false;
-
-                LOG_INFO("Closed shared memory for video: " + m_shmName);
+                if (reader.pid.compare_exchange_strong(pid, 0, std::memory_order_seq_cst))
+                {
+                    LOG_WARN("Removed reader " + std::to_string(i) + " of " + m_shmName +
+                             " (process " + std::to_string(pid) + " is gone, " + std::to_string(released) +
+                             " leases released)");
+                }
             }
         }
 
-        bool ShmVideoHandler::isOpen() const
-        {
-            return m_isOpen;
-        }
-
-        void ShmVideoHandler::signalEndOfVideo()
+        int ShmVideoHandler::openWriteSlot(uint64_t &sequence, uint64_t reuseLimit)
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
+            // Never overwrite the latest frame; otherwise try the oldest unpinned one first
+            uint32_t latest = m_header->latestSlot.load(std::memory_order_relaxed);
+            uint64_t tried = 1ull << latest;
 
-            if (m_isOpen && m_header)
+            for (uint32_t candidate = 1; candidate < m_header->slotCount; ++candidate)
             {
-                m_header->isEndOfVideo = true;
+                int oldest = -1;
+                uint64_t oldestSeq = UINT64_MAX;
+                for (uint32_t i = 0; i < m_header->slotCount; ++i)
+                {
+                    uint64_t frameSeq = slotHeader(i)->frameSeq.load(std::memory_order_relaxed);
+                    if (!(tried & (1ull << i)) && frameSeq < oldestSeq)
+                    {
+                        oldest = static_cast<int>(i);
+                        oldestSeq = frameSeq;
+                    }
+                }
+                if (oldest < 0 || oldestSeq > reuseLimit)
+                {
+                    // Every remaining slot holds a frame some reader still needs
+                    break;
+                }
+                tried |= 1ull << oldest;
+
+                ShmVideoSlotHeader *header = slotHeader(oldest);
+                if (header->pinCount.load(std::memory_order_acquire) > 0)
+                {
+                    continue;
+                }
+
+                // Mark the slot odd, then re-check pins. Pairs with pinNextFrame, which
+                // bumps the pin count and then re-checks for an odd sequence
+                sequence = header->sequence.load(std::memory_order_relaxed);
+                header->sequence.store(sequence + 1, std::memory_order_seq_cst);
+                if (header->pinCount.load(std::memory_order_seq_cst) > 0)
+                {
+                    // A reader pinned it in the meantime; the contents are untouched
+                    header->sequence.store(sequence, std::memory_order_release);
+                    continue;
+                }
+
+                // Keep the pixel writes after the odd sequence
+                std::atomic_thread_fence(std::memory_order_release);
+                return oldest;
             }
-        }
 
-        size_t ShmVideoHandler::calculateShmSize(uint32_t width, uint32_t height, uint32_t channels)
-        {
-            // Header size + frame data size
-            return sizeof(ShmVideoFrameHeader) + (width * height * channels);
+            return -1;
         }
 
     } // namespace memory
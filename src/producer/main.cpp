@@ -10,6 +10,7 @@
 #include "utils/mode_probe.hpp"
 #include "utils/file_utils.hpp"
 #include "media/video_loader.hpp"
+#include "tools/benchmark.hpp"
 
 // Global variables for signal handling
 std::atomic<bool> g_running(true);
@@ -46,13 +47,24 @@ void signalHandler(int signum)
 
 void print_usage()
 {
-    std::cerr << "Usage: ./vst_producer [-i <image_path> | -v <video_path>] [--mode=shm|dma | -s | -d]\n";
+    std::cerr << "Usage: ./vst_producer [-i <image_path> | -v <video_path>] [--mode=shm|dma|heap | -s | -d]\n";
     std::cerr << "  -i <image_path>   Path to image file\n";
     std::cerr << "  -v <video_path>   Path to video file\n";
     std::cerr << "  --mode=shm        Use shared memory mode\n";
     std::cerr << "  --mode=dma        Use DMA-BUF mode (default)\n";
+    std::cerr << "  --mode=heap       Share DMA-BUFs from the system DMA-BUF heap; needs no GPU\n";
     std::cerr << "  -s                Shortcut for --mode=shm\n";
     std::cerr << "  -d                Shortcut for --mode=dma\n";
+    std::cerr << "  --backpressure=latest|drop-oldest|block\n";
+    std::cerr << "                    What to do when an SHM video reader falls behind (default: latest)\n";
+    std::cerr << "  --hugepages       Back the SHM video ring with huge pages when available\n";
+    std::cerr << "  --mlock           Lock the SHM video ring in memory\n";
+    std::cerr << "  --memfd           Share the SHM video ring as a sealed memfd over a Unix socket, not in /dev/shm\n";
+    std::cerr << "  --delta           Publish only the SHM video tiles that changed (for mostly static content)\n";
+    std::cerr << "  --dma-ring=<3-4>  Number of DMA-BUF (or heap) video images to cycle through (default: 3)\n";
+    std::cerr << "  --headless        Render offscreen without a window or display (DMA-BUF mode)\n";
+    std::cerr << "  --format=bgr|rgba|nv12|i420\n";
+    std::cerr << "                    Pixel format of the SHM video frames (default: rgba; bgr is copied as decoded)\n";
 }
 
 int main(int argc, char *argv[])
@@ -61,6 +73,12 @@ int main(int argc, char *argv[])
     std::string filePath;
     bool isVideo = false;
     bool modeSetExplicitly = false;
+    vst::memory::BackpressurePolicy backpressure = vst::memory::BackpressurePolicy::LatestOnly;
+    vst::memory::ShmVideoOptions shmOptions;
+    bool deltaPublishing = false;
+    uint32_t dmaRingSize = 3;
+    bool headless = false;
+    vst::memory::ShmPixelFormat pixelFormat = vst::memory::ShmPixelFormat::RGBA8;
 
     for (int i = 1; i < argc; ++i)
     {
@@ -86,10 +104,89 @@ int main(int argc, char *argv[])
             mode = "dma";
             modeSetExplicitly = true;
         }
+        else if (arg == "--hugepages")
+        {
+            shmOptions.hugePages = true;
+        }
+        else if (arg == "--mlock")
+        {
+            shmOptions.lockPages = true;
+        }
+        else if (arg == "--memfd")
+        {
+            shmOptions.memfd = true;
+        }
+        else if (arg == "--delta")
+        {
+            deltaPublishing = true;
+        }
+        else if (arg == "--headless")
+        {
+            headless = true;
+        }
+        else if (arg.rfind("--dma-ring=", 0) == 0)
+        {
+            std::string size = arg.substr(11);
+            if (size != "3" && size != "4")
+            {
+                std::cerr << "Invalid DMA-BUF ring size: " << size << "\n";
+                print_usage();
+                return EXIT_FAILURE;
+            }
+            dmaRingSize = static_cast<uint32_t>(std::stoul(size));
+        }
+        else if (arg.rfind("--format=", 0) == 0)
+        {
+            std::string format = arg.substr(9);
+            if (format == "bgr")
+            {
+                pixelFormat = vst::memory::ShmPixelFormat::BGR8;
+            }
+            else if (format == "rgba")
+            {
+                pixelFormat = vst::memory::ShmPixelFormat::RGBA8;
+            }
+            else if (format == "nv12")
+            {
+                pixelFormat = vst::memory::ShmPixelFormat::NV12;
+            }
+            else if (format == "i420")
+            {
+                pixelFormat = vst::memory::ShmPixelFormat::I420;
+            }
+            else
+            {
+                std::cerr << "Invalid pixel format: " << format << "\n";
+                print_usage();
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg.rfind("--backpressure=", 0) == 0)
+        {
+            std::string policy = arg.substr(15);
+            if (policy == "latest")
+            {
+                backpressure = vst::memory::BackpressurePolicy::LatestOnly;
+            }
+            else if (policy == "drop-oldest")
+            {
+                backpressure = vst::memory::BackpressurePolicy::DropOldest;
+            }
+            else if (policy == "block")
+            {
+                backpressure = vst::memory::BackpressurePolicy::BlockProducer;
+            }
+            else
+            {
+                std::cerr << "Invalid backpressure policy: " << policy << "\n";
+                print_usage();
+                return EXIT_FAILURE;
+            }
+        }
         else if (arg.rfind("--mode=", 0) == 0)
         {
             std::string parsedMode = arg.substr(7);
-            if (parsedMode != "shm" && parsedMode != "dma")
+            if (parsedMode != "shm" && parsedMode != "dma" && parsedMode != "heap")
             {
                 std::cerr << "Invalid mode: " << parsedMode << "\n";
                 print_usage();
@@ -114,6 +211,14 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    if (deltaPublishing && pixelFormat != vst::memory::ShmPixelFormat::RGBA8 &&
+        pixelFormat != vst::memory::ShmPixelFormat::BGR8)
+    {
+        std::cerr << "Error: --delta only supports --format=bgr or --format=rgba.\n";
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
     // Print selected options
     std::cout << "Producer Mode: " << mode << (modeSetExplicitly ? "" : " (default)") << "\n";
     std::cout << (isVideo ? "Video Path: " : "Image Path: ") << filePath << "\n";
@@ -131,7 +236,27 @@ int main(int argc, char *argv[])
     try
     {
         // Check mode
-        if (mode == "dma")
+        if (mode == "dma" && headless)
+        {
+            std::cout << "Running headless, frames are rendered offscreen\n";
+            g_app->setDmaRingSize(dmaRingSize);
+            g_app->ProducerDMA(nullptr, filePath, mode, isVideo);
+
+            while (g_running)
+            {
+                g_app->update();
+                if (isVideo)
+                {
+                    g_app->runFrame();
+                }
+                else
+                {
+                    // A still image never changes, and without a window there is nothing to redraw
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                }
+            }
+        }
+        else if (mode == "dma")
         {
             // DMA-BUF mode (Vulkan with window)
             // Initialize GLFW
@@ -185,6 +310,7 @@ int main(int argc, char *argv[])
             }
 
             // Start the producer app
+            g_app->setDmaRingSize(dmaRingSize);
             g_app->ProducerDMA(glfwWindow, filePath, mode, isVideo);
 
             // Main loop
@@ -198,8 +324,57 @@ int main(int argc, char *argv[])
             glfwDestroyWindow(glfwWindow);
             glfwTerminate();
         }
+        else if (mode == "heap")
+        {
+            g_app->setDmaRingSize(dmaRingSize);
+            g_app->ProducerHeap(filePath, isVideo);
+
+            if (isVideo)
+            {
+                std::cout << "Video streaming started in DMA-BUF heap mode. Press Ctrl+C to stop.\n";
+
+                cv::VideoCapture &cap = g_app->getVideoLoader()->getCapture();
+                double fps = cap.get(cv::CAP_PROP_FPS);
+                auto frameDelay = std::chrono::microseconds(static_cast<int64_t>(1e6 / (fps > 0 ? fps : 30.0)));
+
+                cv::Mat frame;
+                uint64_t frameIndex = 0;
+                auto nextFrame = std::chrono::steady_clock::now();
+                while (g_running)
+                {
+                    if (!g_app->getVideoLoader()->grabFrame(frame))
+                    {
+                        std::cout << "End of video reached, restarting..." << std::endl;
+                        cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+                        continue;
+                    }
+
+                    g_app->publishHeapFrame(frame, ++frameIndex);
+                    if (frameIndex % 100 == 0)
+                    {
+                        std::cout << "Processed " << frameIndex << " frames" << std::endl;
+                    }
+
+                    // Pace by the video frame rate; there is no display to do it. A late
+                    // frame restarts the schedule instead of bursting to catch up
+                    nextFrame = std::max(nextFrame + frameDelay, std::chrono::steady_clock::now());
+                    std::this_thread::sleep_until(nextFrame);
+                }
+            }
+            else
+            {
+                // The image is already in place; consumers are served from the control server thread
+                while (g_running)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                }
+            }
+        }
         else if (mode == "shm")
         {
+            g_app->setBackpressurePolicy(backpressure);
+            g_app->setShmVideoOptions(shmOptions);
+            g_app->setShmPixelFormat(pixelFormat);
             g_app->ProducerSHM(filePath, mode, isVideo);
 
             if (isVideo)
@@ -214,6 +389,8 @@ int main(int argc, char *argv[])
 
                 // Main video playback loop
                 cv::Mat frame;
+                cv::Mat rgbaFrame; // Only used for RGBA delta publishing, reused across frames
+                bool rgbaTransport = pixelFormat == vst::memory::ShmPixelFormat::RGBA8;
                 int frameCount = 0;
                 auto startTime = std::chrono::steady_clock::now();
 
@@ -233,27 +410,45 @@ int main(int argc, char *argv[])
                         startTime = std::chrono::steady_clock::now();
                         continue;
                     }
+                    uint64_t decodeTimeNs = vst::monotonicNowNs();
 
                     // Display the frame
                     cv::imshow(g_app->getWindowTitle(), frame);
 
-                    // Convert to RGBA for shared memory
-                    cv::Mat rgbaFrame;
-                    cv::cvtColor(frame, rgbaFrame, cv::COLOR_BGR2RGBA);
-
                     // Calculate timestamp
                     auto now = std::chrono::steady_clock::now();
                     uint64_t timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
                                              now - startTime)
                                              .count();
+                    uint32_t totalFrames = static_cast<uint32_t>(cap.get(cv::CAP_PROP_FRAME_COUNT));
 
-                    // Write frame to shared memory
-                    g_app->getSharedMemoryHandler()->writeFrame(
-                        rgbaFrame,
-                        frameCount,
-                        static_cast<uint32_t>(cap.get(cv::CAP_PROP_FRAME_COUNT)),
-                        fps,
-                        timestamp);
+                    auto shmHandler = g_app->getSharedMemoryHandler();
+                    if (deltaPublishing)
+                    {
+                        // Only the changed tiles reach shared memory; BGR frames go as decoded
+                        const cv::Mat *published = &frame;
+                        if (rgbaTransport)
+                        {
+                            cv::cvtColor(frame, rgbaFrame, cv::COLOR_BGR2RGBA);
+                            published = &rgbaFrame;
+                        }
+                        shmHandler->writeFrameDelta(*published, frameCount, totalFrames, fps, timestamp, decodeTimeNs);
+                    }
+                    else if (!rgbaTransport)
+                    {
+                        // BGR is copied as decoded; the handler converts to planar YUV straight into the slot
+                        shmHandler->writeFrame(frame, frameCount, totalFrames, fps, timestamp, decodeTimeNs);
+                    }
+                    else
+                    {
+                        // Convert to RGBA straight into the next shared memory slot
+                        cv::Mat slotFrame;
+                        if (shmHandler->beginWrite(slotFrame))
+                        {
+                            cv::cvtColor(frame, slotFrame, cv::COLOR_BGR2RGBA);
+                            shmHandler->commitWrite(frameCount, totalFrames, fps, timestamp, decodeTimeNs);
+                        }
+                    }
 
                     // Process window events and check for key press
                     int key = cv::waitKey(1);
@@ -0,0 +1,148 @@
+#include "sync/shared_fence.hpp"
+#include "utils/logger.hpp"
+#include <stdexcept>
+#include <unistd.h>
+
+namespace vst::sync
+{
+
+    static VkExternalSemaphoreHandleTypeFlagBits toVulkanHandleType(SemaphoreHandleType handleType)
+    {
+        return handleType == SemaphoreHandleType::SyncFd
+                   ? VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_SYNC_FD_BIT
+                   : VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+    }
+
+    SharedFence::~SharedFence()
+    {
+        destroy();
+    }
+
+    bool SharedFence::isSupported(VkPhysicalDevice physicalDevice, SemaphoreHandleType handleType, bool timeline)
+    {
+        // Timeline payloads cannot be snapshotted into a sync_file
+        if (timeline && handleType == SemaphoreHandleType::SyncFd)
+        {
+            return false;
+        }
+
+        VkSemaphoreTypeCreateInfo typeInfo{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+        typeInfo.semaphoreType = timeline ? VK_SEMAPHORE_TYPE_TIMELINE : VK_SEMAPHORE_TYPE_BINARY;
+
+        VkPhysicalDeviceExternalSemaphoreInfo info{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_SEMAPHORE_INFO};
+        info.pNext = &typeInfo;
+        info.handleType = toVulkanHandleType(handleType);
+
+        VkExternalSemaphoreProperties props{VK_STRUCTURE_TYPE_EXTERNAL_SEMAPHORE_PROPERTIES};
+        vkGetPhysicalDeviceExternalSemaphoreProperties(physicalDevice, &info, &props);
+
+        const VkExternalSemaphoreFeatureFlags needed = VK_EXTERNAL_SEMAPHORE_FEATURE_EXPORTABLE_BIT |
+                                                       VK_EXTERNAL_SEMAPHORE_FEATURE_IMPORTABLE_BIT;
+        return (props.externalSemaphoreFeatures & needed) == needed;
+    }
+
+    void SharedFence::createExportable(VkDevice device, SemaphoreHandleType handleType, bool timeline)
+    {
+        create(device, handleType, timeline, true);
+    }
+
+    void SharedFence::createImportable(VkDevice device, SemaphoreHandleType handleType, bool timeline)
+    {
+        create(device, handleType, timeline, false);
+    }
+
+    void SharedFence::create(VkDevice device, SemaphoreHandleType handleType, bool timeline, bool exportable)
+    {
+        destroy();
+
+        m_device = device;
+        m_handleType = handleType;
+        m_timeline = timeline;
+
+        m_getSemaphoreFd = reinterpret_cast<PFN_vkGetSemaphoreFdKHR>(
+            vkGetDeviceProcAddr(device, "vkGetSemaphoreFdKHR"));
+        m_importSemaphoreFd = reinterpret_cast<PFN_vkImportSemaphoreFdKHR>(
+            vkGetDeviceProcAddr(device, "vkImportSemaphoreFdKHR"));
+        if (!m_getSemaphoreFd || !m_importSemaphoreFd)
+        {
+            throw std::runtime_error("VK_KHR_external_semaphore_fd is not enabled on this device.");
+        }
+
+        VkSemaphoreTypeCreateInfo typeInfo{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+        typeInfo.semaphoreType = timeline ? VK_SEMAPHORE_TYPE_TIMELINE : VK_SEMAPHORE_TYPE_BINARY;
+        typeInfo.initialValue = 0;
+
+        VkExportSemaphoreCreateInfo exportInfo{VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO};
+        exportInfo.handleTypes = toVulkanHandleType(handleType);
+
+        VkSemaphoreCreateInfo semInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        if (exportable)
+        {
+            exportInfo.pNext = &typeInfo;
+            semInfo.pNext = &exportInfo;
+        }
+        else
+        {
+            semInfo.pNext = &typeInfo;
+        }
+
+        if (vkCreateSemaphore(device, &semInfo, nullptr, &m_semaphore) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create shared semaphore.");
+        }
+    }
+
+    int SharedFence::exportFd()
+    {
+        if (m_semaphore == VK_NULL_HANDLE)
+        {
+            return -1;
+        }
+
+        VkSemaphoreGetFdInfoKHR getFdInfo{VK_STRUCTURE_TYPE_SEMAPHORE_GET_FD_INFO_KHR};
+        getFdInfo.semaphore = m_semaphore;
+        getFdInfo.handleType = toVulkanHandleType(m_handleType);
+
+        int fd = -1;
+        if (m_getSemaphoreFd(m_device, &getFdInfo, &fd) != VK_SUCCESS)
+        {
+            LOG_ERR("Failed to export semaphore fd");
+            return -1;
+        }
+        return fd;
+    }
+
+    bool SharedFence::importFd(int fd)
+    {
+        if (m_semaphore == VK_NULL_HANDLE)
+        {
+            close(fd);
+            return false;
+        }
+
+        VkImportSemaphoreFdInfoKHR importInfo{VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_FD_INFO_KHR};
+        importInfo.semaphore = m_semaphore;
+        importInfo.handleType = toVulkanHandleType(m_handleType);
+        importInfo.fd = fd;
+        // Sync fds may only be imported temporarily; the payload is consumed by the next wait
+        importInfo.flags = m_handleType == SemaphoreHandleType::SyncFd ? VK_SEMAPHORE_IMPORT_TEMPORARY_BIT : 0;
+
+        if (m_importSemaphoreFd(m_device, &importInfo) != VK_SUCCESS)
+        {
+            LOG_ERR("Failed to import semaphore fd");
+            close(fd);
+            return false;
+        }
+        return true;
+    }
+
+    void SharedFence::destroy()
+    {
+        if (m_semaphore != VK_NULL_HANDLE)
+        {
+            vkDestroySemaphore(m_device, m_semaphore, nullptr);
+            m_semaphore = VK_NULL_HANDLE;
+        }
+    }
+
+} // namespace vst::sync
@@ -0,0 +1,182 @@
+#include "sync/sync_manager.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace vst::sync
+{
+
+    const char *syncModeName(SyncMode mode)
+    {
+        switch (mode)
+        {
+        case SyncMode::TimelineOpaqueFd:
+            return "timeline semaphore (opaque fd)";
+        case SyncMode::BinarySyncFd:
+            return "binary semaphore (sync fd)";
+        default:
+            return "none";
+        }
+    }
+
+    SyncManager::~SyncManager()
+    {
+        destroy();
+    }
+
+    SyncMode SyncManager::initProducer(VkDevice device, VkPhysicalDevice physicalDevice, bool timelineEnabled)
+    {
+        destroy();
+
+        try
+        {
+            if (timelineEnabled && SharedFence::isSupported(physicalDevice, SemaphoreHandleType::OpaqueFd, true))
+            {
+                m_fence.createExportable(device, SemaphoreHandleType::OpaqueFd, true);
+                m_mode = SyncMode::TimelineOpaqueFd;
+            }
+            else if (SharedFence::isSupported(physicalDevice, SemaphoreHandleType::SyncFd, false))
+            {
+                m_fence.createExportable(device, SemaphoreHandleType::SyncFd, false);
+                m_mode = SyncMode::BinarySyncFd;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            LOG_WARN("Shared semaphores unavailable: " << e.what());
+            m_fence.destroy();
+            m_mode = SyncMode::None;
+        }
+
+        LOG_INFO("Upload synchronisation: " << syncModeName(m_mode));
+        return m_mode;
+    }
+
+    uint64_t SyncManager::nextSignalValue()
+    {
+        return m_mode == SyncMode::TimelineOpaqueFd ? ++m_value : 0;
+    }
+
+    int SyncManager::exportSemaphoreFd()
+    {
+        return m_mode == SyncMode::TimelineOpaqueFd ? m_fence.exportFd() : -1;
+    }
+
+    int SyncManager::exportFrameFd()
+    {
+        if (m_mode != SyncMode::BinarySyncFd)
+        {
+            return -1;
+        }
+
+        int fd = m_fence.exportFd();
+        if (fd < 0)
+        {
+            // The semaphore may still be signalled, so it must not be signalled again
+            LOG_WARN("Disabling shared semaphores after a failed sync fd export");
+            m_fence.destroy();
+            m_mode = SyncMode::None;
+        }
+        return fd;
+    }
+
+    bool SyncManager::initConsumer(VkDevice device, VkPhysicalDevice physicalDevice, SyncMode mode, int semaphoreFd,
+                                   bool timelineEnabled)
+    {
+        destroy();
+
+        bool timeline = mode == SyncMode::TimelineOpaqueFd;
+        SemaphoreHandleType handleType = timeline ? SemaphoreHandleType::OpaqueFd : SemaphoreHandleType::SyncFd;
+        if (mode == SyncMode::None || (timeline && !timelineEnabled) ||
+            !SharedFence::isSupported(physicalDevice, handleType, timeline))
+        {
+            if (semaphoreFd >= 0)
+                close(semaphoreFd);
+            if (mode != SyncMode::None)
+                LOG_WARN("Producer uses " << syncModeName(mode) << ", which this device cannot import");
+            return false;
+        }
+
+        try
+        {
+            m_fence.createImportable(device, handleType, timeline);
+        }
+        catch (const std::exception &e)
+        {
+            LOG_WARN("Shared semaphores unavailable: " << e.what());
+            if (semaphoreFd >= 0)
+                close(semaphoreFd);
+            return false;
+        }
+
+        // The timeline semaphore is imported once; sync fds arrive with each frame
+        if (timeline && !m_fence.importFd(semaphoreFd))
+        {
+            m_fence.destroy();
+            return false;
+        }
+
+        m_mode = mode;
+        LOG_INFO("Waiting on producer uploads with a " << syncModeName(m_mode));
+        return true;
+    }
+
+    void SyncManager::onFrameReady(uint64_t signalValue, int frameFd)
+    {
+        if (m_mode == SyncMode::TimelineOpaqueFd)
+        {
+            m_value = std::max(m_value, signalValue);
+        }
+
+        if (m_mode == SyncMode::BinarySyncFd && frameFd >= 0)
+        {
+            // Only the newest frame is drawn, so only its signal needs waiting on
+            if (m_pendingFd >= 0)
+                close(m_pendingFd);
+            m_pendingFd = frameFd;
+        }
+        else if (frameFd >= 0)
+        {
+            close(frameFd);
+        }
+    }
+
+    bool SyncManager::acquireWait(VkSemaphore &semaphore, uint64_t &value)
+    {
+        if (m_mode == SyncMode::TimelineOpaqueFd && m_value > 0)
+        {
+            // Waiting again on a value already reached costs nothing
+            semaphore = m_fence.get();
+            value = m_value;
+            return true;
+        }
+
+        if (m_mode == SyncMode::BinarySyncFd && m_pendingFd >= 0)
+        {
+            int fd = m_pendingFd;
+            m_pendingFd = -1;
+            if (m_fence.importFd(fd))
+            {
+                semaphore = m_fence.get();
+                value = 0;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void SyncManager::destroy()
+    {
+        if (m_pendingFd >= 0)
+        {
+            close(m_pendingFd);
+            m_pendingFd = -1;
+        }
+        m_fence.destroy();
+        m_mode = SyncMode::None;
+        m_value = 0;
+    }
+
+} // namespace vst::sync
@@ -1,11 +1,20 @@
 // benchmark.cpp
 #include "tools/benchmark.hpp"
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
+#include <time.h>
 
 namespace vst
 {
 
+    uint64_t monotonicNowNs()
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+    }
+
     void Timer::start()
     {
         startTime = std::chrono::high_resolution_clock::now();
@@ -21,6 +30,52 @@ namespace vst
         return std::chrono::duration<double, std::milli>(endTime - startTime).count();
     }
 
+    LatencyHistogram::LatencyHistogram(size_t windowSize)
+        : windowSize(std::max<size_t>(windowSize, 1))
+    {
+        samples.reserve(this->windowSize);
+    }
+
+    void LatencyHistogram::record(double milliseconds)
+    {
+        // Overwrite the oldest sample once the window is full
+        if (samples.size() < windowSize)
+        {
+            samples.push_back(milliseconds);
+        }
+        else
+        {
+            samples[next] = milliseconds;
+        }
+        next = (next + 1) % windowSize;
+    }
+
+    void LatencyHistogram::recordNs(uint64_t startNs, uint64_t endNs)
+    {
+        // Missing or out-of-order stamps are not latencies
+        if (startNs == 0 || endNs < startNs)
+            return;
+        record(static_cast<double>(endNs - startNs) / 1e6);
+    }
+
+    double LatencyHistogram::percentile(double percentile) const
+    {
+        if (samples.empty())
+            return 0.0;
+
+        std::vector<double> sorted(samples);
+        double clamped = std::min(std::max(percentile, 0.0), 100.0);
+        size_t rank = static_cast<size_t>(clamped / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+
+    void LatencyHistogram::reset()
+    {
+        samples.clear();
+        next = 0;
+    }
+
     BenchmarkLogger::BenchmarkLogger(const std::string &filename)
     {
         file.open(filename, std::ios::out);
@@ -37,6 +92,15 @@ namespace vst
         entries.push_back(entry.str());
     }
 
+    void BenchmarkLogger::logPercentiles(const std::string &label, const LatencyHistogram &histogram)
+    {
+        if (histogram.count() == 0)
+            return;
+        log(label + "_p50", histogram.percentile(50.0));
+        log(label + "_p99", histogram.percentile(99.0));
+        log(label + "_p999", histogram.percentile(99.9));
+    }
+
     void BenchmarkLogger::flush()
     {
         if (!file.is_open())
@@ -90,18 +90,26 @@ namespace vst::utils
 
     std::optional<std::string> findLatestVideoShmFile()
     {
-        std::string basePath = "/dev/shm";
         std::regex videoPattern("vst_shared_video-(\\d+)x(\\d+)");
         std::vector<fs::directory_entry> matches;
 
         try
         {
-            for (const auto &entry : fs::directory_iterator(basePath))
+            // Huge-page backed segments live on hugetlbfs instead of /dev/shm
+            for (const char *basePath : {"/dev/shm", "/dev/hugepages"})
             {
-                std::string filename = entry.path().filename().string();
-                if (std::regex_match(filename, videoPattern))
+                if (!fs::is_directory(basePath))
                 {
-                    matches.push_back(entry);
+                    continue;
+                }
+
+                for (const auto &entry : fs::directory_iterator(basePath))
+                {
+                    std::string filename = entry.path().filename().string();
+                    if (std::regex_match(filename, videoPattern))
+                    {
+                        matches.push_back(entry);
+                    }
                 }
             }
         }
@@ -161,23 +169,24 @@ namespace vst::utils
     {
         SharedResource resource;
 
-        // Check for SHM video first
-        const std::regex shmVideoPattern("vst_shared_video-(\\d+)x(\\d+)");
-        for (const auto &entry : std::filesystem::directory_iterator("/dev/shm"))
+        // Check for memfd SHM video first; its socket is the only trace it leaves
+        const std::regex memfdVideoPattern("vst_memfd_video-(\\d+)x(\\d+).sock");
+        for (const auto &entry : std::filesystem::directory_iterator("/tmp"))
         {
             const std::string name = entry.path().filename().string();
-            if (std::regex_match(name, shmVideoPattern))
+            if (std::regex_match(name, memfdVideoPattern))
             {
-                resource.path = entry.path().string();
+                resource.path = "/tmp/" + name;
                 resource.mode = "shm";
                 resource.type = "video";
+                resource.viaSocket = true;
 
-                // Extract dimensions from filename
                 try
                 {
                     resource.dimensions = parseImageDimensions(name);
-                    std::cout << "Found shared video via SHM: " << name + " (" + std::to_string(resource.dimensions.width) + "x" + 
-                                        std::to_string(resource.dimensions.height) + ")" << "\n";
+                    std::cout << "Found shared video via memfd: " + name +
+                                     " (" + std::to_string(resource.dimensions.width) + "x" +
+                                     std::to_string(resource.dimensions.height) + ")" << "\n";
                     return resource;
                 }
                 catch (const std::exception &e)
@@ -187,6 +196,40 @@ namespace vst::utils
             }
         }
 
+        // Then named SHM video, including huge-page backed segments on hugetlbfs
+        const std::regex shmVideoPattern("vst_shared_video-(\\d+)x(\\d+)");
+        for (const char *videoDir : {"/dev/shm", "/dev/hugepages"})
+        {
+            if (!fs::is_directory(videoDir))
+            {
+                continue;
+            }
+
+            for (const auto &entry : std::filesystem::directory_iterator(videoDir))
+            {
+                const std::string name = entry.path().filename().string();
+                if (std::regex_match(name, shmVideoPattern))
+                {
+                    resource.path = entry.path().string();
+                    resource.mode = "shm";
+                    resource.type = "video";
+
+                    // Extract dimensions from filename
+                    try
+                    {
+                        resource.dimensions = parseImageDimensions(name);
+                        std::cout << "Found shared video via SHM: " << name + " (" + std::to_string(resource.dimensions.width) + "x" + 
+                                            std::to_string(resource.dimensions.height) + ")" << "\n";
+                        return resource;
+                    }
+                    catch (const std::exception &e)
+                    {
+                        std::cout << "Error parsing dimensions: " + std::string(e.what()) << "\n";
+                    }
+                }
+            }
+        }
+
         // Check for SHM image
         const std::regex shmImagePattern("vst_shared_texture-(\\d+)x(\\d+)");
         for (const auto &entry : std::filesystem::directory_iterator("/dev/shm"))
@@ -270,6 +313,33 @@ namespace vst::utils
             }
         }
 
+        // Check for DMA-BUF heap sockets, image or video
+        const std::regex heapPattern("vulkan_heap_(image|video)-(\\d+)x(\\d+).sock");
+        for (const auto &entry : std::filesystem::directory_iterator("/tmp"))
+        {
+            const std::string name = entry.path().filename().string();
+            std::smatch match;
+            if (std::regex_match(name, match, heapPattern))
+            {
+                resource.path = "/tmp/" + name;
+                resource.mode = "heap";
+                resource.type = match[1].str();
+
+                try
+                {
+                    resource.dimensions = parseImageDimensions(name);
+                    std::cout << "Found shared " + resource.type + " via DMA-BUF heap: " + name +
+                                     " (" + std::to_string(resource.dimensions.width) + "x" +
+                                     std::to_string(resource.dimensions.height) + ")" << "\n";
+                    return resource;
+                }
+                catch (const std::exception &e)
+                {
+                    std::cout << "Error parsing dimensions: " + std::string(e.what()) << "\n";
+                }
+            }
+        }
+
         // Nothing found
         return std::nullopt;
     }
@@ -18,10 +18,14 @@ namespace vst::utils
 
         const std::string &path = pathOpt->path;
 
-        if (path.find("/dev/shm/") == 0)
+        if (path.find("/dev/shm/") == 0 || path.find("/dev/hugepages/") == 0 || path.find("/tmp/vst_memfd_") == 0)
         {
             return "shm";
         }
+        else if (path.find("/tmp/vulkan_heap_") == 0)
+        {
+            return "heap";
+        }
         else if (path.find("/tmp/") == 0)
         {
             return "dma";
@@ -0,0 +1,344 @@
+// Checks the compute colour conversion against OpenCV: small BGR24, NV12 and
+// I420 frames, tightly packed and with rows padded as in an SHM video slot,
+// are expanded by ColorConvertPipeline into an RGBA8 storage image, read back
+// and compared with cv::cvtColor. Needs no window, e.g. runs on lavapipe.
+#include "core/vulkan_device.hpp"
+#include "core/vulkan_utils.hpp"
+#include "core/color_convert_pipeline.hpp"
+#include "utils/logger.hpp"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <cstring>
+#include <stdexcept>
+
+using namespace vst;
+
+// Not a multiple of the 16x16 workgroup, so partial groups are covered; even for the chroma planes
+static constexpr uint32_t kWidth = 34;
+static constexpr uint32_t kHeight = 18;
+
+// Row stride of the padded frames; wider than a BGR24 row and even, like a cache-line padded SHM row
+static constexpr uint32_t kPaddedStride = 128;
+
+// The shader converts in float, OpenCV in fixed point
+static constexpr double kTolerance = 2.0;
+
+// Everything one conversion needs: a host-visible source buffer, the RGBA8
+// storage image the shader writes and a host-visible buffer to read it back
+struct ConvertTarget
+{
+    VkBuffer source = VK_NULL_HANDLE;
+    VkDeviceMemory sourceMemory = VK_NULL_HANDLE;
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkBuffer readback = VK_NULL_HANDLE;
+    VkDeviceMemory readbackMemory = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+};
+
+// Instance without surface extensions; the test never presents
+static VkInstance createInstance()
+{
+    VkApplicationInfo appInfo{VK_STRUCTURE_TYPE_APPLICATION_INFO};
+    appInfo.pApplicationName = "color_convert_test";
+    appInfo.apiVersion = VK_API_VERSION_1_3;
+
+    VkInstanceCreateInfo createInfo{VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+    createInfo.pApplicationInfo = &appInfo;
+
+    VkInstance instance = VK_NULL_HANDLE;
+    if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create Vulkan instance.");
+    }
+    return instance;
+}
+
+static void createTarget(VulkanDevice &vulkanDevice, const ColorConvertPipeline &converter, ConvertTarget &target)
+{
+    VkDevice device = vulkanDevice.getDevice();
+    VkPhysicalDevice physicalDevice = vulkanDevice.getPhysicalDevice();
+    const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    // Sized for padded BGR24, the largest source frame
+    vulkan_utils::createBuffer(device, physicalDevice, static_cast<VkDeviceSize>(kPaddedStride) * kHeight,
+                               target.source, target.sourceMemory, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible);
+    vulkan_utils::createBuffer(device, physicalDevice, static_cast<VkDeviceSize>(kWidth) * kHeight * 4,
+                               target.readback, target.readbackMemory, VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostVisible);
+
+    VkImageCreateInfo imageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    imageInfo.extent = {kWidth, kHeight, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(device, &imageInfo, nullptr, &target.image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the conversion target image.");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, target.image, &memRequirements);
+    VkMemoryAllocateInfo allocInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = vulkan_utils::findMemoryType(physicalDevice, memRequirements.memoryTypeBits,
+                                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &target.imageMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate the conversion target memory.");
+    }
+    vkBindImageMemory(device, target.image, target.imageMemory, 0);
+    target.view = vulkan_utils::createImageView(device, target.image);
+
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = 1;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &target.descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create descriptor pool.");
+    }
+
+    VkDescriptorSetLayout setLayout = converter.getDescriptorSetLayout();
+    VkDescriptorSetAllocateInfo setInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    setInfo.descriptorPool = target.descriptorPool;
+    setInfo.descriptorSetCount = 1;
+    setInfo.pSetLayouts = &setLayout;
+    if (vkAllocateDescriptorSets(device, &setInfo, &target.descriptorSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate descriptor set.");
+    }
+    converter.updateDescriptorSet(device, target.descriptorSet, target.source, target.view);
+
+    // The graphics family always supports compute and transfer
+    VkCommandPoolCreateInfo commandPoolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    commandPoolInfo.queueFamilyIndex = static_cast<uint32_t>(vulkanDevice.getQueueFamilies().graphicsFamily);
+    if (vkCreateCommandPool(device, &commandPoolInfo, nullptr, &target.commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create command pool.");
+    }
+}
+
+static void destroyTarget(VkDevice device, ConvertTarget &target)
+{
+    vkDestroyCommandPool(device, target.commandPool, nullptr);
+    vkDestroyDescriptorPool(device, target.descriptorPool, nullptr);
+    vkDestroyImageView(device, target.view, nullptr);
+    vkDestroyImage(device, target.image, nullptr);
+    vkFreeMemory(device, target.imageMemory, nullptr);
+    vkDestroyBuffer(device, target.readback, nullptr);
+    vkFreeMemory(device, target.readbackMemory, nullptr);
+    vkDestroyBuffer(device, target.source, nullptr);
+    vkFreeMemory(device, target.sourceMemory, nullptr);
+    target = ConvertTarget{};
+}
+
+static void imageBarrier(VkCommandBuffer cmd, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                         VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                         VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+// Bytes a frame of format occupies with rows rowStride apart
+static size_t paddedSize(SourceFormat format, uint32_t rowStride)
+{
+    size_t rows = format == SourceFormat::BGR24 ? kHeight : kHeight * 3 / 2;
+    return rows * rowStride;
+}
+
+// Copies a tightly packed frame into rows rowStride apart, with the chroma
+// rows of I420 at half that stride, as ShmVideoHandler lays out a slot
+static cv::Mat padRows(const cv::Mat &tight, SourceFormat format, uint32_t rowStride)
+{
+    cv::Mat padded = cv::Mat::zeros(1, static_cast<int>(paddedSize(format, rowStride)), CV_8UC1);
+    uint8_t *dst = padded.data;
+    const uint8_t *src = tight.data;
+
+    uint32_t rowBytes = format == SourceFormat::BGR24 ? kWidth * 3 : kWidth;
+    for (uint32_t y = 0; y < kHeight; ++y)
+    {
+        std::memcpy(dst + y * rowStride, src + y * rowBytes, rowBytes);
+    }
+    if (format == SourceFormat::BGR24)
+    {
+        return padded;
+    }
+
+    // NV12 has height / 2 UV rows as wide as the luma; I420 has height / 2 U rows, then as many V rows
+    dst += static_cast<size_t>(rowStride) * kHeight;
+    src += static_cast<size_t>(kWidth) * kHeight;
+    bool nv12 = format == SourceFormat::NV12;
+    uint32_t chromaRows = nv12 ? kHeight / 2 : kHeight;
+    uint32_t chromaBytes = nv12 ? kWidth : kWidth / 2;
+    uint32_t chromaStride = nv12 ? rowStride : rowStride / 2;
+    for (uint32_t y = 0; y < chromaRows; ++y)
+    {
+        std::memcpy(dst + y * chromaStride, src + y * chromaBytes, chromaBytes);
+    }
+    return padded;
+}
+
+// Runs one conversion of source (raw bytes of the given format) and returns the RGBA8 result
+static cv::Mat convert(VulkanDevice &vulkanDevice, const ColorConvertPipeline &converter, ConvertTarget &target,
+                       SourceFormat format, const cv::Mat &source, uint32_t rowStride = 0)
+{
+    VkDevice device = vulkanDevice.getDevice();
+    VkDeviceSize sourceSize = rowStride ? paddedSize(format, rowStride)
+                                        : ColorConvertPipeline::sourceSize(format, kWidth, kHeight);
+    if (!source.isContinuous() || source.total() * source.elemSize() != sourceSize)
+    {
+        throw std::runtime_error("Source frame does not match the conversion format.");
+    }
+
+    void *mapped = nullptr;
+    vkMapMemory(device, target.sourceMemory, 0, sourceSize, 0, &mapped);
+    std::memcpy(mapped, source.data, sourceSize);
+    vkUnmapMemory(device, target.sourceMemory);
+
+    VkCommandBufferAllocateInfo allocInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    allocInfo.commandPool = target.commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &cmd) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate command buffer.");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cmd, &beginInfo);
+
+    imageBarrier(cmd, target.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    converter.record(cmd, target.descriptorSet, format, kWidth, kHeight, rowStride);
+    imageBarrier(cmd, target.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {kWidth, kHeight, 1};
+    vkCmdCopyImageToBuffer(cmd, target.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target.readback, 1, &region);
+
+    VkMemoryBarrier hostBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+
+    vkEndCommandBuffer(cmd);
+
+    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmd;
+    if (vkQueueSubmit(vulkanDevice.getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit the conversion.");
+    }
+    vkQueueWaitIdle(vulkanDevice.getGraphicsQueue());
+    vkFreeCommandBuffers(device, target.commandPool, 1, &cmd);
+
+    vkMapMemory(device, target.readbackMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+    cv::Mat rgba = cv::Mat(kHeight, kWidth, CV_8UC4, mapped).clone();
+    vkUnmapMemory(device, target.readbackMemory);
+    return rgba;
+}
+
+static bool check(const char *name, const cv::Mat &actual, const cv::Mat &expected)
+{
+    double maxDiff = cv::norm(actual, expected, cv::NORM_INF);
+    if (maxDiff > kTolerance)
+    {
+        LOG_ERR(name << ": max channel difference " << maxDiff << " exceeds " << kTolerance);
+        return false;
+    }
+    LOG_INFO(name << ": max channel difference " << maxDiff);
+    return true;
+}
+
+int main()
+{
+    VkInstance instance = VK_NULL_HANDLE;
+    bool passed = true;
+    try
+    {
+        instance = createInstance();
+        VulkanDevice device;
+        device.pickPhysicalDevice(instance, false);
+        device.createLogicalDevice();
+
+        ColorConvertPipeline converter;
+        converter.create(device.getDevice());
+        ConvertTarget target;
+        createTarget(device, converter, target);
+
+        cv::RNG rng(0x5eed);
+
+        cv::Mat bgr(kHeight, kWidth, CV_8UC3);
+        rng.fill(bgr, cv::RNG::UNIFORM, 0, 256);
+        cv::Mat expected;
+        cv::cvtColor(bgr, expected, cv::COLOR_BGR2RGBA);
+        passed &= check("BGR24", convert(device, converter, target, SourceFormat::BGR24, bgr), expected);
+        passed &= check("BGR24 padded", convert(device, converter, target, SourceFormat::BGR24,
+                                                padRows(bgr, SourceFormat::BGR24, kPaddedStride), kPaddedStride),
+                        expected);
+
+        // Planar YUV: height * 3 / 2 rows of one byte per sample
+        cv::Mat yuv(kHeight * 3 / 2, kWidth, CV_8UC1);
+        rng.fill(yuv, cv::RNG::UNIFORM, 0, 256);
+
+        cv::cvtColor(yuv, expected, cv::COLOR_YUV2RGBA_NV12);
+        passed &= check("NV12", convert(device, converter, target, SourceFormat::NV12, yuv), expected);
+        passed &= check("NV12 padded", convert(device, converter, target, SourceFormat::NV12,
+                                               padRows(yuv, SourceFormat::NV12, kPaddedStride), kPaddedStride),
+                        expected);
+
+        cv::cvtColor(yuv, expected, cv::COLOR_YUV2RGBA_I420);
+        passed &= check("I420", convert(device, converter, target, SourceFormat::I420, yuv), expected);
+        passed &= check("I420 padded", convert(device, converter, target, SourceFormat::I420,
+                                               padRows(yuv, SourceFormat::I420, kPaddedStride), kPaddedStride),
+                        expected);
+
+        destroyTarget(device.getDevice(), target);
+        converter.cleanup(device.getDevice());
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERR("Colour conversion test failed: " << e.what());
+        passed = false;
+    }
+
+    // The device is destroyed with its VulkanDevice, before the instance
+    if (instance != VK_NULL_HANDLE)
+    {
+        vkDestroyInstance(instance, nullptr);
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// Smoke test for the headless VulkanContext: renders a few frames of a video
+// texture offscreen and tears everything down again. Runs on any Vulkan 1.3
+// driver, including lavapipe (VK_DRIVER_FILES=.../lvp_icd.x86_64.json).
+#include "core/vulkan_context.hpp"
+#include "core/vulkan_utils.hpp"
+#include "core/descriptor_manager.hpp"
+#include "core/pipeline.hpp"
+#include "core/vertex_definitions.hpp"
+#include "media/texture_image.hpp"
+#include "media/texture_video.hpp"
+#include "utils/logger.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace vst;
+
+static constexpr uint32_t kWidth = 64;
+static constexpr uint32_t kHeight = 64;
+static constexpr int kFrames = 5;
+
+int main()
+{
+    VulkanContext context;
+    try
+    {
+        context.initHeadless(kWidth, kHeight);
+        VkDevice device = context.getDevice();
+
+        TextureVideo texture(context);
+        if (!texture.createFromSize(kWidth, kHeight))
+        {
+            throw std::runtime_error("Failed to create video texture.");
+        }
+        texture.updateFromFrame(cv::Mat(kHeight, kWidth, CV_8UC3, cv::Scalar(255, 128, 0)));
+
+        VkDescriptorPoolSize poolSize{};
+        poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        poolSize.descriptorCount = 1;
+        VkDescriptorPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        poolInfo.maxSets = 1;
+        VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create descriptor pool.");
+        }
+
+        TextureImage textureView;
+        textureView.image = texture.getImage();
+        textureView.memory = texture.getMemory();
+        textureView.view = texture.getImageView();
+        textureView.sampler = texture.getSampler();
+        textureView.width = kWidth;
+        textureView.height = kHeight;
+
+        DescriptorManager descriptors;
+        descriptors.init(device, descriptorPool, textureView);
+
+        Pipeline pipeline;
+        pipeline.create(device, context.getSwapchainExtent(), context.getRenderPass(), descriptors.getLayout(),
+                        context.getPipelineCache());
+
+        VkBuffer vertexBuffer = VK_NULL_HANDLE;
+        memory::Allocation vertexAllocation;
+        VkDeviceSize vertexSize = sizeof(Vertex) * FULLSCREEN_QUAD.size();
+        vulkan_utils::createBuffer(context.getAllocator(), vertexSize, vertexBuffer, vertexAllocation,
+                                   VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        memcpy(vertexAllocation.mapped, FULLSCREEN_QUAD.data(), static_cast<size_t>(vertexSize));
+
+        // More frames than kMaxFramesInFlight, so the in-flight fences are waited on and reused
+        for (int i = 0; i < kFrames; ++i)
+        {
+            context.drawFrame(pipeline.get(), pipeline.getLayout(), descriptors.getDescriptorSet(), vertexBuffer);
+        }
+
+        vkDeviceWaitIdle(device);
+        vulkan_utils::destroyBuffer(context.getAllocator(), vertexBuffer, vertexAllocation);
+        pipeline.cleanup(device);
+        descriptors.cleanup(device);
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        texture.destroy();
+
+        context.cleanup();
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERR("Headless context test failed: " << e.what());
+        return 1;
+    }
+
+    LOG_INFO("Headless context test passed: " << kFrames << " frames at " << kWidth << "x" << kHeight);
+    return 0;
+}
@@ -0,0 +1,487 @@
+// CPU-only tests of the shared video ring: seqlock reads under a concurrent
+// writer, read leases (also of a reader that crashes), the backpressure
+// policies and delta publishing. The producer and consumers are separate
+// handlers in one process, each with its own mapping of the segment, as they
+// would be in separate processes; the crashed reader is a forked child.
+#include "memory/shm_video_handler.hpp"
+#include "utils/logger.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace vst::memory;
+
+#define CHECK(cond)                                                        \
+    do                                                                     \
+    {                                                                      \
+        if (!(cond))                                                       \
+        {                                                                  \
+            LOG_ERR(__FILE__ << ":" << __LINE__ << ": check failed: " #cond); \
+            return false;                                                  \
+        }                                                                  \
+    } while (0)
+
+static std::string segmentName(const char *test)
+{
+    return "vst_test_" + std::to_string(getpid()) + "_" + test;
+}
+
+// Gray8 frame with every pixel set to value
+static cv::Mat solidFrame(uint32_t width, uint32_t height, uint8_t value)
+{
+    return cv::Mat(static_cast<int>(height), static_cast<int>(width), CV_8UC1, cv::Scalar(value));
+}
+
+static bool isSolid(const cv::Mat &frame, uint8_t value)
+{
+    return !frame.empty() && cv::countNonZero(frame != value) == 0;
+}
+
+// A reader racing a writer must only ever see whole frames
+static bool testTornReads()
+{
+    const std::string name = segmentName("torn");
+    const uint32_t width = 640, height = 480;
+    const uint32_t frames = 2000;
+
+    ShmVideoHandler producer;
+    CHECK(producer.createSharedMemory(name, width, height, ShmPixelFormat::Gray8, 2, BackpressurePolicy::LatestOnly));
+    CHECK(producer.writeFrame(solidFrame(width, height, 0), 0, frames, 30.0, 0));
+
+    ShmVideoHandler consumer;
+    CHECK(consumer.openSharedMemory(name));
+
+    std::atomic<bool> done(false);
+    std::thread writer([&]()
+    {
+        // Two slots keep the writer on the slot readers are most likely to be in
+        for (uint32_t i = 1; i < frames; ++i)
+        {
+            producer.writeFrame(solidFrame(width, height, static_cast<uint8_t>(i)), i, frames, 30.0, i);
+        }
+        done = true;
+    });
+
+    int copies = 0, leases = 0, torn = 0;
+    cv::Mat frame;
+    ShmVideoFrameLease lease;
+    do
+    {
+        // Copies are retried when the slot changes underneath them, and fail rather than tear
+        if (consumer.readFrame(frame, false))
+        {
+            ++copies;
+            torn += !isSolid(frame, frame.at<uint8_t>(0, 0));
+        }
+
+        // A leased slot is never written, so its pixels must match its metadata
+        if (consumer.acquireFrame(lease, false))
+        {
+            ++leases;
+            torn += !isSolid(lease.frame(), static_cast<uint8_t>(lease.frameIndex()));
+            lease.release();
+        }
+    } while (!done);
+    writer.join();
+
+    LOG_INFO("Torn reads: " << copies << " copies, " << leases << " leases, " << torn << " torn");
+    CHECK(torn == 0);
+    CHECK(copies > 0 && leases > 0);
+
+    consumer.closeSharedMemory();
+    producer.closeSharedMemory();
+    ShmVideoHandler::removeSharedMemory(name);
+    return true;
+}
+
+// The producer skips pinned slots, and gives up rather than overwrite one
+static bool testPinnedSlots()
+{
+    const std::string name = segmentName("pinned");
+    const uint32_t width = 64, height = 64;
+
+    ShmVideoHandler producer;
+    CHECK(producer.createSharedMemory(name, width, height, ShmPixelFormat::Gray8, 3, BackpressurePolicy::LatestOnly));
+    ShmVideoHandler consumer;
+    CHECK(consumer.openSharedMemory(name));
+
+    ShmVideoFrameLease first;
+    CHECK(producer.writeFrame(solidFrame(width, height, 1), 1, 0, 30.0, 0));
+    CHECK(consumer.tryAcquireFrame(first));
+    CHECK(first.frameIndex() == 1);
+
+    // Frames 2 to 9 rotate through the two slots that are not pinned
+    for (uint32_t i = 2; i < 10; ++i)
+    {
+        CHECK(producer.writeFrame(solidFrame(width, height, static_cast<uint8_t>(i)), i, 0, 30.0, 0));
+    }
+    CHECK(isSolid(first.frame(), 1));
+
+    // Pin the latest frame as well: the only other slot takes frame 10, then nothing is free
+    ShmVideoFrameLease second;
+    CHECK(consumer.tryAcquireFrame(second));
+    CHECK(second.frameIndex() == 9);
+    CHECK(producer.writeFrame(solidFrame(width, height, 10), 10, 0, 30.0, 0));
+    CHECK(!producer.writeFrame(solidFrame(width, height, 11), 11, 0, 30.0, 0));
+    CHECK(isSolid(first.frame(), 1));
+    CHECK(isSolid(second.frame(), 9));
+
+    // Releasing a lease frees its slot again
+    const uint8_t *released = first.data();
+    first.release();
+    CHECK(producer.writeFrame(solidFrame(width, height, 11), 11, 0, 30.0, 0));
+    ShmVideoFrameLease third;
+    CHECK(consumer.tryAcquireFrame(third));
+    CHECK(third.frameIndex() == 11 && third.data() == released);
+    CHECK(isSolid(third.frame(), 11));
+    CHECK(isSolid(second.frame(), 9));
+
+    third.release();
+    second.release();
+    consumer.closeSharedMemory();
+    producer.closeSharedMemory();
+    ShmVideoHandler::removeSharedMemory(name);
+    return true;
+}
+
+// A reader that dies holding a lease must not keep its slot pinned forever
+static bool testCrashedReader()
+{
+    const std::string name = segmentName("crashed");
+    const uint32_t width = 64, height = 64;
+
+    ShmVideoHandler producer;
+    CHECK(producer.createSharedMemory(name, width, height, ShmPixelFormat::Gray8, 2, BackpressurePolicy::LatestOnly));
+    CHECK(producer.writeFrame(solidFrame(width, height, 1), 1, 0, 30.0, 0));
+
+    int ready[2];
+    CHECK(pipe(ready) == 0);
+    pid_t child = fork();
+    CHECK(child >= 0);
+    if (child == 0)
+    {
+        // Pin frame 1, report, then wait to be killed without releasing anything
+        ShmVideoHandler consumer;
+        ShmVideoFrameLease lease;
+        char pinned = consumer.openSharedMemory(name) && consumer.tryAcquireFrame(lease) ? 1 : 0;
+        if (write(ready[1], &pinned, 1) != 1)
+        {
+            _exit(1);
+        }
+        while (true)
+        {
+            pause();
+        }
+    }
+
+    close(ready[1]);
+    char pinned = 0;
+    bool reported = read(ready[0], &pinned, 1) == 1;
+    close(ready[0]);
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+    CHECK(reported && pinned == 1);
+
+    // Frame 2 takes the other slot; frame 3 needs the slot the dead reader pinned
+    CHECK(producer.writeFrame(solidFrame(width, height, 2), 2, 0, 30.0, 0));
+    CHECK(producer.writeFrame(solidFrame(width, height, 3), 3, 0, 30.0, 0));
+
+    ShmVideoHandler consumer;
+    CHECK(consumer.openSharedMemory(name));
+    ShmVideoFrameLease lease;
+    CHECK(consumer.tryAcquireFrame(lease));
+    CHECK(lease.frameIndex() == 3 && isSolid(lease.frame(), 3));
+
+    lease.release();
+    consumer.closeSharedMemory();
+    producer.closeSharedMemory();
+    ShmVideoHandler::removeSharedMemory(name);
+    return true;
+}
+
+// Frames the slot cannot hold as they are are rejected rather than written elsewhere
+static bool testFrameTypes()
+{
+    const std::string name = segmentName("types");
+    const uint32_t width = 64, height = 64;
+
+    ShmVideoHandler producer;
+    CHECK(producer.createSharedMemory(name, width, height, ShmPixelFormat::Gray8, 3, BackpressurePolicy::LatestOnly));
+    ShmVideoHandler consumer;
+    CHECK(consumer.openSharedMemory(name));
+
+    cv::Mat wide(static_cast<int>(height), static_cast<int>(width), CV_16UC1, cv::Scalar(1));
+    CHECK(!producer.writeFrame(wide, 1, 0, 30.0, 0));
+    cv::Mat colour(static_cast<int>(height), static_cast<int>(width), CV_8UC3, cv::Scalar(1, 1, 1));
+    CHECK(!producer.writeFrame(colour, 1, 0, 30.0, 0));
+
+    ShmVideoFrameLease lease;
+    CHECK(!consumer.tryAcquireFrame(lease));
+    CHECK(producer.writeFrame(solidFrame(width, height, 2), 2, 0, 30.0, 0));
+    CHECK(consumer.tryAcquireFrame(lease));
+    CHECK(lease.frameIndex() == 2 && isSolid(lease.frame(), 2));
+
+    lease.release();
+    consumer.closeSharedMemory();
+    producer.closeSharedMemory();
+    ShmVideoHandler::removeSharedMemory(name);
+    return true;
+}
+
+// Writes frames first to last, each filled with its index
+static bool writeFrames(ShmVideoHandler &producer, uint32_t first, uint32_t last, uint32_t width, uint32_t height)
+{
+    for (uint32_t i = first; i <= last; ++i)
+    {
+        if (!producer.writeFrame(solidFrame(width, height, static_cast<uint8_t>(i)), i, 0, 30.0, 0))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// LatestOnly readers jump to the newest frame; DropOldest readers take every frame still in the ring, in order
+static bool testReaderCursors()
+{
+    const uint32_t width = 64, height = 64;
+    ShmVideoFrameLease lease;
+
+    {
+        const std::string name = segmentName("latest");
+        ShmVideoHandler producer;
+        CHECK(producer.createSharedMemory(name, width, height, ShmPixelFormat::Gray8, 4, BackpressurePolicy::LatestOnly));
+        ShmVideoHandler consumer;
+        CHECK(consumer.openSharedMemory(name));
+
+        CHECK(writeFrames(producer, 1, 3, width, height));
+        CHECK(consumer.tryAcquireFrame(lease));
+        CHECK(lease.frameIndex() == 3 && lease.frameSeq() == 3);
+        CHECK(!consumer.tryAcquireFrame(lease));
+
+        CHECK(writeFrames(producer, 4, 5, width, height));
+        CHECK(consumer.tryAcquireFrame(lease));
+        CHECK(lease.frameIndex() == 5 && isSolid(lease.frame(), 5));
+        CHECK(!consumer.tryAcquireFrame(lease));
+
+        lease.release();
+        consumer.closeSharedMemory();
+        producer.closeSharedMemory();
+        ShmVideoHandler::removeSharedMemory(name);
+    }
+
+    {
+        const std::string name = segmentName("drop_oldest");
+        ShmVideoHandler producer;
+        CHECK(producer.createSharedMemory(name, width, height, ShmPixelFormat::Gray8, 4, BackpressurePolicy::DropOldest));
+        ShmVideoHandler consumer;
+        CHECK(consumer.openSharedMemory(name));
+
+        CHECK(writeFrames(producer, 1, 3, width, height));
+        for (uint32_t i = 1; i <= 3; ++i)
+        {
+            CHECK(consumer.tryAcquireFrame(lease));
+            CHECK(lease.frameIndex() == i && isSolid(lease.frame(), static_cast<uint8_t>(i)));
+        }
+        lease.release();
+        CHECK(!consumer.tryAcquireFrame(lease));
+
+        // The producer never waits; frames 4 to 6 are overwritten and skipped
+        CHECK(writeFrames(producer, 4, 10, width, height));
+        for (uint32_t i = 7; i <= 10; ++i)
+        {
+            CHECK(consumer.tryAcquireFrame(lease));
+            CHECK(lease.frameIndex() == i && isSolid(lease.frame(), static_cast<uint8_t>(i)));
+        }
+        lease.release();
+        CHECK(!consumer.tryAcquireFrame(lease));
+
+        consumer.closeSharedMemory();
+        producer.closeSharedMemory();
+        ShmVideoHandler::removeSharedMemory(name);
+    }
+    return true;
+}
+
+// Runs beginWrite() on another thread; true if it is still blocked after a while
+static bool stillBlocked(ShmVideoHandler &producer, cv::Mat &slotFrame, std::thread &writer, std::atomic<int> &result)
+{
+    result = -1;
+    writer = std::thread([&]()
+    {
+        result = producer.beginWrite(slotFrame, 5000) ? 1 : 0;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    return result == -1;
+}
+
+// BlockProducer never overwrites a frame a reader has not consumed, nor one it still leases
+static bool testBlockProducer()
+{
+    const std::string name = segmentName("block");
+    const uint32_t width = 64, height = 64;
+
+    ShmVideoHandler producer;
+    CHECK(producer.createSharedMemory(name, width, height, ShmPixelFormat::Gray8, 3, BackpressurePolicy::BlockProducer));
+    ShmVideoHandler consumer;
+    CHECK(consumer.openSharedMemory(name));
+
+    // Three slots hold frames 1 to 3; frame 4 would overwrite one the reader has not seen
+    CHECK(writeFrames(producer, 1, 3, width, height));
+    cv::Mat slotFrame;
+    auto start = std::chrono::steady_clock::now();
+    CHECK(!producer.beginWrite(slotFrame, 100));
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(100));
+
+    // Consuming frame 1 frees its slot, but not while the lease holds it
+    ShmVideoFrameLease lease;
+    std::thread writer;
+    std::atomic<int> result(-1);
+    CHECK(consumer.tryAcquireFrame(lease));
+    CHECK(lease.frameIndex() == 1);
+    bool blocked = stillBlocked(producer, slotFrame, writer, result);
+
+    // The waiting writer leaves the handler usable from other threads
+    start = std::chrono::steady_clock::now();
+    producer.abortWrite();
+    bool unlocked = std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1000);
+    lease.release();
+    writer.join();
+    CHECK(blocked && unlocked);
+    CHECK(result == 1);
+
+    slotFrame.setTo(cv::Scalar(4));
+    CHECK(producer.commitWrite(4, 0, 30.0, 0));
+
+    // A plain copy advances the cursor as well and wakes the producer the same way
+    blocked = stillBlocked(producer, slotFrame, writer, result);
+    cv::Mat frame;
+    bool read = consumer.tryReadFrame(frame);
+    writer.join();
+    CHECK(blocked);
+    CHECK(read && isSolid(frame, 2));
+    CHECK(result == 1);
+    producer.abortWrite();
+
+    // Frame 4 went into the freed slot and follows frame 3 in order
+    CHECK(consumer.tryAcquireFrame(lease));
+    CHECK(lease.frameIndex() == 3 && isSolid(lease.frame(), 3));
+    CHECK(consumer.tryAcquireFrame(lease));
+    CHECK(lease.frameIndex() == 4 && isSolid(lease.frame(), 4));
+    lease.release();
+
+    consumer.closeSharedMemory();
+    producer.closeSharedMemory();
+    ShmVideoHandler::removeSharedMemory(name);
+    return true;
+}
+
+// Tiles of frame that differ from previous
+static std::vector<bool> changedTiles(const cv::Mat &frame, const cv::Mat &previous, uint32_t tileSize)
+{
+    uint32_t tilesX = (frame.cols + tileSize - 1) / tileSize;
+    uint32_t tilesY = (frame.rows + tileSize - 1) / tileSize;
+    std::vector<bool> changed(tilesX * tilesY);
+    for (uint32_t y = 0; y < tilesY; ++y)
+    {
+        for (uint32_t x = 0; x < tilesX; ++x)
+        {
+            cv::Rect tile(x * tileSize, y * tileSize, tileSize, tileSize);
+            tile &= cv::Rect(0, 0, frame.cols, frame.rows);
+            changed[y * tilesX + x] = cv::norm(frame(tile), previous(tile), cv::NORM_INF) > 0;
+        }
+    }
+    return changed;
+}
+
+// writeFrameDelta marks only the tiles that changed, yet every slot ends up with the whole frame
+static bool testDeltaFrames()
+{
+    const std::string name = segmentName("delta");
+    const uint32_t width = 300, height = 200; // 5 x 4 tiles, the last column and row partial
+
+    ShmVideoHandler producer;
+    CHECK(producer.createSharedMemory(name, width, height, ShmPixelFormat::Gray8, 3, BackpressurePolicy::LatestOnly));
+    ShmVideoHandler consumer;
+    CHECK(consumer.openSharedMemory(name));
+
+    cv::RNG rng(1234);
+    cv::Mat frame(static_cast<int>(height), static_cast<int>(width), CV_8UC1);
+    rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+    cv::Mat previous = frame.clone();
+
+    // The first frame has nothing to diff against
+    ShmVideoFrameLease lease;
+    CHECK(producer.writeFrameDelta(frame, 0, 0, 30.0, 0));
+    CHECK(consumer.tryAcquireFrame(lease));
+    CHECK(lease.tileSize() == kMinTileSize && lease.tilesX() == 5 && lease.tilesY() == 4);
+    for (uint32_t tile = 0; tile < 20; ++tile)
+    {
+        CHECK(lease.isTileDirty(tile % 5, tile / 5));
+    }
+    CHECK(cv::norm(lease.frame(), frame, cv::NORM_INF) == 0);
+
+    // More frames than slots, so each slot also has to catch up on tiles it missed
+    for (uint32_t i = 1; i <= 8; ++i)
+    {
+        cv::Rect change(static_cast<int>((i * 37) % width), static_cast<int>((i * 53) % height), 5, 5);
+        change &= cv::Rect(0, 0, width, height);
+        frame(change).setTo(cv::Scalar(static_cast<uint8_t>(i * 29)));
+
+        CHECK(producer.writeFrameDelta(frame, i, 0, 30.0, 0));
+        CHECK(consumer.tryAcquireFrame(lease));
+        CHECK(lease.frameIndex() == i);
+
+        std::vector<bool> changed = changedTiles(frame, previous, kMinTileSize);
+        for (uint32_t tile = 0; tile < changed.size(); ++tile)
+        {
+            CHECK(lease.isTileDirty(tile % 5, tile / 5) == changed[tile]);
+        }
+        CHECK(cv::norm(lease.frame(), frame, cv::NORM_INF) == 0);
+        frame.copyTo(previous);
+    }
+
+    // An unchanged frame has no dirty tiles at all
+    CHECK(producer.writeFrameDelta(frame, 9, 0, 30.0, 0));
+    CHECK(consumer.tryAcquireFrame(lease));
+    for (uint32_t tile = 0; tile < 20; ++tile)
+    {
+        CHECK(!lease.isTileDirty(tile % 5, tile / 5));
+    }
+    CHECK(cv::norm(lease.frame(), frame, cv::NORM_INF) == 0);
+
+    lease.release();
+    consumer.closeSharedMemory();
+    producer.closeSharedMemory();
+    ShmVideoHandler::removeSharedMemory(name);
+    return true;
+}
+
+int main()
+{
+    const std::pair<const char *, std::function<bool()>> tests[] = {
+        {"torn reads", testTornReads},
+        {"pinned slots", testPinnedSlots},
+        {"crashed reader", testCrashedReader},
+        {"frame types", testFrameTypes},
+        {"reader cursors", testReaderCursors},
+        {"block producer", testBlockProducer},
+        {"delta frames", testDeltaFrames},
+    };
+
+    int failed = 0;
+    for (const auto &test : tests)
+    {
+        bool passed = test.second();
+        LOG_INFO(test.first << ": " << (passed ? "passed" : "FAILED"));
+        failed += !passed;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+// Round trip of the shared upload semaphore: a producer SyncManager signals
+// and exports, a second SyncManager imports the payload and a submission
+// waits on it. Both SyncModes are covered where the driver supports them;
+// both sides share one device without a window, as they would on one GPU.
+#include "core/vulkan_device.hpp"
+#include "sync/sync_manager.hpp"
+#include "utils/logger.hpp"
+
+#include <stdexcept>
+
+using namespace vst;
+using namespace vst::sync;
+
+static constexpr int kFrames = 4;
+static constexpr uint64_t kTimeoutNs = 5'000'000'000ull;
+
+// CTest reports this as skipped, see SKIP_RETURN_CODE in CMakeLists.txt
+static constexpr int kSkipped = 77;
+
+enum class Result
+{
+    Passed,
+    Failed,
+    Skipped
+};
+
+// Empty submission that only signals, as the producer's upload submission does
+static void submitSignal(VkQueue queue, VkSemaphore semaphore, uint64_t value)
+{
+    VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &value;
+
+    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.pNext = value > 0 ? &timelineInfo : nullptr;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &semaphore;
+    if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit the producer signal.");
+    }
+}
+
+// Empty submission that waits, as the consumer's draw does; true once the fence signals
+static bool submitWait(VkDevice device, VkQueue queue, VkFence fence, VkSemaphore semaphore, uint64_t value)
+{
+    VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    timelineInfo.waitSemaphoreValueCount = 1;
+    timelineInfo.pWaitSemaphoreValues = &value;
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.pNext = value > 0 ? &timelineInfo : nullptr;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &semaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+
+    vkResetFences(device, 1, &fence);
+    if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit the consumer wait.");
+    }
+    return vkWaitForFences(device, 1, &fence, VK_TRUE, kTimeoutNs) == VK_SUCCESS;
+}
+
+static Result runRoundTrip(VulkanDevice &vulkanDevice, bool timeline)
+{
+    const char *name = syncModeName(timeline ? SyncMode::TimelineOpaqueFd : SyncMode::BinarySyncFd);
+    VkDevice device = vulkanDevice.getDevice();
+
+    SyncManager producer;
+    SyncMode mode = producer.initProducer(device, vulkanDevice.getPhysicalDevice(), timeline);
+    if (mode != (timeline ? SyncMode::TimelineOpaqueFd : SyncMode::BinarySyncFd))
+    {
+        LOG_WARN(name << ": not supported by this driver, skipped");
+        return Result::Skipped;
+    }
+
+    // The timeline semaphore is shared once at connect; sync fds travel with every frame
+    SyncManager consumer;
+    int semaphoreFd = timeline ? producer.exportSemaphoreFd() : -1;
+    if (timeline && semaphoreFd < 0)
+    {
+        LOG_ERR(name << ": semaphore export failed");
+        return Result::Failed;
+    }
+    if (!consumer.initConsumer(device, vulkanDevice.getPhysicalDevice(), mode, semaphoreFd, timeline))
+    {
+        LOG_ERR(name << ": consumer could not import the semaphore");
+        return Result::Failed;
+    }
+
+    VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VkFence fence = VK_NULL_HANDLE;
+    if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create fence.");
+    }
+
+    Result result = Result::Passed;
+    for (int frame = 0; frame < kFrames && result == Result::Passed; ++frame)
+    {
+        uint64_t signalValue = producer.nextSignalValue();
+        submitSignal(vulkanDevice.getTransferQueue(), producer.getSignalSemaphore(), signalValue);
+        int frameFd = producer.exportFrameFd();
+        if (!timeline && frameFd < 0)
+        {
+            LOG_ERR(name << ": frame " << frame << " sync fd export failed");
+            result = Result::Failed;
+            break;
+        }
+
+        consumer.onFrameReady(signalValue, frameFd);
+
+        VkSemaphore waitSemaphore = VK_NULL_HANDLE;
+        uint64_t waitValue = 0;
+        if (!consumer.acquireWait(waitSemaphore, waitValue) || waitValue != signalValue)
+        {
+            LOG_ERR(name << ": frame " << frame << " produced no wait for value " << signalValue);
+            result = Result::Failed;
+        }
+        else if (!submitWait(device, vulkanDevice.getGraphicsQueue(), fence, waitSemaphore, waitValue))
+        {
+            LOG_ERR(name << ": frame " << frame << " wait never completed");
+            result = Result::Failed;
+        }
+        else if (!timeline && consumer.acquireWait(waitSemaphore, waitValue))
+        {
+            // A sync fd covers exactly one wait
+            LOG_ERR(name << ": frame " << frame << " sync fd was waited on twice");
+            result = Result::Failed;
+        }
+    }
+
+    vkDeviceWaitIdle(device);
+    vkDestroyFence(device, fence, nullptr);
+    consumer.destroy();
+    producer.destroy();
+
+    if (result == Result::Passed)
+    {
+        LOG_INFO(name << ": " << kFrames << " frames passed");
+    }
+    return result;
+}
+
+// Instance without surface extensions; the test never presents
+static VkInstance createInstance()
+{
+    VkApplicationInfo appInfo{VK_STRUCTURE_TYPE_APPLICATION_INFO};
+    appInfo.pApplicationName = "sync_roundtrip_test";
+    appInfo.apiVersion = VK_API_VERSION_1_3;
+
+    VkInstanceCreateInfo createInfo{VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+    createInfo.pApplicationInfo = &appInfo;
+
+    VkInstance instance = VK_NULL_HANDLE;
+    if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create Vulkan instance.");
+    }
+    return instance;
+}
+
+int main()
+{
+    VkInstance instance = VK_NULL_HANDLE;
+    int passed = 0;
+    int failed = 0;
+    try
+    {
+        instance = createInstance();
+        VulkanDevice device;
+        device.pickPhysicalDevice(instance, false);
+        device.createLogicalDevice();
+        if (!device.hasExternalSemaphoreFd())
+        {
+            LOG_WARN("VK_KHR_external_semaphore_fd is not available, skipped");
+        }
+        else
+        {
+            for (bool timeline : {true, false})
+            {
+                if (timeline && !device.hasTimelineSemaphores())
+                {
+                    LOG_WARN("Timeline semaphores are not available, timeline mode skipped");
+                    continue;
+                }
+
+                Result result = runRoundTrip(device, timeline);
+                passed += result == Result::Passed;
+                failed += result == Result::Failed;
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERR("Sync round trip test failed: " << e.what());
+        failed = 1;
+    }
+
+    // The device is destroyed with its VulkanDevice, before the instance
+    if (instance != VK_NULL_HANDLE)
+    {
+        vkDestroyInstance(instance, nullptr);
+    }
+
+    if (failed > 0)
+    {
+        return 1;
+    }
+    return passed > 0 ? 0 : kSkipped;
+}